@@ -0,0 +1,158 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+// Measures what one compilation pays for using the git index: opening the
+// index of a large work tree and looking up the included headers.
+//
+// Usage: bench_GitIndex [index entries] [lookups] [rounds] [index version]
+//
+// A work tree is created in the directory bench_GitIndex.tmp in the current
+// directory. Only the looked up files exist on disk; the other entries only
+// make the index large.
+
+#include "GitIndex.hpp"
+#include "Stat.hpp"
+#include "Util.hpp"
+#include "fmtmacros.hpp"
+
+#include <util/TimePoint.hpp>
+#include <util/file.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+void
+append_int(std::string& data, uint32_t value, size_t size = 4)
+{
+  for (size_t i = size; i > 0; --i) {
+    data += static_cast<char>((value >> (8 * (i - 1))) & 0xff);
+  }
+}
+
+std::string
+get_name(size_t i)
+{
+  return FMT("src/dir{:04}/file{:07}.h", i / 100, i);
+}
+
+// Write an index with `entries` entries where every `step`th entry is a file
+// that exists on disk.
+void
+write_index(const std::string& work_tree,
+            size_t entries,
+            size_t step,
+            uint32_t version)
+{
+  std::string data = "DIRC";
+  append_int(data, version);
+  append_int(data, entries);
+  std::string previous_name;
+  for (size_t i = 0; i < entries; ++i) {
+    const auto name = get_name(i);
+    const size_t entry_start = data.size();
+    Stat stat;
+    if (i % step == 0) {
+      const auto path = FMT("{}/{}", work_tree, name);
+      Util::ensure_dir_exists(std::string(Util::dir_name(path)));
+      util::write_file(path, name);
+      stat = Stat::stat(path);
+    }
+    append_int(data, stat ? stat.ctime().sec() : 0);
+    append_int(data, stat ? stat.ctime().nsec_decimal_part() : 0);
+    append_int(data, stat ? stat.mtime().sec() : 0);
+    append_int(data, stat ? stat.mtime().nsec_decimal_part() : 0);
+    append_int(data, stat ? stat.device() : 0);
+    append_int(data, stat ? stat.inode() : 0);
+    append_int(data, 0100644);
+    append_int(data, 0);
+    append_int(data, 0);
+    append_int(data, stat ? stat.size() : 0);
+    data += std::string(20, static_cast<char>(i)); // Object ID
+    append_int(data, name.length(), 2);
+    if (version == 4) {
+      size_t common = 0;
+      while (common < previous_name.length() && common < name.length()
+             && previous_name[common] == name[common]) {
+        ++common;
+      }
+      data += static_cast<char>(previous_name.length() - common);
+      data += name.substr(common);
+      data += '\0';
+    } else {
+      data += name;
+      do {
+        data += '\0';
+      } while ((data.size() - entry_start) % 8 != 0);
+    }
+    previous_name = name;
+  }
+  data += std::string(20, '\0'); // Checksum
+  const auto index_path = FMT("{}/.git/index", work_tree);
+  util::write_file(index_path, data);
+  util::set_timestamps(index_path, util::TimePoint::now() + util::Duration(10));
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  const size_t entries = argc > 1 ? std::stoul(argv[1]) : 100'000;
+  const size_t lookups = argc > 2 ? std::stoul(argv[2]) : 300;
+  const size_t rounds = argc > 3 ? std::stoul(argv[3]) : 50;
+  const uint32_t version = argc > 4 ? std::stoul(argv[4]) : 2;
+  const size_t step = std::max<size_t>(1, entries / lookups);
+
+  const auto work_tree = FMT("{}/bench_GitIndex.tmp", Util::get_actual_cwd());
+  Util::ensure_dir_exists(FMT("{}/.git", work_tree));
+  write_index(work_tree, entries, step, version);
+
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < entries; i += step) {
+    paths.push_back(FMT("{}/{}", work_tree, get_name(i)));
+  }
+
+  size_t hits = 0;
+  std::vector<double> times;
+  for (size_t i = 0; i < rounds; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    GitIndex index(work_tree);
+    for (const auto& path : paths) {
+      hits += index.get(path) ? 1 : 0;
+    }
+    times.push_back(std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - start)
+                      .count());
+  }
+  std::sort(times.begin(), times.end());
+
+  printf("%zu entries (version %u), %zu of %zu lookups hit per compilation\n",
+         entries,
+         version,
+         hits / rounds,
+         paths.size());
+  printf("min %.3f ms, median %.3f ms per compilation\n",
+         times.front(),
+         times[times.size() / 2]);
+  return 0;
+}
@@ -0,0 +1,105 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+// Measures the compopt lookups done for each argument of a large command line.
+//
+// Usage: bench_compopt [arguments per command line] [rounds]
+//
+// Only std::string arguments are passed so that the program also builds
+// against older versions of the compopt API for comparison.
+
+#include "compopt.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string>
+make_command_line(const size_t size)
+{
+  std::vector<std::string> args;
+  for (size_t i = 0; i < size; ++i) {
+    switch (i % 4) {
+    case 0:
+      args.push_back("-I/some/include/dir" + std::to_string(i));
+      break;
+    case 1:
+      args.push_back("-DFOO_" + std::to_string(i) + "=1");
+      break;
+    case 2:
+      args.emplace_back("-isystem");
+      break;
+    case 3:
+      args.push_back("/usr/include/x" + std::to_string(i));
+      break;
+    }
+  }
+  return args;
+}
+
+// Roughly the lookups done per argument by process_arg and hash_argument.
+size_t
+look_up(const std::vector<std::string>& args)
+{
+  size_t matches = 0;
+  for (const auto& arg : args) {
+    matches += compopt_too_hard(arg);
+    matches += compopt_too_hard_for_direct_mode(arg);
+    matches += compopt_affects_compiler_output(arg);
+    matches += compopt_prefix_affects_compiler_output(arg);
+    matches += compopt_takes_path(arg);
+    matches += compopt_takes_arg(arg);
+    matches += compopt_affects_cpp_output(arg);
+    matches += compopt_affects_cpp_output(arg.substr(0, 2));
+    matches += compopt_prefix_affects_cpp_output(arg);
+  }
+  return matches;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  const size_t size = argc > 1 ? std::stoul(argv[1]) : 10'000;
+  const size_t rounds = argc > 2 ? std::stoul(argv[2]) : 100;
+  const auto args = make_command_line(size);
+
+  size_t matches = 0;
+  std::vector<double> times;
+  for (size_t i = 0; i < rounds; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    matches += look_up(args);
+    times.push_back(std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - start)
+                      .count());
+  }
+  std::sort(times.begin(), times.end());
+
+  printf("%zu arguments, %zu matches per command line\n",
+         size,
+         matches / rounds);
+  printf("min %.3f ms, median %.3f ms per command line\n",
+         times.front(),
+         times[times.size() / 2]);
+  return 0;
+}
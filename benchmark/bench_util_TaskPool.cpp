@@ -0,0 +1,181 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+// Compares util::TaskPool with a pool that has a single global task queue, as
+// the ThreadPool class that TaskPool replaced.
+//
+// Usage: bench_util_TaskPool [tasks] [work per task] [rounds]
+
+#include <util/TaskPool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Worker threads taking tasks from one mutex-protected queue with a maximum
+// size, like the old ThreadPool.
+class GlobalQueuePool
+{
+public:
+  GlobalQueuePool(size_t number_of_threads, size_t task_queue_max_size);
+  ~GlobalQueuePool();
+
+  void enqueue(std::function<void()> function);
+
+private:
+  std::vector<std::thread> m_worker_threads;
+  std::queue<std::function<void()>> m_task_queue;
+  const size_t m_task_queue_max_size;
+  bool m_shutting_down = false;
+  std::mutex m_mutex;
+  std::condition_variable m_task_enqueued_or_shutting_down_condition;
+  std::condition_variable m_task_popped_condition;
+};
+
+GlobalQueuePool::GlobalQueuePool(const size_t number_of_threads,
+                                 const size_t task_queue_max_size)
+  : m_task_queue_max_size(task_queue_max_size)
+{
+  for (size_t i = 0; i < number_of_threads; ++i) {
+    m_worker_threads.emplace_back([this] {
+      while (true) {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_task_enqueued_or_shutting_down_condition.wait(
+            lock, [this] { return m_shutting_down || !m_task_queue.empty(); });
+          if (m_shutting_down && m_task_queue.empty()) {
+            return;
+          }
+          task = std::move(m_task_queue.front());
+          m_task_queue.pop();
+        }
+        m_task_popped_condition.notify_all();
+        task();
+      }
+    });
+  }
+}
+
+GlobalQueuePool::~GlobalQueuePool()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_shutting_down = true;
+  }
+  m_task_enqueued_or_shutting_down_condition.notify_all();
+  for (auto& thread : m_worker_threads) {
+    thread.join();
+  }
+}
+
+void
+GlobalQueuePool::enqueue(std::function<void()> function)
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task_popped_condition.wait(
+      lock, [this] { return m_task_queue.size() < m_task_queue_max_size; });
+    m_task_queue.push(std::move(function));
+  }
+  m_task_enqueued_or_shutting_down_condition.notify_one();
+}
+
+void
+work(const size_t amount, std::atomic<size_t>& sink)
+{
+  size_t x = 0;
+  for (size_t i = 0; i < amount; ++i) {
+    x = x * 31 + i;
+  }
+  sink += x;
+}
+
+template<typename Function>
+double
+median_ms(const size_t rounds, Function function)
+{
+  std::vector<double> times;
+  for (size_t i = 0; i < rounds; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    times.push_back(std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - start)
+                      .count());
+  }
+  std::sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  const size_t tasks = argc > 1 ? std::stoul(argv[1]) : 200'000;
+  const size_t amount = argc > 2 ? std::stoul(argv[2]) : 200;
+  const size_t rounds = argc > 3 ? std::stoul(argv[3]) : 3;
+  const size_t threads = std::max(1U, std::thread::hardware_concurrency());
+  // Same read-ahead limit as recompress and analyze use.
+  const size_t read_ahead = 2 * threads;
+  std::atomic<size_t> sink{0};
+
+  printf("%zu tasks of %zu iterations, %zu threads, median of %zu rounds\n",
+         tasks,
+         amount,
+         threads,
+         rounds);
+
+  printf("Global queue: %8.2f ms\n", median_ms(rounds, [&] {
+           GlobalQueuePool pool(threads, read_ahead);
+           for (size_t i = 0; i < tasks; ++i) {
+             pool.enqueue([&] { work(amount, sink); });
+           }
+         }));
+
+  printf("TaskPool:     %8.2f ms\n", median_ms(rounds, [&] {
+           util::TaskPool pool(threads);
+           util::TaskGroup group(pool, read_ahead);
+           for (size_t i = 0; i < tasks; ++i) {
+             group.run([&] { work(amount, sink); });
+           }
+           group.wait();
+         }));
+
+  printf("Idle pool creation and destruction:\n");
+  printf("  Global queue: %8.3f ms\n", median_ms(rounds, [&] {
+           GlobalQueuePool pool(threads, read_ahead);
+         }));
+  printf("  TaskPool:     %8.3f ms\n", median_ms(rounds, [&] {
+           util::TaskPool pool(threads);
+           util::TaskGroup group(pool, read_ahead);
+           group.wait();
+         }));
+
+  return sink == 0 ? 1 : 0;
+}
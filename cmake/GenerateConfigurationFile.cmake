@@ -5,6 +5,7 @@ set(include_files
     sys/clonefile.h
     sys/ioctl.h
     sys/mman.h
+    sys/resource.h
     sys/time.h
     sys/wait.h
     sys/file.h
@@ -37,6 +38,7 @@ set(functions
     unsetenv
     utimensat
     utimes
+    wait4
 )
 foreach(func IN ITEMS ${functions})
   string(TOUPPER ${func} func_var)
@@ -60,6 +62,22 @@ check_cxx_source_compiles(
 check_function_exists(pthread_mutexattr_setpshared HAVE_PTHREAD_MUTEXATTR_SETPSHARED)
 set(CMAKE_REQUIRED_FLAGS)
 
+check_cxx_source_compiles(
+  [=[
+    #include <linux/io_uring.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    int main()
+    {
+      io_uring_sqe sqe{};
+      sqe.opcode = IORING_OP_STATX;
+      struct statx stx;
+      (void)stx;
+      return __NR_io_uring_setup + __NR_io_uring_enter;
+    }
+  ]=]
+  HAVE_IO_URING_STATX)
+
 include(CheckStructHasMember)
 check_struct_has_member("struct stat" st_atim sys/stat.h
                         HAVE_STRUCT_STAT_ST_ATIM LANGUAGE CXX)
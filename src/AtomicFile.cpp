@@ -18,17 +18,58 @@
 
 #include "AtomicFile.hpp"
 
+#include "Fd.hpp"
+#include "Logging.hpp"
 #include "TemporaryFile.hpp"
 #include "Util.hpp"
 #include "assertions.hpp"
 
 #include <core/exceptions.hpp>
 #include <fmtmacros.hpp>
+#include <util/file.hpp>
+
+#include <fcntl.h>
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+namespace {
+
+// Data chunks at least this large are written directly to the file descriptor
+// instead of being copied via the stdio buffer.
+const size_t k_direct_write_threshold = 64 * 1024;
+
+#ifdef O_TMPFILE
+// Open an anonymous file in `dir`. Returns an unset Fd if the file system or
+// kernel doesn't support O_TMPFILE.
+Fd
+open_anonymous_file(const std::string& dir)
+{
+  Fd fd(open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0666));
+  if (!fd && errno == ENOENT && Util::create_dir(dir)) {
+    fd = Fd(open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0666));
+  }
+  return fd;
+}
+#endif
+
+} // namespace
 
 AtomicFile::AtomicFile(const std::string& path, Mode mode) : m_path(path)
 {
+  const char* const fopen_mode = mode == Mode::binary ? "w+b" : "w+";
+
+#ifdef O_TMPFILE
+  Fd fd = open_anonymous_file(std::string(Util::dir_name(path)));
+  if (fd) {
+    m_stream = fdopen(fd.release(), fopen_mode);
+    return;
+  }
+#endif
+
   TemporaryFile tmp_file(path);
-  m_stream = fdopen(tmp_file.fd.release(), mode == Mode::binary ? "w+b" : "w+");
+  m_stream = fdopen(tmp_file.fd.release(), fopen_mode);
   m_tmp_path = std::move(tmp_file.path);
 }
 
@@ -37,22 +78,36 @@ AtomicFile::~AtomicFile()
   if (m_stream) {
     // commit() was not called so remove the lingering temporary file.
     fclose(m_stream);
-    Util::unlink_tmp(m_tmp_path);
+    if (!m_tmp_path.empty()) {
+      Util::unlink_tmp(m_tmp_path);
+    }
   }
 }
 
 void
 AtomicFile::write(std::string_view data)
 {
-  if (fwrite(data.data(), data.size(), 1, m_stream) != 1) {
-    throw core::Error(
-      FMT("failed to write data to {}: {}", m_path, strerror(errno)));
-  }
+  write(nonstd::span<const uint8_t>(
+    reinterpret_cast<const uint8_t*>(data.data()), data.size()));
 }
 
 void
 AtomicFile::write(nonstd::span<const uint8_t> data)
 {
+  if (data.size() >= k_direct_write_threshold) {
+    if (fflush(m_stream) != 0) {
+      throw core::Error(
+        FMT("failed to write data to {}: {}", m_path, strerror(errno)));
+    }
+    const auto result =
+      util::write_fd(fileno(m_stream), data.data(), data.size());
+    if (!result) {
+      throw core::Error(
+        FMT("failed to write data to {}: {}", m_path, result.error()));
+    }
+    return;
+  }
+
   if (fwrite(data.data(), data.size(), 1, m_stream) != 1) {
     throw core::Error(
       FMT("failed to write data to {}: {}", m_path, strerror(errno)));
@@ -63,6 +118,27 @@ void
 AtomicFile::commit()
 {
   ASSERT(m_stream);
+
+  if (m_tmp_path.empty()) {
+    if (fflush(m_stream) != 0) {
+      const int saved_errno = errno;
+      fclose(m_stream);
+      m_stream = nullptr;
+      throw core::Error(
+        FMT("failed to write data to {}: {}", m_path, strerror(saved_errno)));
+    }
+    try {
+      link_anonymous_file();
+    } catch (const core::Error&) {
+      fclose(m_stream);
+      m_stream = nullptr;
+      throw;
+    }
+    fclose(m_stream);
+    m_stream = nullptr;
+    return;
+  }
+
   int result = fclose(m_stream);
   m_stream = nullptr;
   if (result == EOF) {
@@ -72,3 +148,81 @@ AtomicFile::commit()
   }
   Util::rename(m_tmp_path, m_path);
 }
+
+void
+AtomicFile::link_anonymous_file()
+{
+#ifdef O_TMPFILE
+  const int fd = fileno(m_stream);
+  const auto proc_path = FMT("/proc/self/fd/{}", fd);
+
+  // linkat can't replace an existing file, so link directly to the destination
+  // in the common case and otherwise go via a temporary name.
+  if (linkat(AT_FDCWD,
+             proc_path.c_str(),
+             AT_FDCWD,
+             m_path.c_str(),
+             AT_SYMLINK_FOLLOW)
+      == 0) {
+    return;
+  }
+  if (errno == EEXIST) {
+    for (unsigned i = 0; i < 100; ++i) {
+      const auto tmp_path = FMT(
+        "{}{}{:x}.{}.tmp", m_path, TemporaryFile::tmp_file_infix, getpid(), i);
+      if (linkat(AT_FDCWD,
+                 proc_path.c_str(),
+                 AT_FDCWD,
+                 tmp_path.c_str(),
+                 AT_SYMLINK_FOLLOW)
+          == 0) {
+        try {
+          Util::rename(tmp_path, m_path);
+        } catch (const core::Error&) {
+          Util::unlink_tmp(tmp_path);
+          throw;
+        }
+        return;
+      }
+      if (errno != EEXIST) {
+        break;
+      }
+    }
+  }
+
+  // Linking failed (e.g. /proc is not mounted), so fall back to copying the
+  // data to a named temporary file.
+  LOG("Failed to link anonymous file to {}: {}", m_path, strerror(errno));
+  TemporaryFile tmp_file(m_path);
+  try {
+    if (lseek(fd, 0, SEEK_SET) != 0) {
+      throw core::Error(
+        FMT("failed to seek in file for {}: {}", m_path, strerror(errno)));
+    }
+    std::string write_error;
+    const auto read_result =
+      util::read_fd(fd, [&](const uint8_t* data, size_t size) {
+        const auto result = util::write_fd(*tmp_file.fd, data, size);
+        if (!result && write_error.empty()) {
+          write_error = result.error();
+        }
+      });
+    if (!read_result || !write_error.empty()) {
+      throw core::Error(
+        FMT("failed to copy data to {}: {}",
+            tmp_file.path,
+            read_result ? write_error : read_result.error()));
+    }
+    if (!tmp_file.fd.close()) {
+      throw core::Error(
+        FMT("failed to write data to {}: {}", m_path, strerror(errno)));
+    }
+    Util::rename(tmp_file.path, m_path);
+  } catch (const core::Error&) {
+    Util::unlink_tmp(tmp_file.path);
+    throw;
+  }
+#else
+  ASSERT(false);
+#endif
+}
@@ -26,6 +26,11 @@
 
 // This class represents a file whose data will be atomically written to a path
 // by renaming a temporary file in place.
+//
+// On systems supporting O_TMPFILE (Linux), the data is instead written to an
+// anonymous inode in the destination directory which is linked into place on
+// commit. This saves directory operations and guarantees that no temporary
+// file is left behind if the process dies before committing.
 class AtomicFile
 {
 public:
@@ -46,8 +51,10 @@ public:
 
 private:
   const std::string m_path;
-  std::string m_tmp_path;
+  std::string m_tmp_path; // Empty if m_stream refers to an anonymous file.
   FILE* m_stream;
+
+  void link_anonymous_file();
 };
 
 inline FILE*
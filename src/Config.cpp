@@ -58,8 +58,11 @@ namespace {
 
 enum class ConfigItem {
   absolute_paths_in_stderr,
+  access_trace_file,
+  admission_policy,
   base_dir,
   cache_dir,
+  compile_lease_timeout,
   compiler,
   compiler_check,
   compiler_type,
@@ -69,18 +72,23 @@ enum class ConfigItem {
   debug,
   debug_dir,
   depend_mode,
+  digest_map,
   direct_mode,
   disable,
   extra_files_to_hash,
   file_clone,
+  git_index,
   hard_link,
   hash_dir,
   ignore_headers_in_manifest,
   ignore_options,
+  immutable_include_roots,
   inode_cache,
+  io_uring,
   keep_comments_cpp,
   limit_multiple,
   log_file,
+  max_concurrent_compiles,
   max_files,
   max_size,
   namespace_,
@@ -91,6 +99,7 @@ enum class ConfigItem {
   read_only,
   read_only_direct,
   recache,
+  remote_inline_max_size,
   remote_only,
   remote_storage,
   reshare,
@@ -99,6 +108,7 @@ enum class ConfigItem {
   stats,
   stats_log,
   temporary_dir,
+  trace_file,
   umask,
 };
 
@@ -113,8 +123,11 @@ struct ConfigKeyTableEntry
 const std::unordered_map<std::string, ConfigKeyTableEntry> k_config_key_table =
   {
     {"absolute_paths_in_stderr", {ConfigItem::absolute_paths_in_stderr}},
+    {"access_trace_file", {ConfigItem::access_trace_file}},
+    {"admission_policy", {ConfigItem::admission_policy}},
     {"base_dir", {ConfigItem::base_dir}},
     {"cache_dir", {ConfigItem::cache_dir}},
+    {"compile_lease_timeout", {ConfigItem::compile_lease_timeout}},
     {"compiler", {ConfigItem::compiler}},
     {"compiler_check", {ConfigItem::compiler_check}},
     {"compiler_type", {ConfigItem::compiler_type}},
@@ -124,18 +137,23 @@ const std::unordered_map<std::string, ConfigKeyTableEntry> k_config_key_table =
     {"debug", {ConfigItem::debug}},
     {"debug_dir", {ConfigItem::debug_dir}},
     {"depend_mode", {ConfigItem::depend_mode}},
+    {"digest_map", {ConfigItem::digest_map}},
     {"direct_mode", {ConfigItem::direct_mode}},
     {"disable", {ConfigItem::disable}},
     {"extra_files_to_hash", {ConfigItem::extra_files_to_hash}},
     {"file_clone", {ConfigItem::file_clone}},
+    {"git_index", {ConfigItem::git_index}},
     {"hard_link", {ConfigItem::hard_link}},
     {"hash_dir", {ConfigItem::hash_dir}},
     {"ignore_headers_in_manifest", {ConfigItem::ignore_headers_in_manifest}},
     {"ignore_options", {ConfigItem::ignore_options}},
+    {"immutable_include_roots", {ConfigItem::immutable_include_roots}},
     {"inode_cache", {ConfigItem::inode_cache}},
+    {"io_uring", {ConfigItem::io_uring}},
     {"keep_comments_cpp", {ConfigItem::keep_comments_cpp}},
     {"limit_multiple", {ConfigItem::limit_multiple}},
     {"log_file", {ConfigItem::log_file}},
+    {"max_concurrent_compiles", {ConfigItem::max_concurrent_compiles}},
     {"max_files", {ConfigItem::max_files}},
     {"max_size", {ConfigItem::max_size}},
     {"namespace", {ConfigItem::namespace_}},
@@ -146,6 +164,7 @@ const std::unordered_map<std::string, ConfigKeyTableEntry> k_config_key_table =
     {"read_only", {ConfigItem::read_only}},
     {"read_only_direct", {ConfigItem::read_only_direct}},
     {"recache", {ConfigItem::recache}},
+    {"remote_inline_max_size", {ConfigItem::remote_inline_max_size}},
     {"remote_only", {ConfigItem::remote_only}},
     {"remote_storage", {ConfigItem::remote_storage}},
     {"reshare", {ConfigItem::reshare}},
@@ -155,11 +174,14 @@ const std::unordered_map<std::string, ConfigKeyTableEntry> k_config_key_table =
     {"stats", {ConfigItem::stats}},
     {"stats_log", {ConfigItem::stats_log}},
     {"temporary_dir", {ConfigItem::temporary_dir}},
+    {"trace_file", {ConfigItem::trace_file}},
     {"umask", {ConfigItem::umask}},
 };
 
 const std::unordered_map<std::string, std::string> k_env_variable_table = {
   {"ABSSTDERR", "absolute_paths_in_stderr"},
+  {"ACCESSTRACEFILE", "access_trace_file"},
+  {"ADMISSIONPOLICY", "admission_policy"},
   {"BASEDIR", "base_dir"},
   {"CC", "compiler"}, // Alias for CCACHE_COMPILER
   {"COMMENTS", "keep_comments_cpp"},
@@ -172,19 +194,25 @@ const std::unordered_map<std::string, std::string> k_env_variable_table = {
   {"DEBUG", "debug"},
   {"DEBUGDIR", "debug_dir"},
   {"DEPEND", "depend_mode"},
+  {"DIGESTMAP", "digest_map"},
   {"DIR", "cache_dir"},
   {"DIRECT", "direct_mode"},
   {"DISABLE", "disable"},
   {"EXTENSION", "cpp_extension"},
   {"EXTRAFILES", "extra_files_to_hash"},
   {"FILECLONE", "file_clone"},
+  {"GITINDEX", "git_index"},
   {"HARDLINK", "hard_link"},
   {"HASHDIR", "hash_dir"},
   {"IGNOREHEADERS", "ignore_headers_in_manifest"},
   {"IGNOREOPTIONS", "ignore_options"},
+  {"IMMUTABLEROOTS", "immutable_include_roots"},
   {"INODECACHE", "inode_cache"},
+  {"IOURING", "io_uring"},
+  {"LEASETIMEOUT", "compile_lease_timeout"},
   {"LIMIT_MULTIPLE", "limit_multiple"},
   {"LOGFILE", "log_file"},
+  {"MAXCOMPILES", "max_concurrent_compiles"},
   {"MAXFILES", "max_files"},
   {"MAXSIZE", "max_size"},
   {"NAMESPACE", "namespace"},
@@ -195,6 +223,7 @@ const std::unordered_map<std::string, std::string> k_env_variable_table = {
   {"READONLY", "read_only"},
   {"READONLY_DIRECT", "read_only_direct"},
   {"RECACHE", "recache"},
+  {"REMOTE_INLINE_MAX_SIZE", "remote_inline_max_size"},
   {"REMOTE_ONLY", "remote_only"},
   {"REMOTE_STORAGE", "remote_storage"},
   {"RESHARE", "reshare"},
@@ -203,6 +232,7 @@ const std::unordered_map<std::string, std::string> k_env_variable_table = {
   {"STATS", "stats"},
   {"STATSLOG", "stats_log"},
   {"TEMPDIR", "temporary_dir"},
+  {"TRACEFILE", "trace_file"},
   {"UMASK", "umask"},
 };
 
@@ -251,6 +281,17 @@ format_cache_size(uint64_t value)
   return Util::format_parsable_size_with_suffix(value);
 }
 
+AdmissionPolicy
+parse_admission_policy(const std::string& value)
+{
+  if (value == "doorkeeper") {
+    return AdmissionPolicy::doorkeeper;
+  } else {
+    // Allow any unknown value for forward compatibility.
+    return AdmissionPolicy::always;
+  }
+}
+
 CompilerType
 parse_compiler_type(const std::string& value)
 {
@@ -465,6 +506,19 @@ default_config_dir(const std::string& home_dir)
 }
 #endif
 
+std::string
+admission_policy_to_string(AdmissionPolicy admission_policy)
+{
+  switch (admission_policy) {
+  case AdmissionPolicy::always:
+    return "always";
+  case AdmissionPolicy::doorkeeper:
+    return "doorkeeper";
+  }
+
+  ASSERT(false);
+}
+
 std::string
 compiler_type_to_string(CompilerType compiler_type)
 {
@@ -685,12 +739,21 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::absolute_paths_in_stderr:
     return format_bool(m_absolute_paths_in_stderr);
 
+  case ConfigItem::access_trace_file:
+    return m_access_trace_file;
+
+  case ConfigItem::admission_policy:
+    return admission_policy_to_string(m_admission_policy);
+
   case ConfigItem::base_dir:
     return m_base_dir;
 
   case ConfigItem::cache_dir:
     return m_cache_dir;
 
+  case ConfigItem::compile_lease_timeout:
+    return FMT("{}", m_compile_lease_timeout);
+
   case ConfigItem::compiler:
     return m_compiler;
 
@@ -718,6 +781,9 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::depend_mode:
     return format_bool(m_depend_mode);
 
+  case ConfigItem::digest_map:
+    return m_digest_map;
+
   case ConfigItem::direct_mode:
     return format_bool(m_direct_mode);
 
@@ -730,6 +796,9 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::file_clone:
     return format_bool(m_file_clone);
 
+  case ConfigItem::git_index:
+    return format_bool(m_git_index);
+
   case ConfigItem::hard_link:
     return format_bool(m_hard_link);
 
@@ -742,9 +811,15 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::ignore_options:
     return m_ignore_options;
 
+  case ConfigItem::immutable_include_roots:
+    return m_immutable_include_roots;
+
   case ConfigItem::inode_cache:
     return format_bool(m_inode_cache);
 
+  case ConfigItem::io_uring:
+    return format_bool(m_io_uring);
+
   case ConfigItem::keep_comments_cpp:
     return format_bool(m_keep_comments_cpp);
 
@@ -754,6 +829,9 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::log_file:
     return m_log_file;
 
+  case ConfigItem::max_concurrent_compiles:
+    return FMT("{}", m_max_concurrent_compiles);
+
   case ConfigItem::max_files:
     return FMT("{}", m_max_files);
 
@@ -784,6 +862,9 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::recache:
     return format_bool(m_recache);
 
+  case ConfigItem::remote_inline_max_size:
+    return format_cache_size(m_remote_inline_max_size);
+
   case ConfigItem::remote_only:
     return format_bool(m_remote_only);
 
@@ -808,6 +889,9 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::temporary_dir:
     return m_temporary_dir;
 
+  case ConfigItem::trace_file:
+    return m_trace_file;
+
   case ConfigItem::umask:
     return format_umask(m_umask);
   }
@@ -901,6 +985,14 @@ Config::set_item(const std::string& key,
     m_absolute_paths_in_stderr = parse_bool(value, env_var_key, negate);
     break;
 
+  case ConfigItem::access_trace_file:
+    m_access_trace_file = Util::expand_environment_variables(value);
+    break;
+
+  case ConfigItem::admission_policy:
+    m_admission_policy = parse_admission_policy(value);
+    break;
+
   case ConfigItem::base_dir:
     m_base_dir = Util::expand_environment_variables(value);
     if (!m_base_dir.empty()) { // The empty string means "disable"
@@ -913,6 +1005,14 @@ Config::set_item(const std::string& key,
     set_cache_dir(Util::expand_environment_variables(value));
     break;
 
+  case ConfigItem::compile_lease_timeout:
+    m_compile_lease_timeout = util::value_or_throw<core::Error>(
+      util::parse_unsigned(value,
+                           std::nullopt,
+                           std::numeric_limits<uint32_t>::max(),
+                           "compile_lease_timeout"));
+    break;
+
   case ConfigItem::compiler:
     m_compiler = value;
     break;
@@ -950,6 +1050,10 @@ Config::set_item(const std::string& key,
     m_depend_mode = parse_bool(value, env_var_key, negate);
     break;
 
+  case ConfigItem::digest_map:
+    m_digest_map = Util::expand_environment_variables(value);
+    break;
+
   case ConfigItem::direct_mode:
     m_direct_mode = parse_bool(value, env_var_key, negate);
     break;
@@ -966,6 +1070,10 @@ Config::set_item(const std::string& key,
     m_file_clone = parse_bool(value, env_var_key, negate);
     break;
 
+  case ConfigItem::git_index:
+    m_git_index = parse_bool(value, env_var_key, negate);
+    break;
+
   case ConfigItem::hard_link:
     m_hard_link = parse_bool(value, env_var_key, negate);
     break;
@@ -982,10 +1090,18 @@ Config::set_item(const std::string& key,
     m_ignore_options = Util::expand_environment_variables(value);
     break;
 
+  case ConfigItem::immutable_include_roots:
+    m_immutable_include_roots = Util::expand_environment_variables(value);
+    break;
+
   case ConfigItem::inode_cache:
     m_inode_cache = parse_bool(value, env_var_key, negate);
     break;
 
+  case ConfigItem::io_uring:
+    m_io_uring = parse_bool(value, env_var_key, negate);
+    break;
+
   case ConfigItem::keep_comments_cpp:
     m_keep_comments_cpp = parse_bool(value, env_var_key, negate);
     break;
@@ -999,6 +1115,14 @@ Config::set_item(const std::string& key,
     m_log_file = Util::expand_environment_variables(value);
     break;
 
+  case ConfigItem::max_concurrent_compiles:
+    m_max_concurrent_compiles = util::value_or_throw<core::Error>(
+      util::parse_unsigned(value,
+                           std::nullopt,
+                           std::numeric_limits<uint32_t>::max(),
+                           "max_concurrent_compiles"));
+    break;
+
   case ConfigItem::max_files:
     m_max_files = util::value_or_throw<core::Error>(
       util::parse_unsigned(value, std::nullopt, std::nullopt, "max_files"));
@@ -1040,6 +1164,10 @@ Config::set_item(const std::string& key,
     m_recache = parse_bool(value, env_var_key, negate);
     break;
 
+  case ConfigItem::remote_inline_max_size:
+    m_remote_inline_max_size = Util::parse_size(value);
+    break;
+
   case ConfigItem::remote_only:
     m_remote_only = parse_bool(value, env_var_key, negate);
     break;
@@ -1073,6 +1201,10 @@ Config::set_item(const std::string& key,
     m_temporary_dir_configured_explicitly = true;
     break;
 
+  case ConfigItem::trace_file:
+    m_trace_file = Util::expand_environment_variables(value);
+    break;
+
   case ConfigItem::umask:
     if (!value.empty()) {
       const auto umask = util::parse_umask(value);
@@ -46,6 +46,15 @@ enum class CompilerType {
 
 std::string compiler_type_to_string(CompilerType compiler_type);
 
+enum class AdmissionPolicy {
+  // Store all results.
+  always,
+  // Store results only when seen before, see storage::local::Doorkeeper.
+  doorkeeper,
+};
+
+std::string admission_policy_to_string(AdmissionPolicy admission_policy);
+
 class Config : NonCopyable
 {
 public:
@@ -54,8 +63,11 @@ public:
   void read();
 
   bool absolute_paths_in_stderr() const;
+  const std::string& access_trace_file() const;
+  AdmissionPolicy admission_policy() const;
   const std::string& base_dir() const;
   const std::string& cache_dir() const;
+  uint32_t compile_lease_timeout() const;
   const std::string& compiler() const;
   const std::string& compiler_check() const;
   CompilerType compiler_type() const;
@@ -65,18 +77,23 @@ public:
   bool debug() const;
   const std::string& debug_dir() const;
   bool depend_mode() const;
+  const std::string& digest_map() const;
   bool direct_mode() const;
   bool disable() const;
   const std::string& extra_files_to_hash() const;
   bool file_clone() const;
+  bool git_index() const;
   bool hard_link() const;
   bool hash_dir() const;
   const std::string& ignore_headers_in_manifest() const;
   const std::string& ignore_options() const;
+  const std::string& immutable_include_roots() const;
   bool inode_cache() const;
+  bool io_uring() const;
   bool keep_comments_cpp() const;
   double limit_multiple() const;
   const std::string& log_file() const;
+  uint32_t max_concurrent_compiles() const;
   uint64_t max_files() const;
   uint64_t max_size() const;
   const std::string& path() const;
@@ -86,6 +103,7 @@ public:
   bool read_only() const;
   bool read_only_direct() const;
   bool recache() const;
+  uint64_t remote_inline_max_size() const;
   bool remote_only() const;
   const std::string& remote_storage() const;
   bool reshare() const;
@@ -95,6 +113,7 @@ public:
   const std::string& stats_log() const;
   const std::string& namespace_() const;
   const std::string& temporary_dir() const;
+  const std::string& trace_file() const;
   std::optional<mode_t> umask() const;
 
   // Return true for Clang and clang-cl.
@@ -162,8 +181,11 @@ private:
   std::string m_system_config_path;
 
   bool m_absolute_paths_in_stderr = false;
+  std::string m_access_trace_file;
+  AdmissionPolicy m_admission_policy = AdmissionPolicy::always;
   std::string m_base_dir;
   std::string m_cache_dir;
+  uint32_t m_compile_lease_timeout = 0;
   std::string m_compiler;
   std::string m_compiler_check = "mtime";
   CompilerType m_compiler_type = CompilerType::auto_guess;
@@ -173,18 +195,23 @@ private:
   bool m_debug = false;
   std::string m_debug_dir;
   bool m_depend_mode = false;
+  std::string m_digest_map;
   bool m_direct_mode = true;
   bool m_disable = false;
   std::string m_extra_files_to_hash;
   bool m_file_clone = false;
+  bool m_git_index = false;
   bool m_hard_link = false;
   bool m_hash_dir = true;
   std::string m_ignore_headers_in_manifest;
   std::string m_ignore_options;
+  std::string m_immutable_include_roots;
   bool m_inode_cache = true;
+  bool m_io_uring = false;
   bool m_keep_comments_cpp = false;
   double m_limit_multiple = 0.8;
   std::string m_log_file;
+  uint32_t m_max_concurrent_compiles = 0;
   uint64_t m_max_files = 0;
   uint64_t m_max_size = 5ULL * 1000 * 1000 * 1000;
   std::string m_path;
@@ -194,6 +221,7 @@ private:
   bool m_read_only = false;
   bool m_read_only_direct = false;
   bool m_recache = false;
+  uint64_t m_remote_inline_max_size = 0;
   bool m_reshare = false;
   bool m_run_second_cpp = true;
   bool m_remote_only = false;
@@ -203,6 +231,7 @@ private:
   std::string m_stats_log;
   std::string m_namespace;
   std::string m_temporary_dir;
+  std::string m_trace_file;
   std::optional<mode_t> m_umask;
 
   bool m_temporary_dir_configured_explicitly = false;
@@ -222,6 +251,18 @@ Config::absolute_paths_in_stderr() const
   return m_absolute_paths_in_stderr;
 }
 
+inline const std::string&
+Config::access_trace_file() const
+{
+  return m_access_trace_file;
+}
+
+inline AdmissionPolicy
+Config::admission_policy() const
+{
+  return m_admission_policy;
+}
+
 inline const std::string&
 Config::base_dir() const
 {
@@ -234,6 +275,12 @@ Config::cache_dir() const
   return m_cache_dir;
 }
 
+inline uint32_t
+Config::compile_lease_timeout() const
+{
+  return m_compile_lease_timeout;
+}
+
 inline const std::string&
 Config::compiler() const
 {
@@ -303,6 +350,12 @@ Config::depend_mode() const
   return m_depend_mode;
 }
 
+inline const std::string&
+Config::digest_map() const
+{
+  return m_digest_map;
+}
+
 inline bool
 Config::direct_mode() const
 {
@@ -327,6 +380,12 @@ Config::file_clone() const
   return m_file_clone;
 }
 
+inline bool
+Config::git_index() const
+{
+  return m_git_index;
+}
+
 inline bool
 Config::hard_link() const
 {
@@ -351,12 +410,24 @@ Config::ignore_options() const
   return m_ignore_options;
 }
 
+inline const std::string&
+Config::immutable_include_roots() const
+{
+  return m_immutable_include_roots;
+}
+
 inline bool
 Config::inode_cache() const
 {
   return m_inode_cache;
 }
 
+inline bool
+Config::io_uring() const
+{
+  return m_io_uring;
+}
+
 inline bool
 Config::keep_comments_cpp() const
 {
@@ -375,6 +446,12 @@ Config::log_file() const
   return m_log_file;
 }
 
+inline uint32_t
+Config::max_concurrent_compiles() const
+{
+  return m_max_concurrent_compiles;
+}
+
 inline uint64_t
 Config::max_files() const
 {
@@ -429,6 +506,12 @@ Config::recache() const
   return m_recache;
 }
 
+inline uint64_t
+Config::remote_inline_max_size() const
+{
+  return m_remote_inline_max_size;
+}
+
 inline bool
 Config::reshare() const
 {
@@ -483,6 +566,12 @@ Config::temporary_dir() const
   return m_temporary_dir;
 }
 
+inline const std::string&
+Config::trace_file() const
+{
+  return m_trace_file;
+}
+
 inline std::optional<mode_t>
 Config::umask() const
 {
@@ -18,6 +18,9 @@
 
 #include "Context.hpp"
 
+#include "DigestMap.hpp"
+#include "GitIndex.hpp"
+#include "IncludePrefetcher.hpp"
 #include "Logging.hpp"
 #include "SignalHandler.hpp"
 #include "Util.hpp"
@@ -56,6 +59,8 @@ Context::initialize()
 
   ignore_header_paths =
     util::split_path_list(config.ignore_headers_in_manifest());
+  immutable_include_roots =
+    util::split_path_list(config.immutable_include_roots());
   set_ignore_options(Util::split_into_strings(config.ignore_options(), " "));
 
   // Set default umask for all files created by ccache from now on (if
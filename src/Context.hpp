@@ -32,15 +32,20 @@
 
 #include <core/Manifest.hpp>
 #include <storage/Storage.hpp>
+#include <util/Bytes.hpp>
 #include <util/TimePoint.hpp>
 
 #include <ctime>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
 #include <vector>
 
+class DigestMap;
+class GitIndex;
+class IncludePrefetcher;
 class SignalHandler;
 
 class Context : NonCopyable
@@ -87,17 +92,39 @@ public:
   // Headers (or directories with headers) to ignore in manifest mode.
   std::vector<std::string> ignore_header_paths;
 
+  // Directories whose content is declared to never change.
+  std::vector<std::string> immutable_include_roots;
+
+  // Fingerprints of immutable include roots, computed on first use. A nullopt
+  // value means that the root could not be fingerprinted.
+  mutable std::unordered_map<std::string, std::optional<Digest>>
+    immutable_include_root_fingerprints;
+
   // Storage (fronting local and remote storage backends).
   storage::Storage storage;
 
   // Direct mode manifest.
   core::Manifest manifest;
 
+  // Result cache entry of the current compilation if it's small enough to be
+  // stored inline in the manifest in remote storage.
+  std::optional<util::Bytes> inline_result;
+
 #ifdef INODE_CACHE_SUPPORTED
   // InodeCache that caches source file hashes when enabled.
   mutable InodeCache inode_cache;
 #endif
 
+  // Content digests supplied by the build system in `digest_map`, if any.
+  std::unique_ptr<DigestMap> digest_map;
+
+  // Index of the git work tree containing the current directory if `git_index`
+  // is enabled.
+  std::unique_ptr<GitIndex> git_index;
+
+  // Include files being hashed in the background while the preprocessor runs.
+  std::unique_ptr<IncludePrefetcher> include_prefetcher;
+
   // PID of currently executing compiler that we have started, if any. 0 means
   // no ongoing compilation.
   pid_t compiler_pid = 0;
@@ -118,6 +145,9 @@ public:
   std::unique_ptr<MiniTrace> mini_trace;
 #endif
 
+  // Tracing to the trace ring in `trace_file`, if configured.
+  std::unique_ptr<TraceRing> trace_ring;
+
   // Register a temporary file to remove at program exit.
   void register_pending_tmp_file(const std::string& path);
 
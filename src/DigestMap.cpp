@@ -0,0 +1,203 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "DigestMap.hpp"
+
+#include "Fd.hpp"
+#include "Logging.hpp"
+#include "Stat.hpp"
+#include "Util.hpp"
+
+#include <core/wincompat.hpp>
+#include <util/file.hpp>
+#include <util/string.hpp>
+
+#include <fcntl.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+#include <cstring>
+
+namespace {
+
+#ifdef HAVE_SYS_MMAN_H
+const void* MMAP_FAILED = reinterpret_cast<void*>(-1); // NOLINT: Must cast here
+#endif
+
+std::optional<Digest>
+parse_digest(std::string_view hex)
+{
+  if (hex.length() != 2 * Digest::size()) {
+    return std::nullopt;
+  }
+  const auto nibble = [](char c) -> int {
+    if (c >= '0' && c <= '9') {
+      return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      return c - 'A' + 10;
+    } else {
+      return -1;
+    }
+  };
+  Digest digest;
+  for (size_t i = 0; i < Digest::size(); ++i) {
+    const int high = nibble(hex[2 * i]);
+    const int low = nibble(hex[2 * i + 1]);
+    if (high < 0 || low < 0) {
+      return std::nullopt;
+    }
+    digest.bytes()[i] = static_cast<uint8_t>(high << 4 | low);
+  }
+  return digest;
+}
+
+const int k_fields_before_path = 6;
+
+// Split `line` into the fields before the path and the path.
+std::optional<std::pair<std::string_view, std::string_view>>
+split_line(std::string_view line)
+{
+  size_t pos = 0;
+  for (int i = 0; i < k_fields_before_path; ++i) {
+    pos = line.find(' ', pos);
+    if (pos == std::string_view::npos) {
+      return std::nullopt;
+    }
+    ++pos;
+  }
+  return std::make_pair(line.substr(0, pos - 1), line.substr(pos));
+}
+
+} // namespace
+
+DigestMap::DigestMap(const std::string& path)
+{
+#ifdef HAVE_SYS_MMAN_H
+  Fd fd(open(path.c_str(), O_RDONLY));
+  if (!fd) {
+    LOG("Failed to open digest map {}: {}", path, strerror(errno));
+    return;
+  }
+  const off_t size = lseek(*fd, 0, SEEK_END);
+  if (size <= 0) {
+    return;
+  }
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, *fd, 0);
+  if (mapping == MMAP_FAILED) {
+    LOG("Failed to mmap {}: {}", path, strerror(errno));
+    return;
+  }
+  m_mapping = mapping;
+  m_data = std::string_view(static_cast<const char*>(mapping), size);
+#else
+  auto data = util::read_file<std::string>(path);
+  if (!data) {
+    LOG("Failed to read digest map {}: {}", path, data.error());
+    return;
+  }
+  m_buffer = std::move(*data);
+  m_data = m_buffer;
+#endif
+}
+
+DigestMap::~DigestMap()
+{
+#ifdef HAVE_SYS_MMAN_H
+  if (m_mapping) {
+    munmap(m_mapping, m_data.size());
+  }
+#endif
+}
+
+std::optional<DigestMap::Entry>
+DigestMap::find(const std::string_view path) const
+{
+  // Invariant: [low, high) is a range of complete lines that contains the
+  // entry, if any.
+  size_t low = 0;
+  size_t high = m_data.size();
+  while (low < high) {
+    size_t start = low + (high - low) / 2;
+    while (start > low && m_data[start - 1] != '\n') {
+      --start;
+    }
+    size_t end = m_data.find('\n', start);
+    if (end == std::string_view::npos || end > high) {
+      end = high;
+    }
+
+    const auto fields = split_line(m_data.substr(start, end - start));
+    if (!fields) {
+      return std::nullopt;
+    }
+    const auto& [head, entry_path] = *fields;
+    const int cmp = path.compare(entry_path);
+    if (cmp < 0) {
+      high = start;
+    } else if (cmp > 0) {
+      low = end + 1;
+    } else {
+      const auto fields = Util::split_into_views(head, " ");
+      if (fields.size() != k_fields_before_path) {
+        return std::nullopt;
+      }
+      const auto digest = parse_digest(fields[0]);
+      const auto size = util::parse_unsigned(fields[1]);
+      const auto mtime = util::parse_signed(fields[2]);
+      const auto ctime = util::parse_signed(fields[3]);
+      const auto device = util::parse_unsigned(fields[4]);
+      const auto inode = util::parse_unsigned(fields[5]);
+      if (!digest || !size || !mtime || !ctime || !device || !inode) {
+        return std::nullopt;
+      }
+      return Entry{*digest, *size, *mtime, *ctime, *device, *inode};
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<Digest>
+DigestMap::get(const std::string& path)
+{
+  const auto entry = find(path);
+  if (!entry) {
+    ++m_misses;
+    return std::nullopt;
+  }
+  const auto stat = Stat::stat(path);
+  // Like the inode cache, require the same file identity and status change
+  // time to catch same-size rewrites within the mtime granularity.
+  if (!stat || stat.size() != entry->size
+      || stat.mtime().nsec() != entry->mtime
+      || stat.ctime().nsec() != entry->ctime || stat.device() != entry->device
+      || stat.inode() != entry->inode) {
+    LOG("Digest map entry for {} is stale", path);
+    ++m_misses;
+    return std::nullopt;
+  }
+  ++m_hits;
+  return entry->digest;
+}
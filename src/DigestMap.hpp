@@ -0,0 +1,88 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include "Digest.hpp"
+#include "NonCopyable.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// A digest map is a text file, typically written by a build system that
+// already knows the content digests of its inputs, that lets ccache skip
+// reading and hashing those files. Each line has the format
+//
+//     <digest> <size> <mtime> <ctime> <device> <inode> <path>
+//
+// where <digest> is the BLAKE3 hash of the file content as 40 hexadecimal
+// digits (the hash truncated to 160 bits), <size> is the file size in bytes,
+// <mtime> and <ctime> are the modification and status change times in
+// nanoseconds since the epoch, <device> and <inode> identify the file and
+// <path> is the absolute path of the file. The lines must be sorted bytewise by
+// path since the file is mapped into memory and binary searched instead of
+// parsed.
+class DigestMap : NonCopyable
+{
+public:
+  struct Entry
+  {
+    Digest digest;
+    uint64_t size;
+    int64_t mtime; // Nanoseconds since the epoch.
+    int64_t ctime; // Nanoseconds since the epoch.
+    uint64_t device;
+    uint64_t inode;
+  };
+
+  // Map the digest map in `path`. Lookups in the map miss if it can't be read.
+  explicit DigestMap(const std::string& path);
+  ~DigestMap();
+
+  // Return the entry for `path`, if any.
+  std::optional<Entry> find(std::string_view path) const;
+
+  // Return the digest of `path` if the map has an entry for it with the same
+  // size, mtime, ctime, device and inode as the file on disk. Counts a hit or
+  // miss.
+  std::optional<Digest> get(const std::string& path);
+
+  uint64_t hits() const;
+  uint64_t misses() const;
+
+private:
+  std::string_view m_data;
+  void* m_mapping = nullptr;
+  std::string m_buffer; // Used instead of m_mapping if mmap isn't available.
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+};
+
+inline uint64_t
+DigestMap::hits() const
+{
+  return m_hits;
+}
+
+inline uint64_t
+DigestMap::misses() const
+{
+  return m_misses;
+}
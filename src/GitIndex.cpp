@@ -0,0 +1,392 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "GitIndex.hpp"
+
+#include "Fd.hpp"
+#include "Hash.hpp"
+#include "Logging.hpp"
+#include "Stat.hpp"
+#include "Util.hpp"
+#include "fmtmacros.hpp"
+
+#include <core/wincompat.hpp>
+#include <util/file.hpp>
+#include <util/path.hpp>
+#include <util/string.hpp>
+
+#include <fcntl.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+// See gitformat-index(5) for a description of the index format.
+
+namespace {
+
+const size_t k_sha1_oid_size = 20;
+const size_t k_sha256_oid_size = 32;
+
+// Size of the stat data (ctime, mtime, dev, ino, mode, uid, gid and size).
+const size_t k_stat_data_size = 10 * 4;
+
+const uint16_t k_flag_assume_valid = 0x8000;
+const uint16_t k_flag_extended = 0x4000;
+const uint16_t k_flag_stage_mask = 0x3000;
+const uint16_t k_extended_flag_skip_worktree = 0x4000;
+const uint16_t k_extended_flag_intent_to_add = 0x2000;
+
+const uint32_t k_mode_type_mask = 0170000;
+const uint32_t k_mode_type_regular = 0100000;
+
+#ifdef HAVE_SYS_MMAN_H
+const void* MMAP_FAILED = reinterpret_cast<void*>(-1); // NOLINT: Must cast here
+#endif
+
+template<typename T>
+T
+read_int(std::string_view data, size_t pos)
+{
+  T value;
+  Util::big_endian_to_int(reinterpret_cast<const uint8_t*>(&data[pos]), value);
+  return value;
+}
+
+int64_t
+to_nsec(uint32_t sec, uint32_t nsec)
+{
+  return int64_t{sec} * 1'000'000'000 + nsec;
+}
+
+// Find the git directory of the work tree that contains `dir`. Returns the
+// work tree and the git directory.
+std::optional<std::pair<std::string, std::string>>
+find_git_dir(std::string dir)
+{
+  while (true) {
+    const auto dot_git = FMT("{}/.git", dir);
+    const auto stat = Stat::stat(dot_git);
+    if (stat.is_directory()) {
+      return std::make_pair(dir, dot_git);
+    }
+    if (stat.is_regular()) {
+      // A linked work tree or a submodule.
+      const auto content = util::read_file<std::string>(dot_git);
+      if (!content || !util::starts_with(*content, "gitdir: ")) {
+        return std::nullopt;
+      }
+      const auto git_dir = util::strip_whitespace(content->substr(8));
+      return std::make_pair(dir,
+                            util::is_absolute_path(git_dir)
+                              ? git_dir
+                              : FMT("{}/{}", dir, git_dir));
+    }
+    const auto parent = std::string(Util::dir_name(dir));
+    if (parent == dir) {
+      return std::nullopt;
+    }
+    dir = parent;
+  }
+}
+
+size_t
+get_oid_size(const std::string& git_dir)
+{
+  // Linked work trees share configuration with the main work tree.
+  std::string common_dir = git_dir;
+  const auto commondir = util::read_file<std::string>(git_dir + "/commondir");
+  if (commondir) {
+    const auto path = util::strip_whitespace(*commondir);
+    common_dir = util::is_absolute_path(path) ? path
+                                              : FMT("{}/{}", git_dir, path);
+  }
+
+  const auto config = util::read_file<std::string>(common_dir + "/config");
+  if (config) {
+    for (const auto& line : Util::split_into_views(*config, "\n")) {
+      const auto stripped = util::strip_whitespace(line);
+      if (util::starts_with(Util::to_lowercase(stripped), "objectformat")
+          && stripped.find("sha256") != std::string::npos) {
+        return k_sha256_oid_size;
+      }
+    }
+  }
+  return k_sha1_oid_size;
+}
+
+} // namespace
+
+GitIndex::GitIndex(const std::string& dir) : m_dir(dir)
+{
+}
+
+GitIndex::~GitIndex()
+{
+#ifdef HAVE_SYS_MMAN_H
+  if (m_mapping) {
+    munmap(m_mapping, m_data.size());
+  }
+#endif
+}
+
+bool
+GitIndex::contains(const std::string& path)
+{
+  return find(path).has_value();
+}
+
+std::optional<Digest>
+GitIndex::get(const std::string& path)
+{
+  const auto entry = find(path);
+  if (!entry) {
+    return std::nullopt;
+  }
+
+  // Like git, only trust the entry if the stat data is unchanged.
+  const auto stat = Stat::stat(path);
+  if (!stat.is_regular() || stat.ctime().nsec() != entry->ctime
+      || stat.mtime().nsec() != entry->mtime
+      || static_cast<uint32_t>(stat.inode()) != entry->inode
+      || static_cast<uint32_t>(stat.size()) != entry->size) {
+    return std::nullopt;
+  }
+
+  Hash hash;
+  hash.hash_delimiter("git_blob");
+  hash.hash(entry->oid);
+  return hash.digest();
+}
+
+std::optional<GitIndex::Entry>
+GitIndex::find(const std::string& path)
+{
+  if (!m_read) {
+    m_read = true;
+    read_index();
+  }
+  if (m_entries.empty()) {
+    return std::nullopt;
+  }
+
+  const auto normalized_path = Util::normalize_concrete_absolute_path(path);
+  if (!util::starts_with(normalized_path, m_work_tree)
+      || normalized_path.length() <= m_work_tree.length()
+      || normalized_path[m_work_tree.length()] != '/') {
+    return std::nullopt;
+  }
+  const auto name =
+    std::string_view(normalized_path).substr(m_work_tree.length() + 1);
+
+  // Entries are sorted by name in memcmp order, which is also the order of
+  // std::string_view comparison.
+  const std::string_view names = m_version == 4 ? m_names : m_data;
+  const auto get_name = [&](const EntryLocation& location) {
+    return names.substr(location.name_offset, location.name_length);
+  };
+  const auto it = std::lower_bound(
+    m_entries.begin(), m_entries.end(), name, [&](const auto& location, auto n) {
+      return get_name(location) < n;
+    });
+  if (it == m_entries.end() || get_name(*it) != name) {
+    return std::nullopt;
+  }
+
+  size_t pos = it->offset;
+  const auto ctime_sec = read_int<uint32_t>(m_data, pos);
+  const auto ctime_nsec = read_int<uint32_t>(m_data, pos + 4);
+  const auto mtime_sec = read_int<uint32_t>(m_data, pos + 8);
+  const auto mtime_nsec = read_int<uint32_t>(m_data, pos + 12);
+  const auto inode = read_int<uint32_t>(m_data, pos + 20);
+  const auto mode = read_int<uint32_t>(m_data, pos + 24);
+  const auto size = read_int<uint32_t>(m_data, pos + 36);
+  pos += k_stat_data_size;
+  const auto oid = m_data.substr(pos, m_oid_size);
+  pos += m_oid_size;
+  const auto flags = read_int<uint16_t>(m_data, pos);
+  pos += 2;
+  const auto extended_flags =
+    flags & k_flag_extended ? read_int<uint16_t>(m_data, pos) : 0;
+
+  const int64_t mtime = to_nsec(mtime_sec, mtime_nsec);
+  if ((flags & (k_flag_assume_valid | k_flag_stage_mask))
+      || (extended_flags
+          & (k_extended_flag_skip_worktree | k_extended_flag_intent_to_add))
+      || (mode & k_mode_type_mask) != k_mode_type_regular
+      || mtime >= m_index_mtime) {
+    return std::nullopt;
+  }
+  return Entry{to_nsec(ctime_sec, ctime_nsec), mtime, inode, size, oid};
+}
+
+bool
+GitIndex::map_index(const std::string& path)
+{
+#ifdef HAVE_SYS_MMAN_H
+  Fd fd(open(path.c_str(), O_RDONLY));
+  if (!fd) {
+    return false;
+  }
+  const off_t size = lseek(*fd, 0, SEEK_END);
+  if (size <= 0) {
+    return false;
+  }
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, *fd, 0);
+  if (mapping == MMAP_FAILED) {
+    LOG("Failed to mmap {}: {}", path, strerror(errno));
+    return false;
+  }
+  m_mapping = mapping;
+  m_data = std::string_view(static_cast<const char*>(mapping), size);
+#else
+  auto data = util::read_file<std::string>(path);
+  if (!data) {
+    return false;
+  }
+  m_buffer = std::move(*data);
+  m_data = m_buffer;
+#endif
+  return true;
+}
+
+void
+GitIndex::read_index()
+{
+  const auto dirs = find_git_dir(m_dir);
+  if (!dirs) {
+    LOG("Not using git index: {} is not in a git work tree", m_dir);
+    return;
+  }
+  const auto& [work_tree, git_dir] = *dirs;
+  const auto oid_size = get_oid_size(git_dir);
+  const auto path = FMT("{}/index", git_dir);
+
+  // Stat the index before reading it so that a concurrently written index is
+  // seen as older, which only makes more entries racily clean.
+  const auto index_stat = Stat::stat(path);
+  if (!index_stat || !map_index(path)) {
+    LOG("Failed to read git index {}", path);
+    return;
+  }
+  const auto data = m_data;
+
+  if (data.size() < 12 || data.substr(0, 4) != "DIRC") {
+    LOG("{} is not a git index", path);
+    return;
+  }
+  const auto version = read_int<uint32_t>(data, 4);
+  const auto count = read_int<uint32_t>(data, 8);
+  if (version < 2 || version > 4) {
+    LOG("Unsupported git index version {} in {}", version, path);
+    return;
+  }
+  if (data.size() > UINT32_MAX) {
+    LOG("Too large git index {}", path);
+    return;
+  }
+
+  std::vector<EntryLocation> entries;
+  entries.reserve(count);
+  std::string names;
+  size_t pos = 12;
+  for (uint32_t i = 0; i < count; ++i) {
+    const size_t entry_start = pos;
+    if (pos + k_stat_data_size + oid_size + 2 > data.size()) {
+      LOG("Truncated git index {}", path);
+      return;
+    }
+    pos += k_stat_data_size + oid_size;
+    const auto flags = read_int<uint16_t>(data, pos);
+    pos += 2;
+    if (flags & k_flag_extended) {
+      if (version < 3 || pos + 2 > data.size()) {
+        LOG("Invalid git index entry in {}", path);
+        return;
+      }
+      pos += 2;
+    }
+
+    size_t name_offset = pos;
+    size_t name_length;
+    if (version == 4) {
+      // The name is prefix compressed: an offset encoded number of bytes to
+      // remove from the previous name followed by the rest of the name.
+      if (pos >= data.size()) {
+        LOG("Truncated git index {}", path);
+        return;
+      }
+      uint8_t c = data[pos++];
+      size_t remove = c & 0x7f;
+      while (c & 0x80) {
+        if (pos >= data.size()) {
+          LOG("Truncated git index {}", path);
+          return;
+        }
+        c = data[pos++];
+        remove = ((remove + 1) << 7) | (c & 0x7f);
+      }
+      const auto previous =
+        entries.empty() ? EntryLocation{0, 0, 0} : entries.back();
+      if (remove > previous.name_length) {
+        LOG("Invalid git index entry in {}", path);
+        return;
+      }
+      const size_t name_end = data.find('\0', pos);
+      if (name_end == std::string_view::npos) {
+        LOG("Truncated git index {}", path);
+        return;
+      }
+      const size_t prefix_length = previous.name_length - remove;
+      name_offset = names.size();
+      name_length = prefix_length + (name_end - pos);
+      names.reserve(names.size() + name_length);
+      names.append(names.data() + previous.name_offset, prefix_length);
+      names.append(data.data() + pos, name_end - pos);
+      pos = name_end + 1;
+    } else {
+      const size_t name_end = data.find('\0', pos);
+      if (name_end == std::string_view::npos) {
+        LOG("Truncated git index {}", path);
+        return;
+      }
+      name_length = name_end - pos;
+      // The entry is padded with 1-8 NUL bytes to a multiple of eight bytes.
+      pos = entry_start + ((name_end - entry_start + 8) & ~size_t{7});
+    }
+
+    entries.push_back(EntryLocation{static_cast<uint32_t>(entry_start),
+                                    static_cast<uint32_t>(name_offset),
+                                    static_cast<uint32_t>(name_length)});
+  }
+
+  LOG("Found {} entries in git index {}", entries.size(), path);
+  m_work_tree = work_tree;
+  m_version = version;
+  m_oid_size = oid_size;
+  m_index_mtime = index_stat.mtime().nsec();
+  m_names = std::move(names);
+  m_entries = std::move(entries);
+}
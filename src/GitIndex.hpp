@@ -0,0 +1,89 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include "Digest.hpp"
+#include "NonCopyable.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The index (staging area) of a git work tree. The index records the blob
+// object ID of each tracked file together with its stat data, so a file whose
+// stat data still matches its entry has the content of that blob and doesn't
+// have to be read to be hashed.
+//
+// Only version 2, 3 and 4 indexes are supported. Entries that git itself
+// would consider racily clean, i.e. modified at or after the time the index
+// was written, are never trusted.
+//
+// The index is mapped into memory and binary searched since its entries are
+// sorted by path. Only the locations of the entries are collected up front.
+class GitIndex : NonCopyable
+{
+public:
+  // Use the index of the work tree that contains `dir`, if any. The index is
+  // read on first use.
+  explicit GitIndex(const std::string& dir);
+  ~GitIndex();
+
+  // Return whether `path` (absolute) is tracked in the index.
+  bool contains(const std::string& path);
+
+  // Return a digest derived from the blob object ID of `path` (absolute) if
+  // the file is tracked and its stat data matches the index entry.
+  std::optional<Digest> get(const std::string& path);
+
+private:
+  struct Entry
+  {
+    int64_t ctime; // Nanoseconds since the epoch.
+    int64_t mtime; // Nanoseconds since the epoch.
+    uint32_t inode;
+    uint32_t size;
+    std::string_view oid;
+  };
+
+  struct EntryLocation
+  {
+    uint32_t offset;      // Offset of the entry in m_data.
+    uint32_t name_offset; // Offset of the name in m_data, or in m_names for
+                          // version 4 indexes.
+    uint32_t name_length;
+  };
+
+  std::string m_dir;
+  bool m_read = false;
+  std::string m_work_tree;
+  std::string_view m_data;
+  void* m_mapping = nullptr;
+  std::string m_buffer; // Used instead of m_mapping if mmap isn't available.
+  uint32_t m_version = 0;
+  size_t m_oid_size = 0;
+  int64_t m_index_mtime = 0;
+  std::string m_names; // Names of a version 4 index, which are compressed.
+  std::vector<EntryLocation> m_entries;
+
+  void read_index();
+  bool map_index(const std::string& path);
+  std::optional<Entry> find(const std::string& path);
+};
@@ -0,0 +1,114 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "IncludePrefetcher.hpp"
+
+#include "Fd.hpp"
+#include "Hash.hpp"
+#include "Logging.hpp"
+#include "hashutil.hpp"
+
+#include <core/wincompat.hpp>
+#include <util/file.hpp>
+
+#include <fcntl.h>
+
+IncludePrefetcher::IncludePrefetcher(std::vector<std::string> paths)
+  : m_paths(std::move(paths)),
+    m_thread(&IncludePrefetcher::hash_files, this)
+{
+}
+
+IncludePrefetcher::~IncludePrefetcher()
+{
+  m_stop = true;
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+void
+IncludePrefetcher::stop()
+{
+  if (!m_thread.joinable()) {
+    return;
+  }
+  m_stop = true;
+  m_thread.join();
+  LOG("Prefetched {} of {} include files", m_files.size(), m_paths.size());
+}
+
+std::optional<IncludePrefetcher::Entry>
+IncludePrefetcher::get(const std::string& path) const
+{
+  if (m_thread.joinable()) {
+    return std::nullopt;
+  }
+  const auto it = m_files.find(path);
+  if (it == m_files.end()) {
+    return std::nullopt;
+  }
+
+  const auto& stat = it->second.stat;
+  const auto current_stat = Stat::stat(path);
+  if (!current_stat.same_inode_as(stat) || current_stat.size() != stat.size()
+      || current_stat.mtime() != stat.mtime()
+      || current_stat.ctime() != stat.ctime()) {
+    return std::nullopt;
+  }
+  return it->second.entry;
+}
+
+void
+IncludePrefetcher::hash_files()
+{
+  for (const auto& path : m_paths) {
+    if (m_stop) {
+      break;
+    }
+    auto stat = Stat::stat(path);
+    if (!stat.is_regular()) {
+      continue;
+    }
+    // Read the file like util::read_file but without logging errors.
+    Fd fd(open(path.c_str(), O_RDONLY | O_TEXT));
+    if (!fd) {
+      continue;
+    }
+    std::string data;
+    data.reserve(stat.size());
+    if (!util::read_fd(*fd, [&](const uint8_t* buffer, size_t size) {
+          data.append(reinterpret_cast<const char*>(buffer), size);
+        })) {
+      continue;
+    }
+#ifdef _WIN32
+    if (data.size() > 1 && static_cast<uint8_t>(data[0]) == 0xff
+        && static_cast<uint8_t>(data[1]) == 0xfe) {
+      // Leave conversion of UTF-16 to util::read_file.
+      continue;
+    }
+#endif
+    Hash hash;
+    hash.hash(data);
+    m_files.emplace(
+      path,
+      PrefetchedFile{std::move(stat),
+                     Entry{hash.digest(), check_for_temporal_macros(data)}});
+  }
+}
@@ -0,0 +1,71 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include "Digest.hpp"
+#include "NonCopyable.hpp"
+#include "Stat.hpp"
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Hashes include files in a background thread, typically the ones listed in
+// the manifest while the preprocessor runs, so that the digests are ready when
+// the preprocessed output has been read.
+//
+// The background thread must not log or touch anything shared, so it only
+// stats, reads and hashes the files like do_hash_file in hashutil.cpp.
+class IncludePrefetcher : NonCopyable
+{
+public:
+  struct Entry
+  {
+    Digest digest;
+    int result; // HASH_SOURCE_CODE_* flags from check_for_temporal_macros.
+  };
+
+  explicit IncludePrefetcher(std::vector<std::string> paths);
+  ~IncludePrefetcher();
+
+  // Stop hashing and wait for the background thread to finish the current
+  // file. Must be called before get() returns anything.
+  void stop();
+
+  // Return the prefetched entry for `path` if the file has not changed since
+  // it was hashed.
+  std::optional<Entry> get(const std::string& path) const;
+
+private:
+  struct PrefetchedFile
+  {
+    Stat stat;
+    Entry entry;
+  };
+
+  const std::vector<std::string> m_paths;
+  std::unordered_map<std::string, PrefetchedFile> m_files;
+  std::atomic<bool> m_stop{false};
+  std::thread m_thread;
+
+  void hash_files();
+};
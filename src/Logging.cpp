@@ -42,8 +42,13 @@
 #  endif
 #endif
 
+#include <mutex>
+
 namespace {
 
+// Serializes logging from helper threads, e.g. the one renewing a remote lease.
+std::mutex log_mutex;
+
 // Logfile path and file handle, read from Config::log_file().
 std::string logfile_path;
 File logfile;
@@ -77,6 +82,7 @@ print_fatal_error_and_exit()
 void
 do_log(std::string_view message, bool bulk)
 {
+  std::lock_guard<std::mutex> lock(log_mutex);
   static char prefix[200];
 
   if (!bulk) {
@@ -180,10 +186,12 @@ dump_log(const std::string& path)
   if (!enabled()) {
     return;
   }
+  std::unique_lock<std::mutex> lock(log_mutex);
   File file(path, "w");
   if (file) {
     (void)fwrite(debug_log_buffer.data(), debug_log_buffer.length(), 1, *file);
   } else {
+    lock.unlock();
     LOG("Failed to open {}: {}", path, strerror(errno));
   }
 }
@@ -18,10 +18,37 @@
 
 #pragma once
 
+#include "TraceRing.hpp"
+
 #include "third_party/minitrace.h"
 
 #include <string>
 
+// Span events are also recorded in the trace ring if one is active, so they are
+// available without ENABLE_TRACING.
+#undef MTR_BEGIN
+#undef MTR_END
+#undef MTR_SCOPE
+#ifdef MTR_ENABLED
+#  define MTR_BEGIN(c, n)                                                      \
+    do {                                                                       \
+      TraceRing::record_event('B', c, n);                                      \
+      internal_mtr_raw_event(c, n, 'B', 0);                                    \
+    } while (false)
+#  define MTR_END(c, n)                                                        \
+    do {                                                                       \
+      TraceRing::record_event('E', c, n);                                      \
+      internal_mtr_raw_event(c, n, 'E', 0);                                    \
+    } while (false)
+#  define MTR_SCOPE(c, n)                                                      \
+    TraceRingScope ____trace_ring_scope(c, n);                                 \
+    MTRScopedTrace ____mtr_scope(c, n)
+#else
+#  define MTR_BEGIN(c, n) TraceRing::record_event('B', c, n)
+#  define MTR_END(c, n) TraceRing::record_event('E', c, n)
+#  define MTR_SCOPE(c, n) TraceRingScope ____trace_ring_scope(c, n)
+#endif
+
 struct ArgsInfo;
 
 class MiniTrace
@@ -122,30 +122,16 @@ SignalHandler::~SignalHandler()
 
 #endif // !_WIN32
 
-void
-SignalHandler::block_signals()
+SignalHandlerBlocker::SignalHandlerBlocker()
 {
 #ifndef _WIN32
-  sigprocmask(SIG_BLOCK, &g_fatal_signal_set, nullptr);
+  sigprocmask(SIG_BLOCK, &g_fatal_signal_set, &m_previous_mask);
 #endif
 }
 
-void
-SignalHandler::unblock_signals()
+SignalHandlerBlocker::~SignalHandlerBlocker()
 {
 #ifndef _WIN32
-  sigset_t empty;
-  sigemptyset(&empty);
-  sigprocmask(SIG_SETMASK, &empty, nullptr);
+  sigprocmask(SIG_SETMASK, &m_previous_mask, nullptr);
 #endif
 }
-
-SignalHandlerBlocker::SignalHandlerBlocker()
-{
-  SignalHandler::block_signals();
-}
-
-SignalHandlerBlocker::~SignalHandlerBlocker()
-{
-  SignalHandler::unblock_signals();
-}
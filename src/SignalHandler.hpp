@@ -18,6 +18,10 @@
 
 #pragma once
 
+#ifndef _WIN32
+#  include <signal.h> // NOLINT: sigset_t is defined in signal.h
+#endif
+
 class Context;
 
 class SignalHandler
@@ -27,8 +31,6 @@ public:
   ~SignalHandler();
 
   static void on_signal(int signum);
-  static void block_signals();
-  static void unblock_signals();
 
 private:
   Context& m_ctx;
@@ -39,4 +41,11 @@ class SignalHandlerBlocker
 public:
   SignalHandlerBlocker();
   ~SignalHandlerBlocker();
+
+private:
+#ifndef _WIN32
+  // The signal mask is inherited and may already block signals, so restore it
+  // instead of unblocking everything.
+  sigset_t m_previous_mask;
+#endif
 };
@@ -25,13 +25,52 @@
 #include <core/exceptions.hpp>
 #include <core/wincompat.hpp>
 #include <fmtmacros.hpp>
+#include <util/IoUring.hpp>
 
 #ifdef _WIN32
 #  include <third_party/win32/winerror_to_errno.h>
 #endif
 
+#ifdef HAVE_IO_URING_STATX
+#  include <sys/sysmacros.h>
+#endif
+
 namespace {
 
+#ifdef HAVE_IO_URING_STATX
+
+timespec
+statx_timestamp_to_timespec(const struct statx_timestamp& timestamp)
+{
+  timespec ts;
+  ts.tv_sec = timestamp.tv_sec;
+  ts.tv_nsec = timestamp.tv_nsec;
+  return ts;
+}
+
+Stat::stat_t
+statx_to_stat(const struct statx& stx)
+{
+  Stat::stat_t st;
+  memset(&st, 0, sizeof(st));
+  st.st_dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+  st.st_ino = stx.stx_ino;
+  st.st_mode = stx.stx_mode;
+  st.st_nlink = stx.stx_nlink;
+  st.st_uid = stx.stx_uid;
+  st.st_gid = stx.stx_gid;
+  st.st_rdev = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+  st.st_size = stx.stx_size;
+  st.st_blksize = stx.stx_blksize;
+  st.st_blocks = stx.stx_blocks;
+  st.st_atim = statx_timestamp_to_timespec(stx.stx_atime);
+  st.st_mtim = statx_timestamp_to_timespec(stx.stx_mtime);
+  st.st_ctim = statx_timestamp_to_timespec(stx.stx_ctime);
+  return st;
+}
+
+#endif
+
 #ifdef _WIN32
 
 uint16_t
@@ -225,6 +264,10 @@ Stat::Stat(StatFunction stat_function,
   }
 }
 
+Stat::Stat(const stat_t& st) : m_stat(st), m_errno(0)
+{
+}
+
 Stat
 Stat::stat(const std::string& path, OnError on_error)
 {
@@ -250,3 +293,31 @@ Stat::lstat(const std::string& path, OnError on_error)
     path,
     on_error);
 }
+
+std::vector<Stat>
+Stat::stat_batch(const std::vector<std::string>& paths)
+{
+  std::vector<Stat> result;
+  result.reserve(paths.size());
+
+#ifdef HAVE_IO_URING_STATX
+  auto* io_uring = util::IoUring::instance();
+  std::vector<struct statx> buffers(io_uring ? paths.size() : 0);
+  const auto results =
+    io_uring ? io_uring->statx(paths, buffers) : std::nullopt;
+  if (results) {
+    for (size_t i = 0; i < paths.size(); ++i) {
+      // Redo failed calls to get the same behavior (e.g. for unsupported
+      // operations on old kernels) and errno as for a plain stat call.
+      result.push_back((*results)[i] == 0 ? Stat(statx_to_stat(buffers[i]))
+                                          : Stat::stat(paths[i]));
+    }
+    return result;
+  }
+#endif
+
+  for (const auto& path : paths) {
+    result.push_back(Stat::stat(path));
+  }
+  return result;
+}
@@ -27,6 +27,7 @@
 #include <cstdint>
 #include <ctime>
 #include <string>
+#include <vector>
 
 #ifdef _WIN32
 #  ifndef S_IFIFO
@@ -112,6 +113,12 @@ public:
   static Stat lstat(const std::string& path,
                     OnError on_error = OnError::ignore);
 
+  // Run stat(2) for each of `paths` like stat() with OnError::ignore. The calls
+  // are submitted in batches via io_uring when available, which is much faster
+  // than one call at a time when the file system is slow, e.g. with cold
+  // dentry caches or network file systems.
+  static std::vector<Stat> stat_batch(const std::vector<std::string>& paths);
+
   // Return true if the file could be (l)stat-ed (i.e., the file exists),
   // otherwise false.
   operator bool() const;
@@ -151,6 +158,8 @@ private:
   stat_t m_stat;
   int m_errno;
 
+  explicit Stat(const stat_t& st);
+
   bool operator==(const Stat&) const;
   bool operator!=(const Stat&) const;
 };
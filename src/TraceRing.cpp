@@ -0,0 +1,292 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "TraceRing.hpp"
+
+#include "Fd.hpp"
+#include "Finalizer.hpp"
+#include "Logging.hpp"
+#include "TemporaryFile.hpp"
+#include "Util.hpp"
+#include "fmtmacros.hpp"
+
+#include <core/exceptions.hpp>
+#include <core/wincompat.hpp>
+#include <util/TimePoint.hpp>
+#include <util/string.hpp>
+
+#include <fcntl.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+// Events are stored in fixed-size records. A writer claims a record by
+// incrementing the shared event counter and then fills it in, guarded by a
+// sequence number so that readers can skip records that are being written.
+
+namespace {
+
+const uint32_t k_magic = 0x43435452; // "CCTR"
+
+// Note: Increment the version number if the record format or the constants
+// affecting storage size are changed.
+const uint32_t k_version = 1;
+const uint32_t k_num_records = 64 * 1024;
+
+struct Record
+{
+  // Index of the event plus one when the record is complete, otherwise 0.
+  std::atomic<uint64_t> sequence;
+  int64_t timestamp;
+  uint32_t pid;
+  char phase;
+  char category[19];
+  char name[24];
+};
+
+static_assert(sizeof(Record) == 64, "Unexpected size of Record");
+
+#ifdef HAVE_SYS_MMAN_H
+const void* MMAP_FAILED = reinterpret_cast<void*>(-1); // NOLINT: Must cast here
+#endif
+
+template<size_t N>
+void
+copy_string(char (&dest)[N], std::string_view src)
+{
+  const size_t length = std::min(src.length(), N - 1);
+  memcpy(dest, src.data(), length);
+  dest[length] = '\0';
+}
+
+} // namespace
+
+struct TraceRing::SharedRegion
+{
+  uint32_t magic;
+  uint32_t version;
+  std::atomic<uint64_t> next_index;
+  Record records[k_num_records];
+};
+
+TraceRing* TraceRing::s_active = nullptr;
+
+#ifdef HAVE_SYS_MMAN_H
+
+bool
+TraceRing::create_file(const std::string& path)
+{
+  // Create the new file to a temporary name to prevent other processes from
+  // mapping it before it is fully initialized.
+  TemporaryFile tmp_file(path);
+  Finalizer temp_file_remover([&] { unlink(tmp_file.path.c_str()); });
+
+  const size_t size = sizeof(SharedRegion);
+  const int err = Util::fallocate(*tmp_file.fd, size);
+  if (err) {
+    LOG("Failed to allocate file space for trace ring: {}", strerror(err));
+    return false;
+  }
+  void* sr =
+    mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, *tmp_file.fd, 0);
+  if (sr == MMAP_FAILED) {
+    LOG("Failed to mmap new trace ring: {}", strerror(errno));
+    return false;
+  }
+  auto header = static_cast<uint32_t*>(sr);
+  header[0] = k_magic;
+  header[1] = k_version;
+  munmap(sr, size);
+  tmp_file.fd.close();
+
+  // link() fails if another process created the file first, which is fine
+  // since that file will be used instead.
+  if (link(tmp_file.path.c_str(), path.c_str()) != 0 && errno != EEXIST) {
+    LOG("Failed to link new trace ring {}: {}", path, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+TraceRing::SharedRegion*
+TraceRing::map_file(const std::string& path, const bool writable)
+{
+  Fd fd(open(path.c_str(), writable ? O_RDWR : O_RDONLY));
+  if (!fd) {
+    return nullptr;
+  }
+  const size_t size = sizeof(SharedRegion);
+  void* sr = mmap(nullptr,
+                  size,
+                  writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                  MAP_SHARED,
+                  *fd,
+                  0);
+  if (sr == MMAP_FAILED) {
+    LOG("Failed to mmap {}: {}", path, strerror(errno));
+    return nullptr;
+  }
+  auto ring = static_cast<SharedRegion*>(sr);
+  if (lseek(*fd, 0, SEEK_END) != static_cast<off_t>(size)
+      || ring->magic != k_magic || ring->version != k_version) {
+    LOG("{} is not a trace ring of version {}", path, k_version);
+    munmap(sr, size);
+    return nullptr;
+  }
+  return ring;
+}
+
+TraceRing::TraceRing(const std::string& path)
+{
+  m_sr = map_file(path, true);
+  if (!m_sr && errno == ENOENT && create_file(path)) {
+    m_sr = map_file(path, true);
+  }
+  if (!m_sr) {
+    LOG("Failed to open trace ring {}", path);
+    return;
+  }
+  s_active = this;
+  record('B', "program", "ccache");
+}
+
+TraceRing::~TraceRing()
+{
+  if (s_active == this) {
+    record('E', "program", "ccache");
+    s_active = nullptr;
+  }
+  if (m_sr) {
+    munmap(m_sr, sizeof(SharedRegion));
+  }
+}
+
+void
+TraceRing::record(const char phase,
+                  const std::string_view category,
+                  const std::string_view name)
+{
+  const uint64_t index =
+    m_sr->next_index.fetch_add(1, std::memory_order_relaxed);
+  Record& record = m_sr->records[index % k_num_records];
+  record.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const auto now = util::TimePoint::now();
+  record.timestamp = now.sec() * 1'000'000'000 + now.nsec_decimal_part();
+  record.pid = static_cast<uint32_t>(getpid());
+  record.phase = phase;
+  copy_string(record.category, category);
+  copy_string(record.name, name);
+
+  record.sequence.store(index + 1, std::memory_order_release);
+}
+
+std::vector<TraceRing::Event>
+TraceRing::read_events(const std::string& path)
+{
+  SharedRegion* sr = map_file(path, false);
+  if (!sr) {
+    throw core::Error(FMT("Failed to read trace ring {}", path));
+  }
+  Finalizer unmapper([&] { munmap(sr, sizeof(SharedRegion)); });
+
+  std::vector<Event> events;
+  for (const auto& record : sr->records) {
+    const uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+    if (sequence == 0) {
+      continue;
+    }
+    Event event{record.timestamp,
+                record.pid,
+                record.phase,
+                std::string(record.category,
+                            strnlen(record.category, sizeof(record.category))),
+                std::string(record.name,
+                            strnlen(record.name, sizeof(record.name)))};
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (record.sequence.load(std::memory_order_relaxed) == sequence) {
+      events.push_back(std::move(event));
+    }
+  }
+
+  std::stable_sort(
+    events.begin(), events.end(), [](const Event& e1, const Event& e2) {
+      return e1.timestamp < e2.timestamp;
+    });
+  return events;
+}
+
+#else // HAVE_SYS_MMAN_H
+
+TraceRing::TraceRing(const std::string& path)
+{
+  LOG("Not using trace ring {}: not supported on this platform", path);
+}
+
+TraceRing::~TraceRing()
+{
+}
+
+void
+TraceRing::record(const char /*phase*/,
+                  const std::string_view /*category*/,
+                  const std::string_view /*name*/)
+{
+}
+
+std::vector<TraceRing::Event>
+TraceRing::read_events(const std::string& /*path*/)
+{
+  throw core::Error("trace rings are not supported on this platform");
+}
+
+#endif // HAVE_SYS_MMAN_H
+
+std::string
+TraceRing::format_chrome_trace(const std::vector<Event>& events)
+{
+  const int64_t start = events.empty() ? 0 : events.front().timestamp;
+  std::string result = "{\"traceEvents\":[\n";
+  for (size_t i = 0; i < events.size(); ++i) {
+    const auto& event = events[i];
+    const int64_t ns = event.timestamp - start;
+    result += FMT(
+      "{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"{}\",\"ts\":{}.{:03},"
+      "\"pid\":{},\"tid\":{}}}{}\n",
+      util::escape_json(event.name),
+      util::escape_json(event.category),
+      event.phase,
+      ns / 1000,
+      ns % 1000,
+      event.pid,
+      event.pid,
+      i + 1 < events.size() ? "," : "");
+  }
+  result += "]}\n";
+  return result;
+}
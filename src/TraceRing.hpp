@@ -0,0 +1,109 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include "NonCopyable.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A trace ring is a fixed-size file that is mapped into shared memory by all
+// ccache processes that trace to it. Each process appends span events (from
+// the MTR_* macros) to it, overwriting the oldest events when the ring is full.
+// Unlike MiniTrace, it's available in release builds and is enabled at runtime
+// with the trace_file configuration option.
+class TraceRing : NonCopyable
+{
+public:
+  struct Event
+  {
+    int64_t timestamp; // Nanoseconds since the epoch.
+    uint32_t pid;
+    char phase; // 'B' for begin or 'E' for end.
+    std::string category;
+    std::string name;
+  };
+
+  // Map the trace ring in `path`, creating it if needed, and make it the
+  // destination of record_event calls until destroyed. A "program" span
+  // covering the lifetime of the object is recorded as well. Does nothing if
+  // the ring can't be opened.
+  explicit TraceRing(const std::string& path);
+  ~TraceRing();
+
+  // Record an event in the active trace ring, if any.
+  static void
+  record_event(char phase, std::string_view category, std::string_view name);
+
+  // Read all complete events in the trace ring in `path`, sorted by time.
+  // Throws core::Error on failure.
+  static std::vector<Event> read_events(const std::string& path);
+
+  // Format `events` in the Chrome trace event format, which is also understood
+  // by Perfetto.
+  static std::string format_chrome_trace(const std::vector<Event>& events);
+
+private:
+  struct SharedRegion;
+
+  SharedRegion* m_sr = nullptr;
+
+  static TraceRing* s_active;
+
+  static bool create_file(const std::string& path);
+  static SharedRegion* map_file(const std::string& path, bool writable);
+
+  void record(char phase, std::string_view category, std::string_view name);
+};
+
+// Record a begin event now and an end event when going out of scope.
+class TraceRingScope : NonCopyable
+{
+public:
+  TraceRingScope(const char* category, const char* name);
+  ~TraceRingScope();
+
+private:
+  const char* m_category;
+  const char* m_name;
+};
+
+inline void
+TraceRing::record_event(char phase,
+                        std::string_view category,
+                        std::string_view name)
+{
+  if (s_active) {
+    s_active->record(phase, category, name);
+  }
+}
+
+inline TraceRingScope::TraceRingScope(const char* category, const char* name)
+  : m_category(category),
+    m_name(name)
+{
+  TraceRing::record_event('B', m_category, m_name);
+}
+
+inline TraceRingScope::~TraceRingScope()
+{
+  TraceRing::record_event('E', m_category, m_name);
+}
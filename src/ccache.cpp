@@ -23,10 +23,13 @@
 #include "ArgsInfo.hpp"
 #include "Context.hpp"
 #include "Depfile.hpp"
+#include "DigestMap.hpp"
+#include "GitIndex.hpp"
 #include "Fd.hpp"
 #include "File.hpp"
 #include "Finalizer.hpp"
 #include "Hash.hpp"
+#include "IncludePrefetcher.hpp"
 #include "Logging.hpp"
 #include "MiniTrace.hpp"
 #include "SignalHandler.hpp"
@@ -53,6 +56,7 @@
 #include <core/types.hpp>
 #include <core/wincompat.hpp>
 #include <storage/Storage.hpp>
+#include <util/LockFile.hpp>
 #include <util/expected.hpp>
 #include <util/file.hpp>
 #include <util/path.hpp>
@@ -73,6 +77,7 @@
 #include <cmath>
 #include <limits>
 #include <memory>
+#include <thread>
 
 using core::Statistic;
 
@@ -317,6 +322,28 @@ do_remember_include_file(Context& ctx,
     return true;
   }
 
+  for (const auto& ignore_header_path : ctx.ignore_header_paths) {
+    if (Util::matches_dir_prefix_or_file(ignore_header_path, path)) {
+      return true;
+    }
+  }
+
+  if (!Util::is_precompiled_header(path)) {
+    const auto immutable_digest = hash_immutable_include_file(ctx, path);
+    if (immutable_digest) {
+      // Below an immutable include root, so trust the root fingerprint instead
+      // of stat-ing and hashing the file.
+      if (ctx.config.direct_mode()) {
+        ctx.included_files.emplace(path, *immutable_digest);
+        if (depend_mode_hash) {
+          depend_mode_hash->hash_delimiter("include");
+          depend_mode_hash->hash(immutable_digest->to_string());
+        }
+      }
+      return true;
+    }
+  }
+
 #ifdef _WIN32
   {
     // stat fails on directories on win32.
@@ -342,12 +369,6 @@ do_remember_include_file(Context& ctx,
     return false;
   }
 
-  for (const auto& ignore_header_path : ctx.ignore_header_paths) {
-    if (Util::matches_dir_prefix_or_file(ignore_header_path, path)) {
-      return true;
-    }
-  }
-
   const bool is_pch = Util::is_precompiled_header(path);
   const bool too_new = include_file_too_new(ctx, path, st);
 
@@ -702,6 +723,7 @@ struct DoExecuteResult
   int exit_status;
   std::string stdout_data;
   std::string stderr_data;
+  ResourceUsage resource_usage;
 };
 
 // Execute the compiler/preprocessor, with logic to retry without requesting
@@ -719,10 +741,12 @@ do_execute(Context& ctx, Args& args, const bool capture_stdout = true)
   auto tmp_stdout = get_tmp_fd(ctx, "stdout", capture_stdout);
   auto tmp_stderr = get_tmp_fd(ctx, "stderr", true);
 
+  ResourceUsage resource_usage;
   int status = execute(ctx,
                        args.to_argv().data(),
                        std::move(tmp_stdout.fd),
-                       std::move(tmp_stderr.fd));
+                       std::move(tmp_stderr.fd),
+                       &resource_usage);
   if (status != 0 && !ctx.diagnostics_color_failed
       && ctx.config.compiler_type() == CompilerType::gcc) {
     const auto errors = util::read_file<std::string>(tmp_stderr.path);
@@ -738,7 +762,11 @@ do_execute(Context& ctx, Args& args, const bool capture_stdout = true)
       LOG_RAW("-fdiagnostics-color is unsupported; trying again without it");
 
       ctx.diagnostics_color_failed = true;
-      return do_execute(ctx, args, capture_stdout);
+      auto result = do_execute(ctx, args, capture_stdout);
+      if (result) {
+        result->resource_usage += resource_usage;
+      }
+      return result;
     }
   }
 
@@ -758,7 +786,43 @@ do_execute(Context& ctx, Args& args, const bool capture_stdout = true)
     return nonstd::make_unexpected(Statistic::missing_cache_file);
   }
 
-  return DoExecuteResult{status, stdout_data, *stderr_data_result};
+  return DoExecuteResult{
+    status, stdout_data, *stderr_data_result, resource_usage};
+}
+
+static uint64_t
+cpu_time_ms(const ResourceUsage& usage)
+{
+  return (usage.user_time + usage.system_time).nsec() / 1'000'000;
+}
+
+static void
+record_compiler_resource_usage(Context& ctx, const ResourceUsage& usage)
+{
+  const uint64_t mib = 1024 * 1024;
+  LOG("Compiler used {:.2f} s user time, {:.2f} s system time, {} MiB peak"
+      " memory, {} block reads and {} block writes",
+      static_cast<double>(usage.user_time.nsec()) / 1'000'000'000,
+      static_cast<double>(usage.system_time.nsec()) / 1'000'000'000,
+      usage.max_rss / mib,
+      usage.block_input_operations,
+      usage.block_output_operations);
+
+  auto& local = ctx.storage.local;
+  local.increment_statistic(Statistic::compiler_cpu_ms, cpu_time_ms(usage));
+  local.increment_statistic(Statistic::compiler_block_input,
+                            usage.block_input_operations);
+  local.increment_statistic(Statistic::compiler_block_output,
+                            usage.block_output_operations);
+  if (usage.max_rss < 256 * mib) {
+    local.increment_statistic(Statistic::compiler_peak_rss_below_256m);
+  } else if (usage.max_rss < 1024 * mib) {
+    local.increment_statistic(Statistic::compiler_peak_rss_below_1g);
+  } else if (usage.max_rss < 4096 * mib) {
+    local.increment_statistic(Statistic::compiler_peak_rss_below_4g);
+  } else {
+    local.increment_statistic(Statistic::compiler_peak_rss_4g_or_more);
+  }
 }
 
 static void
@@ -798,6 +862,11 @@ update_manifest(Context& ctx,
 
   const bool added = ctx.manifest.add_result(
     result_key, ctx.included_files, [&](const std::string& path) {
+      if (hash_immutable_include_file(ctx, path)) {
+        // The digest is enough to validate files below immutable roots.
+        return core::Manifest::FileStats{
+          0, util::TimePoint(), util::TimePoint()};
+      }
       auto stat = Stat::stat(path, Stat::OnError::log);
       bool cache_time =
         save_timestamp
@@ -811,9 +880,45 @@ update_manifest(Context& ctx,
   if (added) {
     LOG("Added result key to manifest {}", manifest_key.to_string());
     core::CacheEntry::Header header(ctx.config, core::CacheEntryType::manifest);
-    ctx.storage.put(manifest_key,
-                    core::CacheEntryType::manifest,
-                    core::CacheEntry::serialize(header, ctx.manifest));
+    if (ctx.inline_result) {
+      ctx.manifest.add_inline_result(result_key, *ctx.inline_result);
+    }
+    const auto remote_data = core::CacheEntry::serialize(header, ctx.manifest);
+
+    // Somebody else may have added results to the remote manifest since it
+    // was read, so merge with it instead of overwriting it if the remote
+    // storage supports that.
+    const auto merge_manifest = [&](nonstd::span<const uint8_t> current) {
+      core::Manifest merged;
+      try {
+        core::CacheEntry current_entry(current);
+        current_entry.verify_checksum();
+        merged.read(current_entry.payload());
+      } catch (const core::Error& e) {
+        LOG("Not merging with invalid remote manifest: {}", e.what());
+        return remote_data;
+      }
+      // Read our manifest last so that its inline results are kept.
+      merged.read(core::CacheEntry(remote_data).payload());
+      return core::CacheEntry::serialize(header, merged);
+    };
+
+    if (ctx.manifest.has_inline_results()) {
+      // Inline results are only useful for saving a round trip to remote
+      // storage, so don't waste space on them locally.
+      ctx.manifest.clear_inline_results();
+      ctx.storage.put(manifest_key,
+                      core::CacheEntryType::manifest,
+                      core::CacheEntry::serialize(header, ctx.manifest),
+                      remote_data,
+                      merge_manifest);
+    } else {
+      ctx.storage.put(manifest_key,
+                      core::CacheEntryType::manifest,
+                      remote_data,
+                      remote_data,
+                      merge_manifest);
+    }
   } else {
     LOG("Did not add result key to manifest {}", manifest_key.to_string());
   }
@@ -914,7 +1019,13 @@ write_result(Context& ctx,
   core::CacheEntry::Header header(ctx.config, core::CacheEntryType::result);
   const auto cache_entry_data = core::CacheEntry::serialize(header, serializer);
 
-  if (!ctx.config.remote_only()) {
+  if (ctx.config.direct_mode() && ctx.storage.has_remote_storage()
+      && header.self_contained
+      && cache_entry_data.size() <= ctx.config.remote_inline_max_size()) {
+    ctx.inline_result = cache_entry_data;
+  }
+
+  if (ctx.storage.puts_locally()) {
     const auto& raw_files = serializer.get_raw_files();
     if (!raw_files.empty()) {
       ctx.storage.local.put_raw_files(result_key, raw_files);
@@ -965,6 +1076,48 @@ rewrite_stdout_from_compiler(const Context& ctx, std::string&& stdout_data)
   }
 }
 
+// Acquire one of the max_concurrent_compiles machine-wide compile slots,
+// waiting for one to become free if needed.
+static std::unique_ptr<util::LongLivedLockFile>
+acquire_compile_slot(Context& ctx)
+{
+  MTR_SCOPE("execute", "compile_slot");
+
+  const uint32_t slots = ctx.config.max_concurrent_compiles();
+  // Start probing at a process-specific slot to spread out contention.
+  const uint32_t first_slot = static_cast<uint32_t>(getpid()) % slots;
+  std::optional<util::TimePoint> wait_start;
+  auto poll_interval = std::chrono::milliseconds(10);
+  while (true) {
+    for (uint32_t i = 0; i < slots; ++i) {
+      auto slot = std::make_unique<util::LongLivedLockFile>(
+        ctx.storage.local.get_compile_slot_path((first_slot + i) % slots));
+      // While waiting, only try (and log) slots that look free or stale.
+      if (wait_start && slot->held_by_active_process()) {
+        continue;
+      }
+      if (slot->try_acquire()) {
+        if (wait_start) {
+          const auto waited = util::TimePoint::now() - *wait_start;
+          LOG("Waited {}.{:03} s for a compile slot",
+              waited.sec(),
+              waited.nsec_decimal_part() / 1'000'000);
+          ctx.storage.local.increment_statistic(Statistic::compile_slot_wait);
+          ctx.storage.local.increment_statistic(
+            Statistic::compile_slot_wait_ms, waited.nsec() / 1'000'000);
+        }
+        return slot;
+      }
+    }
+    if (!wait_start) {
+      LOG("All {} compile slots are busy; waiting", slots);
+      wait_start = util::TimePoint::now();
+    }
+    std::this_thread::sleep_for(poll_interval);
+    poll_interval = std::min(2 * poll_interval, std::chrono::milliseconds(500));
+  }
+}
+
 // Run the real compiler and put the result in cache. Returns the result key.
 static nonstd::expected<Digest, Failure>
 to_cache(Context& ctx,
@@ -1014,6 +1167,16 @@ to_cache(Context& ctx,
     }
   }
 
+  std::unique_ptr<util::LongLivedLockFile> compile_slot;
+  Finalizer compile_slot_releaser([&] {
+    if (compile_slot) {
+      compile_slot->release();
+    }
+  });
+  if (ctx.config.max_concurrent_compiles() > 0) {
+    compile_slot = acquire_compile_slot(ctx);
+  }
+
   LOG_RAW("Running real compiler");
   MTR_BEGIN("execute", "compiler");
 
@@ -1034,10 +1197,20 @@ to_cache(Context& ctx,
   }
   MTR_END("execute", "compiler");
 
+  // Let other processes start compiling while the result is being stored.
+  if (compile_slot) {
+    compile_slot->release();
+  }
+
   if (!result) {
     return nonstd::make_unexpected(result.error());
   }
 
+  // A max RSS of zero means that the platform didn't report resource usage.
+  if (result->resource_usage.max_rss > 0) {
+    record_compiler_resource_usage(ctx, result->resource_usage);
+  }
+
   // Merge stderr from the preprocessor (if any) and stderr from the real
   // compiler.
   if (!ctx.cpp_stderr_data.empty()) {
@@ -1160,6 +1333,11 @@ get_result_key_from_cpp(Context& ctx, Args& args, Hash& hash)
     MTR_END("execute", "preprocessor");
     args.pop_back(args.size() - orig_args_size);
 
+    if (result) {
+      ctx.storage.local.increment_statistic(
+        Statistic::preprocessor_cpu_ms, cpu_time_ms(result->resource_usage));
+    }
+
     if (!result) {
       return nonstd::make_unexpected(result.error());
     } else if (result->exit_status != 0) {
@@ -1170,6 +1348,10 @@ get_result_key_from_cpp(Context& ctx, Args& args, Hash& hash)
     cpp_stderr_data = result->stderr_data;
   }
 
+  if (ctx.include_prefetcher) {
+    ctx.include_prefetcher->stop();
+  }
+
   hash.hash_delimiter("cpp");
   TRY(process_preprocessed_file(ctx, hash, preprocessed_path));
 
@@ -1579,7 +1761,8 @@ hash_argument(const Context& ctx,
       }
       return {};
     }
-    if (compopt_affects_cpp_output(args[i].substr(0, 2))) {
+    if (compopt_affects_cpp_output(
+          std::string_view(args[i]).substr(0, 2))) {
       return {};
     }
   }
@@ -1837,13 +2020,20 @@ get_result_key_from_manifest(Context& ctx, const Digest& manifest_key)
       }
     });
   MTR_END("manifest", "manifest_get");
-  if (read_manifests > 1 && !ctx.config.remote_only()) {
+  // A manifest copied from remote storage may contain inline results, which
+  // are not wanted locally.
+  if ((read_manifests > 1 || ctx.manifest.has_inline_results())
+      && !ctx.config.remote_only()) {
     MTR_SCOPE("manifest", "merge");
-    LOG("Storing merged manifest {} locally", manifest_key.to_string());
+    LOG("Storing {} manifest {} locally",
+        read_manifests > 1 ? "merged" : "stripped",
+        manifest_key.to_string());
     core::CacheEntry::Header header(ctx.config, core::CacheEntryType::manifest);
+    core::Manifest local_manifest = ctx.manifest;
+    local_manifest.clear_inline_results();
     ctx.storage.local.put(manifest_key,
                           core::CacheEntryType::manifest,
-                          core::CacheEntry::serialize(header, ctx.manifest));
+                          core::CacheEntry::serialize(header, local_manifest));
   }
 
   return result_key;
@@ -1977,13 +2167,23 @@ from_cache(Context& ctx, FromCacheCallMode mode, const Digest& result_key)
 
   MTR_SCOPE("cache", "from_cache");
 
-  // Get result from cache.
+  // Get result from cache, preferably from the manifest already fetched.
   util::Bytes cache_entry_data;
-  ctx.storage.get(
-    result_key, core::CacheEntryType::result, [&](util::Bytes&& value) {
-      cache_entry_data = std::move(value);
-      return true;
-    });
+  const auto inline_result = ctx.manifest.get_inline_result(result_key);
+  if (inline_result) {
+    LOG("Using result {} stored inline in manifest", result_key.to_string());
+    cache_entry_data = *inline_result;
+    if (!ctx.config.remote_only()) {
+      ctx.storage.local.put(
+        result_key, core::CacheEntryType::result, cache_entry_data, true);
+    }
+  } else {
+    ctx.storage.get(
+      result_key, core::CacheEntryType::result, [&](util::Bytes&& value) {
+        cache_entry_data = std::move(value);
+        return true;
+      });
+  }
   if (cache_entry_data.empty()) {
     return false;
   }
@@ -2008,6 +2208,102 @@ from_cache(Context& ctx, FromCacheCallMode mode, const Digest& result_key)
   return true;
 }
 
+// Look up the result stored by a concurrent compilation of the current input
+// that has finished. Returns the statistic to report if the result was found.
+static nonstd::expected<std::optional<Statistic>, Failure>
+look_up_leased_result(Context& ctx,
+                      const std::optional<Digest>& result_key,
+                      const std::optional<Digest>& manifest_key)
+{
+  const auto mode =
+    result_key ? FromCacheCallMode::cpp : FromCacheCallMode::direct;
+  const auto key = result_key ? result_key
+                              : get_result_key_from_manifest(ctx, *manifest_key);
+  if (!key) {
+    return std::nullopt;
+  }
+  const auto from_cache_result = from_cache(ctx, mode, *key);
+  if (!from_cache_result) {
+    return nonstd::make_unexpected(from_cache_result.error());
+  } else if (!*from_cache_result) {
+    return std::nullopt;
+  }
+  return mode == FromCacheCallMode::cpp ? Statistic::preprocessed_cache_hit
+                                        : Statistic::direct_cache_hit;
+}
+
+// Take a lease on `lease_key` in remote storage. If another host holds the
+// lease, poll until it's released or expires and then try to get the result it
+// stored. Returns the statistic to report if the result could be retrieved.
+static nonstd::expected<std::optional<Statistic>, Failure>
+acquire_remote_compile_lease(Context& ctx,
+                             const Digest& lease_key,
+                             const std::optional<Digest>& result_key,
+                             const std::optional<Digest>& manifest_key)
+{
+  const auto timeout = std::chrono::seconds(ctx.config.compile_lease_timeout());
+  switch (ctx.storage.acquire_remote_lease(lease_key, timeout)) {
+  case storage::Storage::LeaseResult::acquired:
+    ctx.storage.local.increment_statistic(Statistic::remote_lease_win);
+    return std::nullopt;
+  case storage::Storage::LeaseResult::unavailable:
+    return std::nullopt;
+  case storage::Storage::LeaseResult::held:
+    break;
+  }
+
+  LOG_RAW("Another host is compiling the same input; waiting for it");
+  ctx.storage.local.increment_statistic(Statistic::remote_lease_wait);
+  const auto deadline =
+    util::TimePoint::now() + util::Duration(ctx.config.compile_lease_timeout());
+  auto poll_interval = std::chrono::milliseconds(50);
+  while (ctx.storage.has_remote_lease(lease_key)) {
+    if (util::TimePoint::now() >= deadline) {
+      LOG_RAW("Timed out waiting for remote compilation");
+      ctx.storage.local.increment_statistic(Statistic::remote_lease_timeout);
+      return std::nullopt;
+    }
+    std::this_thread::sleep_for(poll_interval);
+    poll_interval =
+      std::min(2 * poll_interval, std::chrono::milliseconds(1000));
+  }
+
+  return look_up_leased_result(ctx, result_key, manifest_key);
+}
+
+// Acquire `lease`, which guards compilation of the current input on this
+// machine. If another process holds the lease, wait for it to finish and then
+// try to get the result it stored. Afterwards, coordinate with other hosts via
+// remote storage in the same way. Returns the statistic to report if the result
+// could be retrieved.
+static nonstd::expected<std::optional<Statistic>, Failure>
+acquire_compile_lease(Context& ctx,
+                      util::LockFile& lease,
+                      const Digest& lease_key,
+                      const std::optional<Digest>& result_key,
+                      const std::optional<Digest>& manifest_key)
+{
+  if (!lease.try_acquire()) {
+    LOG_RAW("Another process is compiling the same input; waiting for it");
+    ctx.storage.local.increment_statistic(Statistic::local_lease_wait);
+    if (!lease.try_acquire_for(
+          util::Duration(ctx.config.compile_lease_timeout()))) {
+      LOG_RAW("Timed out waiting for concurrent compilation");
+      ctx.storage.local.increment_statistic(Statistic::local_lease_timeout);
+      return std::nullopt;
+    }
+
+    // The lease holder has finished (or died), so check whether it stored a
+    // result.
+    const auto statistic = look_up_leased_result(ctx, result_key, manifest_key);
+    if (!statistic || *statistic) {
+      return statistic;
+    }
+  }
+
+  return acquire_remote_compile_lease(ctx, lease_key, result_key, manifest_key);
+}
+
 // Find the real compiler and put it into ctx.orig_args[0]. We just search the
 // PATH to find an executable of the same name that isn't ourselves.
 void
@@ -2069,6 +2365,30 @@ initialize(Context& ctx, int argc, const char* const* argv)
     LOG_RAW("Error: tracing is not enabled!");
 #endif
   }
+
+  if (!ctx.config.trace_file().empty()) {
+    ctx.trace_ring = std::make_unique<TraceRing>(ctx.config.trace_file());
+  }
+
+  // Files in the digest map or git index are never read, so they can't be
+  // checked for temporal macros.
+  const bool time_macros_sloppiness =
+    ctx.config.sloppiness().is_enabled(core::Sloppy::time_macros);
+  if (!ctx.config.digest_map().empty()) {
+    if (time_macros_sloppiness) {
+      ctx.digest_map = std::make_unique<DigestMap>(ctx.config.digest_map());
+    } else {
+      LOG("Not using digest map {} since sloppiness time_macros is not set",
+          ctx.config.digest_map());
+    }
+  }
+  if (ctx.config.git_index()) {
+    if (time_macros_sloppiness) {
+      ctx.git_index = std::make_unique<GitIndex>(ctx.actual_cwd);
+    } else {
+      LOG_RAW("Not using git index since sloppiness time_macros is not set");
+    }
+  }
 }
 
 // Make a copy of stderr that will not be cached, so things like distcc can
@@ -2135,6 +2455,13 @@ finalize_at_exit(Context& ctx)
     log_result_to_debug_log(ctx);
     log_result_to_stats_log(ctx);
 
+    if (ctx.digest_map) {
+      ctx.storage.local.increment_statistic(Statistic::digest_map_hit,
+                                            ctx.digest_map->hits());
+      ctx.storage.local.increment_statistic(Statistic::digest_map_miss,
+                                            ctx.digest_map->misses());
+    }
+
     ctx.storage.finalize();
   } catch (const core::ErrorBase& e) {
     // finalize_at_exit must not throw since it's called by a destructor.
@@ -2406,6 +2733,29 @@ do_cache_compilation(Context& ctx, const char* const* argv)
     } else {
       // Add result to manifest later.
       put_result_in_manifest = true;
+
+      // The include files are likely the same as the last time, so start
+      // hashing them while the preprocessor runs.
+      auto included_files = ctx.manifest.get_latest_included_files();
+      if (ctx.digest_map || ctx.git_index) {
+        // Files with known digests don't need to be hashed.
+        const auto is_known = [&](const std::string& path) {
+          const auto absolute_path = util::is_absolute_path(path)
+                                       ? path
+                                       : FMT("{}/{}", ctx.actual_cwd, path);
+          return (ctx.digest_map && ctx.digest_map->find(absolute_path))
+                 || (ctx.git_index && ctx.git_index->contains(absolute_path));
+        };
+        included_files.erase(std::remove_if(included_files.begin(),
+                                            included_files.end(),
+                                            is_known),
+                             included_files.end());
+      }
+      if (!included_files.empty() && !ctx.config.depend_mode()
+          && !ctx.args_info.direct_i_file) {
+        ctx.include_prefetcher =
+          std::make_unique<IncludePrefetcher>(std::move(included_files));
+      }
     }
 
     if (!ctx.config.recache()) {
@@ -2479,6 +2829,45 @@ do_cache_compilation(Context& ctx, const char* const* argv)
     return nonstd::make_unexpected(Statistic::cache_miss);
   }
 
+  // Let only one process at a time compile a given input. Others wait for the
+  // result instead of compiling it again.
+  std::optional<Digest> lease_key;
+  std::unique_ptr<util::LongLivedLockFile> compile_lease;
+  Finalizer compile_lease_releaser([&] {
+    if (lease_key) {
+      ctx.storage.release_remote_lease(*lease_key);
+    }
+    if (compile_lease) {
+      compile_lease->release();
+    }
+  });
+  if (ctx.config.compile_lease_timeout() > 0 && !ctx.config.recache()) {
+    ASSERT(result_key || manifest_key);
+    lease_key = result_key ? *result_key : *manifest_key;
+    compile_lease = std::make_unique<util::LongLivedLockFile>(
+      ctx.storage.local.get_compile_lease_path(*lease_key));
+    const auto statistic = acquire_compile_lease(
+      ctx, *compile_lease, *lease_key, result_key, manifest_key);
+    if (!statistic) {
+      return nonstd::make_unexpected(statistic.error());
+    } else if (*statistic) {
+      if (**statistic == Statistic::preprocessed_cache_hit
+          && ctx.config.direct_mode() && manifest_key
+          && put_result_in_manifest) {
+        MTR_SCOPE("cache", "update_manifest");
+        update_manifest(ctx, *manifest_key, *result_key);
+      }
+      return **statistic;
+    }
+  }
+
+  if (!ctx.config.remote_only() && !ctx.config.recache()) {
+    ASSERT(result_key || manifest_key);
+    if (!ctx.storage.local.admit(manifest_key ? *manifest_key : *result_key)) {
+      ctx.storage.skip_local_puts();
+    }
+  }
+
   add_prefix(ctx, processed.compiler_args, ctx.config.prefix_command());
 
   // In depend_mode, extend the direct hash.
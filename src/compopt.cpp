@@ -18,9 +18,9 @@
 
 #include "compopt.hpp"
 
-#include "fmtmacros.hpp"
-
-#include "third_party/fmt/core.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
 
 // The option it too hard to handle at all.
 #define TOO_HARD (1 << 0)
@@ -45,15 +45,15 @@
 // The option only affects compilation; not passed to the preprocessor.
 #define AFFECTS_COMP (1 << 6)
 
-#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+namespace {
 
 struct CompOpt
 {
-  const char* name;
+  std::string_view name;
   int type;
 };
 
-const CompOpt compopts[] = {
+constexpr CompOpt compopts[] = {
   {"--Werror", TAKES_ARG},                             // nvcc
   {"--analyze", TOO_HARD},                             // Clang
   {"--compiler-bindir", AFFECTS_CPP | TAKES_ARG},      // nvcc
@@ -158,122 +158,278 @@ const CompOpt compopts[] = {
   {"-z", TAKES_ARG | TAKES_CONCAT_ARG | AFFECTS_COMP},
 };
 
-static int
-compare_compopts(const void* key1, const void* key2)
+constexpr size_t k_num_compopts = std::size(compopts);
+
+constexpr bool
+compopts_are_sorted()
+{
+  for (size_t i = 1; i < k_num_compopts; ++i) {
+    if (compopts[i - 1].name >= compopts[i].name) {
+      return false;
+    }
+  }
+  return true;
+}
+
+constexpr bool
+compopts_have_valid_flags()
+{
+  for (const auto& compopt : compopts) {
+    if (compopt.type & TOO_HARD && compopt.type & TAKES_CONCAT_ARG) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(compopts_are_sorted(),
+              "compopts must be sorted and must not contain duplicates");
+static_assert(compopts_have_valid_flags(),
+              "type (TOO_HARD | TAKES_CONCAT_ARG) not allowed");
+
+// The options are looked up in a perfect hash table computed at compile time
+// using the "hash and displace" method: the hash of an option selects a bucket
+// and the bucket's displacement then selects a slot that no other option uses.
+
+constexpr size_t k_bucket_bits = 6;
+constexpr size_t k_num_buckets = size_t(1) << k_bucket_bits;
+constexpr size_t k_num_slots = 256; // Must be a power of two.
+constexpr size_t k_max_displacement = 256;
+
+static_assert(k_num_compopts < k_num_slots / 2, "too few hash table slots");
+
+// FNV-1a, which can be computed incrementally for prefixes of a string.
+constexpr uint64_t k_fnv_offset_basis = 14695981039346656037U;
+constexpr uint64_t k_fnv_prime = 1099511628211U;
+
+constexpr uint64_t
+hash_step(uint64_t hash, char c)
 {
-  const CompOpt* opt1 = static_cast<const CompOpt*>(key1);
-  const CompOpt* opt2 = static_cast<const CompOpt*>(key2);
-  return strcmp(opt1->name, opt2->name);
+  return (hash ^ static_cast<uint8_t>(c)) * k_fnv_prime;
 }
 
-static int
-compare_prefix_compopts(const void* key1, const void* key2)
+constexpr uint64_t
+hash_name(std::string_view name)
 {
-  const CompOpt* opt1 = static_cast<const CompOpt*>(key1);
-  const CompOpt* opt2 = static_cast<const CompOpt*>(key2);
-  return strncmp(opt1->name, opt2->name, strlen(opt2->name));
+  uint64_t hash = k_fnv_offset_basis;
+  for (const char c : name) {
+    hash = hash_step(hash, c);
+  }
+  return hash;
 }
 
-static const CompOpt*
-find(const std::string& option)
+constexpr size_t
+bucket_index(uint64_t hash)
 {
-  CompOpt key;
-  key.name = option.c_str();
-  void* result = bsearch(&key,
-                         compopts,
-                         ARRAY_SIZE(compopts),
-                         sizeof(compopts[0]),
-                         compare_compopts);
-  return static_cast<CompOpt*>(result);
+  // Use the high bits since the low bits select the slot.
+  return hash >> (64 - k_bucket_bits);
 }
 
-static const CompOpt*
-find_prefix(const std::string& option)
+constexpr size_t
+slot_index(uint64_t hash, size_t displacement)
 {
-  CompOpt key;
-  key.name = option.c_str();
-  void* result = bsearch(&key,
-                         compopts,
-                         ARRAY_SIZE(compopts),
-                         sizeof(compopts[0]),
-                         compare_prefix_compopts);
-  return static_cast<CompOpt*>(result);
+  // An odd step visits all slots since the number of slots is a power of two.
+  return (hash + displacement * ((hash >> 32) | 1)) & (k_num_slots - 1);
 }
 
-// Used by unittest/test_compopt.cpp.
-bool compopt_verify_sortedness_and_flags();
+struct HashTable
+{
+  std::array<uint8_t, k_num_buckets> displacements{};
+  std::array<int16_t, k_num_slots> slots{}; // Index in compopts or -1.
+  bool complete = false;
+};
 
-// For test purposes.
-bool
-compopt_verify_sortedness_and_flags()
+constexpr HashTable
+build_hash_table()
+{
+  HashTable table;
+  for (auto& slot : table.slots) {
+    slot = -1;
+  }
+
+  std::array<uint64_t, k_num_compopts> hashes{};
+  std::array<size_t, k_num_buckets> bucket_sizes{};
+  size_t max_bucket_size = 0;
+  for (size_t i = 0; i < k_num_compopts; ++i) {
+    hashes[i] = hash_name(compopts[i].name);
+    const size_t size = ++bucket_sizes[bucket_index(hashes[i])];
+    max_bucket_size = std::max(max_bucket_size, size);
+  }
+
+  // Place the largest buckets first since they are the hardest to fit.
+  for (size_t size = max_bucket_size; size > 0; --size) {
+    for (size_t bucket = 0; bucket < k_num_buckets; ++bucket) {
+      if (bucket_sizes[bucket] != size) {
+        continue;
+      }
+      size_t displacement = 0;
+      for (; displacement < k_max_displacement; ++displacement) {
+        bool fits = true;
+        for (size_t i = 0; i < k_num_compopts && fits; ++i) {
+          if (bucket_index(hashes[i]) == bucket) {
+            auto& slot = table.slots[slot_index(hashes[i], displacement)];
+            if (slot == -1) {
+              slot = static_cast<int16_t>(i);
+            } else {
+              fits = false;
+            }
+          }
+        }
+        if (fits) {
+          break;
+        }
+        // Undo the partial placement of this bucket.
+        for (auto& slot : table.slots) {
+          if (slot != -1
+              && bucket_index(hashes[static_cast<size_t>(slot)]) == bucket) {
+            slot = -1;
+          }
+        }
+      }
+      if (displacement == k_max_displacement) {
+        return table;
+      }
+      table.displacements[bucket] = static_cast<uint8_t>(displacement);
+    }
+  }
+
+  table.complete = true;
+  return table;
+}
+
+constexpr HashTable k_hash_table = build_hash_table();
+
+static_assert(k_hash_table.complete, "failed to build perfect hash table");
+
+constexpr const CompOpt*
+find(uint64_t hash, std::string_view option)
 {
-  for (size_t i = 0; i < ARRAY_SIZE(compopts); i++) {
-    if (compopts[i].type & TOO_HARD && compopts[i].type & TAKES_CONCAT_ARG) {
-      PRINT(stderr,
-            "type (TOO_HARD | TAKES_CONCAT_ARG) not allowed, used by {}\n",
-            compopts[i].name);
+  const size_t displacement = k_hash_table.displacements[bucket_index(hash)];
+  const int16_t index = k_hash_table.slots[slot_index(hash, displacement)];
+  if (index == -1 || compopts[index].name != option) {
+    return nullptr;
+  }
+  return &compopts[index];
+}
+
+constexpr const CompOpt*
+find(std::string_view option)
+{
+  return find(hash_name(option), option);
+}
+
+constexpr bool
+compopts_are_found()
+{
+  for (const auto& compopt : compopts) {
+    if (find(compopt.name) != &compopt) {
       return false;
     }
+  }
+  return true;
+}
 
-    if (i == 0) {
-      continue;
+static_assert(compopts_are_found(), "perfect hash table is inconsistent");
+
+// Bit N is set if there is an option of length N that takes a concatenated
+// argument, i.e. that can be a prefix of an argument.
+constexpr uint64_t
+compute_prefix_lengths()
+{
+  uint64_t lengths = 0;
+  for (const auto& compopt : compopts) {
+    if (compopt.type & TAKES_CONCAT_ARG) {
+      lengths |= uint64_t(1) << compopt.name.length();
     }
+  }
+  return lengths;
+}
 
-    if (strcmp(compopts[i - 1].name, compopts[i].name) >= 0) {
-      PRINT(stderr,
-            "compopt_verify_sortedness: {} >= {}\n",
-            compopts[i - 1].name,
-            compopts[i].name);
+constexpr uint64_t k_prefix_lengths = compute_prefix_lengths();
+constexpr size_t k_max_prefix_length = 63;
+
+constexpr bool
+compopt_prefixes_are_short()
+{
+  for (const auto& compopt : compopts) {
+    if (compopt.type & TAKES_CONCAT_ARG
+        && compopt.name.length() > k_max_prefix_length) {
       return false;
     }
   }
   return true;
 }
 
+static_assert(compopt_prefixes_are_short(),
+              "too long option taking a concatenated argument");
+
+// Find the longest option that takes a concatenated argument and is a prefix
+// of `option`. The hash is computed incrementally, so only option lengths that
+// exist in the table cost a (single) table lookup.
+const CompOpt*
+find_prefix(std::string_view option)
+{
+  const CompOpt* result = nullptr;
+  uint64_t hash = k_fnv_offset_basis;
+  const size_t max_length = std::min(option.length(), k_max_prefix_length);
+  for (size_t length = 1; length <= max_length; ++length) {
+    hash = hash_step(hash, option[length - 1]);
+    if (k_prefix_lengths & (uint64_t(1) << length)) {
+      const CompOpt* co = find(hash, option.substr(0, length));
+      if (co && (co->type & TAKES_CONCAT_ARG)) {
+        result = co;
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace
+
 bool
-compopt_affects_cpp_output(const std::string& option)
+compopt_affects_cpp_output(std::string_view option)
 {
   const CompOpt* co = find(option);
   return co && (co->type & AFFECTS_CPP);
 }
 
 bool
-compopt_affects_compiler_output(const std::string& option)
+compopt_affects_compiler_output(std::string_view option)
 {
   const CompOpt* co = find(option);
   return co && (co->type & AFFECTS_COMP);
 }
 
 bool
-compopt_too_hard(const std::string& option)
+compopt_too_hard(std::string_view option)
 {
   const CompOpt* co = find(option);
   return co && (co->type & TOO_HARD);
 }
 
 bool
-compopt_too_hard_for_direct_mode(const std::string& option)
+compopt_too_hard_for_direct_mode(std::string_view option)
 {
   const CompOpt* co = find(option);
   return co && (co->type & TOO_HARD_DIRECT);
 }
 
 bool
-compopt_takes_path(const std::string& option)
+compopt_takes_path(std::string_view option)
 {
   const CompOpt* co = find(option);
   return co && (co->type & TAKES_PATH);
 }
 
 bool
-compopt_takes_arg(const std::string& option)
+compopt_takes_arg(std::string_view option)
 {
   const CompOpt* co = find(option);
   return co && (co->type & TAKES_ARG);
 }
 
 bool
-compopt_takes_concat_arg(const std::string& option)
+compopt_takes_concat_arg(std::string_view option)
 {
   const CompOpt* co = find(option);
   return co && (co->type & TAKES_CONCAT_ARG);
@@ -282,7 +438,7 @@ compopt_takes_concat_arg(const std::string& option)
 // Determines if the prefix of the option matches any option and affects the
 // preprocessor.
 bool
-compopt_prefix_affects_cpp_output(const std::string& option)
+compopt_prefix_affects_cpp_output(std::string_view option)
 {
   // Prefix options have to take concatenated args.
   const CompOpt* co = find_prefix(option);
@@ -292,7 +448,7 @@ compopt_prefix_affects_cpp_output(const std::string& option)
 // Determines if the prefix of the option matches any option and affects the
 // preprocessor.
 bool
-compopt_prefix_affects_compiler_output(const std::string& option)
+compopt_prefix_affects_compiler_output(std::string_view option)
 {
   // Prefix options have to take concatenated args.
   const CompOpt* co = find_prefix(option);
@@ -18,16 +18,14 @@
 
 #pragma once
 
-#include <string>
+#include <string_view>
 
-bool compopt_short(bool (*fn)(const std::string& option),
-                   const std::string& option);
-bool compopt_affects_cpp_output(const std::string& option);
-bool compopt_affects_compiler_output(const std::string& option);
-bool compopt_too_hard(const std::string& option);
-bool compopt_too_hard_for_direct_mode(const std::string& option);
-bool compopt_takes_path(const std::string& option);
-bool compopt_takes_arg(const std::string& option);
-bool compopt_takes_concat_arg(const std::string& option);
-bool compopt_prefix_affects_cpp_output(const std::string& option);
-bool compopt_prefix_affects_compiler_output(const std::string& option);
+bool compopt_affects_cpp_output(std::string_view option);
+bool compopt_affects_compiler_output(std::string_view option);
+bool compopt_too_hard(std::string_view option);
+bool compopt_too_hard_for_direct_mode(std::string_view option);
+bool compopt_takes_path(std::string_view option);
+bool compopt_takes_arg(std::string_view option);
+bool compopt_takes_concat_arg(std::string_view option);
+bool compopt_prefix_affects_cpp_output(std::string_view option);
+bool compopt_prefix_affects_compiler_output(std::string_view option);
@@ -0,0 +1,170 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "AccessTrace.hpp"
+
+#include <Digest.hpp>
+#include <Fd.hpp>
+#include <Logging.hpp>
+#include <Stat.hpp>
+#include <Util.hpp>
+#include <core/exceptions.hpp>
+#include <core/wincompat.hpp>
+#include <fmtmacros.hpp>
+#include <util/TimePoint.hpp>
+#include <util/file.hpp>
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+// Event format (big-endian):
+//
+// <event>     ::= <timestamp> <type> <kind> <reserved> <key> <size> <cost>
+// <timestamp> ::= uint32_t ; seconds since the epoch
+// <type>      ::= uint8_t ; core::CacheEntryType
+// <kind>      ::= uint8_t ; AccessTrace::Kind
+// <reserved>  ::= uint16_t ; zero
+// <key>       ::= uint64_t ; first 8 bytes of the cache entry key
+// <size>      ::= uint32_t ; size of the cache entry in bytes (saturated)
+// <cost>      ::= uint32_t ; compiler CPU time in milliseconds
+
+namespace core {
+
+namespace {
+
+void
+serialize_event(const AccessTrace::Event& event, uint8_t* buffer)
+{
+  Util::int_to_big_endian(event.timestamp, buffer);
+  Util::int_to_big_endian(static_cast<uint8_t>(event.type), buffer + 4);
+  Util::int_to_big_endian(static_cast<uint8_t>(event.kind), buffer + 5);
+  Util::int_to_big_endian(uint16_t{0}, buffer + 6);
+  Util::int_to_big_endian(event.key, buffer + 8);
+  Util::int_to_big_endian(event.size, buffer + 16);
+  Util::int_to_big_endian(event.cost, buffer + 20);
+}
+
+AccessTrace::Event
+deserialize_event(const uint8_t* buffer)
+{
+  AccessTrace::Event event;
+  uint8_t type;
+  uint8_t kind;
+  Util::big_endian_to_int(buffer, event.timestamp);
+  Util::big_endian_to_int(buffer + 4, type);
+  Util::big_endian_to_int(buffer + 5, kind);
+  Util::big_endian_to_int(buffer + 8, event.key);
+  Util::big_endian_to_int(buffer + 16, event.size);
+  Util::big_endian_to_int(buffer + 20, event.cost);
+  event.type = static_cast<CacheEntryType>(type);
+  event.kind = static_cast<AccessTrace::Kind>(kind);
+  return event;
+}
+
+} // namespace
+
+AccessTrace::Event
+AccessTrace::make_event(const Digest& key,
+                        const CacheEntryType type,
+                        const Kind kind,
+                        const uint64_t size,
+                        const uint32_t cost)
+{
+  Event event;
+  event.timestamp = static_cast<uint32_t>(util::TimePoint::now().sec());
+  event.type = type;
+  event.kind = kind;
+  Util::big_endian_to_int(key.bytes(), event.key);
+  event.size = static_cast<uint32_t>(
+    std::min<uint64_t>(size, std::numeric_limits<uint32_t>::max()));
+  event.cost = cost;
+  return event;
+}
+
+uint64_t
+AccessTrace::event_count() const
+{
+  return Stat::stat(m_path).size() / k_event_size;
+}
+
+void
+AccessTrace::read(const EventReceiver& event_receiver) const
+{
+  Fd fd(open(m_path.c_str(), O_RDONLY | O_BINARY));
+  if (!fd) {
+    throw core::Error(FMT("Failed to open {}: {}", m_path, strerror(errno)));
+  }
+
+  // Data left over from the previous chunk that doesn't form a full event.
+  uint8_t partial[k_event_size];
+  size_t partial_size = 0;
+
+  const auto result =
+    util::read_fd(*fd, [&](const uint8_t* data, size_t size) {
+      if (partial_size > 0) {
+        const size_t n = std::min(k_event_size - partial_size, size);
+        memcpy(partial + partial_size, data, n);
+        partial_size += n;
+        data += n;
+        size -= n;
+        if (partial_size < k_event_size) {
+          return;
+        }
+        event_receiver(deserialize_event(partial));
+        partial_size = 0;
+      }
+      while (size >= k_event_size) {
+        event_receiver(deserialize_event(data));
+        data += k_event_size;
+        size -= k_event_size;
+      }
+      memcpy(partial, data, size);
+      partial_size = size;
+    });
+  if (!result) {
+    throw core::Error(FMT("Failed to read {}: {}", m_path, result.error()));
+  }
+}
+
+void
+AccessTrace::write(const std::vector<Event>& events)
+{
+  if (events.empty()) {
+    return;
+  }
+
+  std::vector<uint8_t> buffer(events.size() * k_event_size);
+  for (size_t i = 0; i < events.size(); ++i) {
+    serialize_event(events[i], &buffer[i * k_event_size]);
+  }
+
+  Fd fd(open(m_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_BINARY, 0666));
+  if (!fd) {
+    LOG("Failed to open {}: {}", m_path, strerror(errno));
+    return;
+  }
+  const auto result = util::write_fd(*fd, buffer.data(), buffer.size());
+  if (!result) {
+    LOG("Failed to write to {}: {}", m_path, result.error());
+  }
+}
+
+} // namespace core
@@ -0,0 +1,83 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <core/types.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class Digest;
+
+namespace core {
+
+// An access trace is a file with fixed-size binary records describing local
+// storage accesses, appended to by all ccache processes. It's used by
+// --simulate-size to predict the hit rate of other cache sizes.
+class AccessTrace
+{
+public:
+  enum class Kind : uint8_t { miss = 0, hit = 1, store = 2 };
+
+  struct Event
+  {
+    uint32_t timestamp; // Seconds since the epoch.
+    CacheEntryType type;
+    Kind kind;
+    uint64_t key; // First 64 bits of the cache entry key.
+    uint32_t size;
+    uint32_t cost; // Compiler CPU time in milliseconds, for stored results.
+  };
+
+  static constexpr size_t k_event_size = 24;
+
+  using EventReceiver = std::function<void(const Event& event)>;
+
+  AccessTrace(const std::string& path);
+
+  static Event make_event(const Digest& key,
+                          CacheEntryType type,
+                          Kind kind,
+                          uint64_t size,
+                          uint32_t cost = 0);
+
+  // Return the number of events in the trace.
+  uint64_t event_count() const;
+
+  // Call `event_receiver` for each event in the trace. Throws core::Error on
+  // failure.
+  void read(const EventReceiver& event_receiver) const;
+
+  // Append `events` in one write so that events from one process are kept
+  // together.
+  void write(const std::vector<Event>& events);
+
+private:
+  const std::string m_path;
+};
+
+// --- Inline implementations ---
+
+inline AccessTrace::AccessTrace(const std::string& path) : m_path(path)
+{
+}
+
+} // namespace core
@@ -0,0 +1,231 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "CacheSimulator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace core {
+
+namespace {
+
+// Keys are sampled by comparing their lowest bits with a threshold.
+const uint64_t k_sampling_modulus = 1 << 24;
+
+// Approximate number of events to simulate per cache size and policy.
+const uint64_t k_max_sampled_events = 1 << 23;
+
+const size_t k_ccache_shards = 16;
+
+} // namespace
+
+CacheSimulator::CacheSimulator(const Policy policy,
+                               const uint64_t max_size,
+                               const double limit_multiple)
+  : m_policy(policy),
+    m_max_size(max_size),
+    m_limit_multiple(limit_multiple),
+    m_shards(policy == Policy::ccache ? k_ccache_shards : 1)
+{
+}
+
+void
+CacheSimulator::process(const AccessTrace::Event& event,
+                        const double default_cost)
+{
+  const bool is_result = event.type == CacheEntryType::result;
+  auto& shard = shard_for(event.key);
+  auto it = m_entries.find(event.key);
+
+  if (event.kind == AccessTrace::Kind::store) {
+    if (it == m_entries.end()) {
+      insert(event.key, event.size, event.cost);
+    } else {
+      shard.size = shard.size - it->second.size + event.size;
+      it->second.size = event.size;
+      if (event.cost > 0) {
+        it->second.cost = event.cost;
+      }
+      touch(it->second, shard);
+    }
+
+    if (m_policy == Policy::ccache) {
+      // LocalStorage::finalize cleans up the subdirectory of a stored result
+      // if it has grown too large.
+      const uint64_t shard_max_size = m_max_size / k_ccache_shards;
+      if (is_result && shard.size > shard_max_size) {
+        evict(shard, std::llround(shard_max_size * m_limit_multiple));
+      }
+    } else if (shard.size > m_max_size) {
+      evict(shard, m_max_size);
+    }
+    return;
+  }
+
+  if (is_result) {
+    ++m_result.lookups;
+  }
+  if (it != m_entries.end()) {
+    if (is_result) {
+      ++m_result.hits;
+      m_result.saved_cost +=
+        it->second.cost > 0 ? it->second.cost : default_cost;
+    }
+    if (m_policy != Policy::fifo) {
+      touch(it->second, shard);
+    }
+  } else if (event.kind == AccessTrace::Kind::hit) {
+    // The real cache had the entry but the simulated one didn't, so a real
+    // compilation would have stored it again. (For real misses there will be a
+    // store event with the size.)
+    insert(event.key, event.size, 0);
+    if (m_policy != Policy::ccache && shard.size > m_max_size) {
+      evict(shard, m_max_size);
+    }
+  }
+}
+
+const char*
+CacheSimulator::policy_to_string(const Policy policy)
+{
+  switch (policy) {
+  case Policy::ccache:
+    return "ccache";
+
+  case Policy::lru:
+    return "lru";
+
+  case Policy::fifo:
+    return "fifo";
+
+  default:
+    return "unknown";
+  }
+}
+
+CacheSimulator::Shard&
+CacheSimulator::shard_for(const uint64_t key)
+{
+  // The first hex digit of the key selects the subdirectory in LocalStorage.
+  return m_shards.size() == 1 ? m_shards[0] : m_shards[key >> 60];
+}
+
+void
+CacheSimulator::insert(const uint64_t key,
+                       const uint32_t size,
+                       const uint32_t cost)
+{
+  auto& shard = shard_for(key);
+  shard.order.push_back(key);
+  shard.size += size;
+  m_entries.emplace(key, Entry{size, cost, std::prev(shard.order.end())});
+}
+
+void
+CacheSimulator::touch(Entry& entry, Shard& shard)
+{
+  shard.order.splice(shard.order.end(), shard.order, entry.position);
+}
+
+void
+CacheSimulator::evict(Shard& shard, const uint64_t target_size)
+{
+  while (shard.size > target_size && !shard.order.empty()) {
+    const auto it = m_entries.find(shard.order.front());
+    shard.size -= it->second.size;
+    m_entries.erase(it);
+    shard.order.pop_front();
+  }
+}
+
+SimulationReport
+simulate_cache_sizes(const AccessTrace& trace,
+                     const std::vector<uint64_t>& sizes,
+                     const double limit_multiple)
+{
+  SimulationReport report;
+
+  const uint64_t event_count = trace.event_count();
+  const uint64_t threshold =
+    event_count <= k_max_sampled_events
+      ? k_sampling_modulus
+      : std::max<uint64_t>(
+        1, k_sampling_modulus * k_max_sampled_events / event_count);
+  report.sampling_rate = static_cast<double>(threshold) / k_sampling_modulus;
+
+  std::vector<CacheSimulator> simulators;
+  simulators.reserve(sizes.size() * CacheSimulator::k_policies.size());
+  for (const auto size : sizes) {
+    for (const auto policy : CacheSimulator::k_policies) {
+      simulators.emplace_back(
+        policy, std::llround(size * report.sampling_rate), limit_multiple);
+    }
+  }
+
+  // Compile cost of results, used for hits of entries stored before the trace
+  // started.
+  uint64_t known_costs = 0;
+  double total_known_cost = 0.0;
+
+  trace.read([&](const AccessTrace::Event& event) {
+    if (report.events == 0) {
+      report.first_timestamp = event.timestamp;
+    }
+    report.last_timestamp = event.timestamp;
+    ++report.events;
+
+    const bool is_result = event.type == CacheEntryType::result;
+    if (is_result && event.kind == AccessTrace::Kind::store
+        && event.cost > 0) {
+      ++known_costs;
+      total_known_cost += event.cost;
+    }
+    const double default_cost =
+      known_costs > 0 ? total_known_cost / known_costs : 0.0;
+
+    if (is_result && event.kind != AccessTrace::Kind::store) {
+      ++report.observed.lookups;
+      if (event.kind == AccessTrace::Kind::hit) {
+        ++report.observed.hits;
+      }
+    }
+
+    if (event.key % k_sampling_modulus >= threshold) {
+      return;
+    }
+    for (auto& simulator : simulators) {
+      simulator.process(event, default_cost);
+    }
+  });
+
+  for (size_t i = 0; i < simulators.size(); ++i) {
+    auto result = simulators[i].result();
+    result.lookups = std::llround(result.lookups / report.sampling_rate);
+    result.hits = std::llround(result.hits / report.sampling_rate);
+    result.saved_cost /= report.sampling_rate;
+    const size_t n_policies = CacheSimulator::k_policies.size();
+    report.rows.push_back({sizes[i / n_policies],
+                           CacheSimulator::k_policies[i % n_policies],
+                           result});
+  }
+
+  return report;
+}
+
+} // namespace core
@@ -0,0 +1,132 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <core/AccessTrace.hpp>
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace core {
+
+// Simulates a local cache of a given size by replaying access trace events.
+class CacheSimulator
+{
+public:
+  enum class Policy {
+    // Like LocalStorage: 16 independently cleaned LRU subdirectories, each
+    // cleaned down to limit_multiple of its share when exceeding it.
+    ccache,
+    // Global LRU, evicting just enough to stay within the size.
+    lru,
+    // Global FIFO, i.e. hits don't protect entries from eviction.
+    fifo,
+  };
+
+  static constexpr std::array<Policy, 3> k_policies{
+    Policy::ccache, Policy::lru, Policy::fifo};
+
+  struct Result
+  {
+    uint64_t lookups = 0; // Result lookups.
+    uint64_t hits = 0;    // Result hits.
+    double saved_cost = 0.0;
+  };
+
+  CacheSimulator(Policy policy, uint64_t max_size, double limit_multiple);
+
+  // Process `event`. `default_cost` is used for hits of results whose compile
+  // cost is unknown.
+  void process(const AccessTrace::Event& event, double default_cost);
+
+  const Result& result() const;
+
+  static const char* policy_to_string(Policy policy);
+
+private:
+  struct Shard
+  {
+    std::list<uint64_t> order; // Least recently used first.
+    uint64_t size = 0;
+  };
+
+  struct Entry
+  {
+    uint32_t size;
+    uint32_t cost;
+    std::list<uint64_t>::iterator position;
+  };
+
+  const Policy m_policy;
+  const uint64_t m_max_size;
+  const double m_limit_multiple;
+  std::vector<Shard> m_shards;
+  std::unordered_map<uint64_t, Entry> m_entries;
+  Result m_result;
+
+  Shard& shard_for(uint64_t key);
+  void insert(uint64_t key, uint32_t size, uint32_t cost);
+  void touch(Entry& entry, Shard& shard);
+  void evict(Shard& shard, uint64_t target_size);
+};
+
+// Predicted outcome of replaying an access trace for a set of cache sizes.
+struct SimulationReport
+{
+  struct Row
+  {
+    uint64_t max_size;
+    CacheSimulator::Policy policy;
+    CacheSimulator::Result result;
+  };
+
+  uint64_t events = 0;
+  uint32_t first_timestamp = 0;
+  uint32_t last_timestamp = 0;
+
+  // Fraction of the keys that were simulated.
+  double sampling_rate = 1.0;
+
+  // What actually happened according to the trace (saved_cost is not set).
+  CacheSimulator::Result observed;
+
+  // Results are scaled up to compensate for sampling.
+  std::vector<Row> rows;
+};
+
+// Replay `trace` for each size in `sizes` and each policy. To keep time and
+// memory bounded for large traces, only a spatially hashed sample of the keys
+// is simulated in caches scaled down by the same factor, which approximates
+// the miss ratio curve well for reasonably large samples (SHARDS).
+SimulationReport simulate_cache_sizes(const AccessTrace& trace,
+                                      const std::vector<uint64_t>& sizes,
+                                      double limit_multiple);
+
+// --- Inline implementations ---
+
+inline const CacheSimulator::Result&
+CacheSimulator::result() const
+{
+  return m_result;
+}
+
+} // namespace core
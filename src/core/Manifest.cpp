@@ -21,6 +21,8 @@
 #include <Context.hpp>
 #include <Hash.hpp>
 #include <Logging.hpp>
+#include <Stat.hpp>
+#include <Util.hpp>
 #include <core/CacheEntryDataReader.hpp>
 #include <core/CacheEntryDataWriter.hpp>
 #include <core/exceptions.hpp>
@@ -28,12 +30,14 @@
 #include <hashutil.hpp>
 #include <util/XXH3_64.hpp>
 
+#include <algorithm>
+
 // Manifest data format
 // ====================
 //
 // Integers are big-endian.
 //
-// <payload>       ::= <format_ver> <paths> <includes> <results>
+// <payload>       ::= <format_ver> <paths> <includes> <results> <inlines>
 // <format_ver>    ::= uint8_t
 // <paths>         ::= <n_paths> <path_entry>*
 // <n_paths>       ::= uint32_t
@@ -54,9 +58,19 @@
 // <n_indexes>     ::= uint32_t
 // <include_index> ::= uint32_t
 // <result_key>    ::= Digest::size() bytes
+// <inlines>       ::= <n_inlines> <inline>* ; only in format version >= 2
+// <n_inlines>     ::= uint32_t
+// <inline>        ::= <result_key> <inline_size> <inline_data>
+// <inline_size>   ::= uint32_t
+// <inline_data>   ::= inline_size bytes ; result cache entry
 
 const uint32_t k_max_manifest_entries = 100;
 const uint32_t k_max_manifest_file_info_entries = 10000;
+const uint32_t k_max_manifest_inline_results = 4;
+
+// Minimum number of include files to stat in one batch. For fewer files, the
+// io_uring setup costs more than it saves.
+const size_t k_min_stat_batch_size = 8;
 
 namespace std {
 
@@ -76,13 +90,36 @@ template<> struct hash<core::Manifest::FileInfo>
 
 namespace core {
 
+namespace {
+
+Manifest::FileStats
+to_file_stats(const Stat& st)
+{
+  return {st.size(), st.mtime(), st.ctime()};
+}
+
+bool
+is_below_immutable_include_root(const Context& ctx, const std::string& path)
+{
+  return std::any_of(ctx.immutable_include_roots.begin(),
+                     ctx.immutable_include_roots.end(),
+                     [&](const auto& root) {
+                       return Util::matches_dir_prefix_or_file(root, path);
+                     });
+}
+
+} // namespace
+
 // Format version history:
 //
 // Version 0:
 //   - First version.
 // Version 1:
 //   - mtime and ctime are now stored with nanoseconds resolution.
-const uint8_t Manifest::k_format_version = 1;
+// Version 2:
+//   - Optional inline results. Manifests without inline results are still
+//     written in version 1 so that older ccache versions can read them.
+const uint8_t Manifest::k_format_version = 2;
 
 void
 Manifest::read(nonstd::span<const uint8_t> data)
@@ -94,7 +131,7 @@ Manifest::read(nonstd::span<const uint8_t> data)
   core::CacheEntryDataReader reader(data);
 
   const auto format_version = reader.read_int<uint8_t>();
-  if (format_version != k_format_version) {
+  if (format_version < 1 || format_version > k_format_version) {
     throw core::Error(FMT("Unknown manifest format version: {} != {}",
                           format_version,
                           k_format_version));
@@ -129,6 +166,15 @@ Manifest::read(nonstd::span<const uint8_t> data)
     reader.read_and_copy_bytes({entry.key.bytes(), Digest::size()});
   }
 
+  if (format_version >= 2) {
+    const auto inline_result_count = reader.read_int<uint32_t>();
+    for (uint32_t i = 0; i < inline_result_count; ++i) {
+      Digest key;
+      reader.read_and_copy_bytes({key.bytes(), Digest::size()});
+      add_inline_result(key, reader.read_bytes(reader.read_int<uint32_t>()));
+    }
+  }
+
   if (m_results.empty()) {
     m_files = std::move(files);
     m_file_infos = std::move(file_infos);
@@ -168,6 +214,66 @@ Manifest::look_up_result_digest(const Context& ctx) const
   return std::nullopt;
 }
 
+std::optional<nonstd::span<const uint8_t>>
+Manifest::get_inline_result(const Digest& result_key) const
+{
+  const auto it = std::find_if(
+    m_inline_results.begin(), m_inline_results.end(), [&](const auto& entry) {
+      return entry.key == result_key;
+    });
+  if (it == m_inline_results.end()) {
+    return std::nullopt;
+  }
+  return it->data;
+}
+
+void
+Manifest::add_inline_result(const Digest& result_key,
+                            nonstd::span<const uint8_t> value)
+{
+  const auto it = std::find_if(
+    m_inline_results.begin(), m_inline_results.end(), [&](const auto& entry) {
+      return entry.key == result_key;
+    });
+  if (it != m_inline_results.end()) {
+    m_inline_results.erase(it);
+  }
+  if (m_inline_results.size() >= k_max_manifest_inline_results) {
+    m_inline_results.erase(m_inline_results.begin());
+  }
+  m_inline_results.push_back({result_key, util::Bytes(value)});
+}
+
+bool
+Manifest::has_inline_results() const
+{
+  return !m_inline_results.empty();
+}
+
+void
+Manifest::clear_inline_results()
+{
+  m_inline_results.clear();
+}
+
+size_t
+Manifest::result_count() const
+{
+  return m_results.size();
+}
+
+std::vector<std::string>
+Manifest::get_latest_included_files() const
+{
+  std::vector<std::string> result;
+  if (!m_results.empty()) {
+    for (const auto index : m_results.back().file_info_indexes) {
+      result.push_back(m_files[m_file_infos[index].index]);
+    }
+  }
+  return result;
+}
+
 bool
 Manifest::add_result(
   const Digest& result_key,
@@ -242,6 +348,12 @@ Manifest::serialized_size() const
     size += result.file_info_indexes.size() * 4;
     size += Digest::size();
   }
+  if (!m_inline_results.empty()) {
+    size += 4; // n_inlines
+    for (const auto& inline_result : m_inline_results) {
+      size += Digest::size() + 4 + inline_result.data.size();
+    }
+  }
 
   // In order to support 32-bit ccache builds, restrict size to uint32_t for
   // now. This restriction can be lifted when we drop 32-bit support.
@@ -258,7 +370,7 @@ Manifest::serialize(util::Bytes& output)
 {
   core::CacheEntryDataWriter writer(output);
 
-  writer.write_int(k_format_version);
+  writer.write_int<uint8_t>(m_inline_results.empty() ? 1 : k_format_version);
   writer.write_int<uint32_t>(m_files.size());
   for (const auto& file : m_files) {
     writer.write_int<uint16_t>(file.length());
@@ -282,6 +394,15 @@ Manifest::serialize(util::Bytes& output)
     }
     writer.write_bytes({result.key.bytes(), Digest::size()});
   }
+
+  if (!m_inline_results.empty()) {
+    writer.write_int<uint32_t>(m_inline_results.size());
+    for (const auto& inline_result : m_inline_results) {
+      writer.write_bytes({inline_result.key.bytes(), Digest::size()});
+      writer.write_int<uint32_t>(inline_result.data.size());
+      writer.write_bytes(inline_result.data);
+    }
+  }
 }
 
 bool
@@ -339,6 +460,33 @@ Manifest::get_file_info_index(
   }
 }
 
+void
+Manifest::stat_in_batch(
+  const Context& ctx,
+  const ResultEntry& result,
+  std::unordered_map<std::string, FileStats>& stated_files) const
+{
+  std::vector<std::string> paths;
+  for (uint32_t file_info_index : result.file_info_indexes) {
+    const auto& path = m_files[m_file_infos[file_info_index].index];
+    if (stated_files.find(path) == stated_files.end()
+        && !is_below_immutable_include_root(ctx, path)) {
+      paths.push_back(path);
+    }
+  }
+  if (paths.size() < k_min_stat_batch_size) {
+    return;
+  }
+
+  const auto stats = Stat::stat_batch(paths);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    // Failures are left for result_matches to handle and log.
+    if (stats[i]) {
+      stated_files.emplace(paths[i], to_file_stats(stats[i]));
+    }
+  }
+}
+
 bool
 Manifest::result_matches(
   const Context& ctx,
@@ -346,21 +494,30 @@ Manifest::result_matches(
   std::unordered_map<std::string, FileStats>& stated_files,
   std::unordered_map<std::string, Digest>& hashed_files) const
 {
+  if (ctx.config.io_uring()) {
+    stat_in_batch(ctx, result, stated_files);
+  }
+
   for (uint32_t file_info_index : result.file_info_indexes) {
     const auto& fi = m_file_infos[file_info_index];
     const auto& path = m_files[fi.index];
 
+    const auto immutable_digest = hash_immutable_include_file(ctx, path);
+    if (immutable_digest) {
+      if (fi.digest != *immutable_digest) {
+        return false;
+      }
+      continue;
+    }
+
     auto stated_files_iter = stated_files.find(path);
     if (stated_files_iter == stated_files.end()) {
       auto file_stat = Stat::stat(path, Stat::OnError::log);
       if (!file_stat) {
         return false;
       }
-      FileStats st;
-      st.size = file_stat.size();
-      st.mtime = file_stat.mtime();
-      st.ctime = file_stat.ctime();
-      stated_files_iter = stated_files.emplace(path, st).first;
+      stated_files_iter =
+        stated_files.emplace(path, to_file_stats(file_stat)).first;
     }
     const FileStats& fs = stated_files_iter->second;
 
@@ -464,6 +621,15 @@ Manifest::inspect(FILE* const stream) const
     PRINT_RAW(stream, "\n");
     PRINT(stream, "    Key: {}\n", m_results[i].key.to_string());
   }
+
+  if (!m_inline_results.empty()) {
+    PRINT(stream, "Inline results ({}):\n", m_inline_results.size());
+    for (size_t i = 0; i < m_inline_results.size(); ++i) {
+      PRINT(stream, "  {}:\n", i);
+      PRINT(stream, "    Key: {}\n", m_inline_results[i].key.to_string());
+      PRINT(stream, "    Size: {}\n", m_inline_results[i].data.size());
+    }
+  }
 }
 
 } // namespace core
@@ -20,6 +20,7 @@
 
 #include <Digest.hpp>
 #include <core/Serializer.hpp>
+#include <util/Bytes.hpp>
 #include <util/TimePoint.hpp>
 
 #include <third_party/nonstd/span.hpp>
@@ -59,6 +60,24 @@ public:
                   const std::unordered_map<std::string, Digest>& included_files,
                   const FileStater& stat_file);
 
+  // Return the result cache entry stored inline for `result_key`, if any.
+  std::optional<nonstd::span<const uint8_t>>
+  get_inline_result(const Digest& result_key) const;
+
+  // Store the result cache entry `value` for `result_key` inline in the
+  // manifest. Only the most recently added inline results are kept.
+  void add_inline_result(const Digest& result_key,
+                         nonstd::span<const uint8_t> value);
+
+  bool has_inline_results() const;
+  void clear_inline_results();
+
+  // Return the number of results referenced by the manifest.
+  size_t result_count() const;
+
+  // Return the include files of the most recently added result.
+  std::vector<std::string> get_latest_included_files() const;
+
   // core::Serializer
   uint32_t serialized_size() const override;
   void serialize(util::Bytes& output) override;
@@ -87,9 +106,16 @@ private:
     bool operator==(const ResultEntry& other) const;
   };
 
+  struct InlineResult
+  {
+    Digest key;       // Key of the result.
+    util::Bytes data; // Result cache entry.
+  };
+
   std::vector<std::string> m_files;   // Names of referenced include files.
   std::vector<FileInfo> m_file_infos; // Info about referenced include files.
   std::vector<ResultEntry> m_results;
+  std::vector<InlineResult> m_inline_results; // Oldest first.
 
   void clear();
 
@@ -100,6 +126,13 @@ private:
     const std::unordered_map<FileInfo, uint32_t>& mf_file_infos,
     const FileStater& file_state);
 
+  // Stat the include files of `result` that are not in `stated_files` yet all
+  // at once instead of one at a time in result_matches.
+  void stat_in_batch(
+    const Context& ctx,
+    const ResultEntry& result,
+    std::unordered_map<std::string, FileStats>& stated_files) const;
+
   bool
   result_matches(const Context& ctx,
                  const ResultEntry& result,
@@ -65,6 +65,24 @@ enum class Statistic {
   remote_storage_timeout = 40,
   recache = 41,
   unsupported_environment_variable = 42,
+  local_lease_wait = 43,
+  local_lease_timeout = 44,
+  remote_lease_wait = 45,
+  remote_lease_win = 46,
+  remote_lease_timeout = 47,
+  compile_slot_wait = 48,
+  compile_slot_wait_ms = 49,
+  preprocessor_cpu_ms = 50,
+  compiler_cpu_ms = 51,
+  compiler_block_input = 52,
+  compiler_block_output = 53,
+  compiler_peak_rss_below_256m = 54,
+  compiler_peak_rss_below_1g = 55,
+  compiler_peak_rss_below_4g = 56,
+  compiler_peak_rss_4g_or_more = 57,
+  admission_rejected = 58,
+  digest_map_hit = 59,
+  digest_map_miss = 60,
 
   END
 };
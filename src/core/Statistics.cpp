@@ -35,6 +35,7 @@ const unsigned FLAG_NOZERO = 1U << 0;      // don't zero with --zero-stats
 const unsigned FLAG_NEVER = 1U << 1;       // don't include in --print-stats
 const unsigned FLAG_ERROR = 1U << 2;       // include in error count
 const unsigned FLAG_UNCACHEABLE = 1U << 3; // include in uncacheable count
+const unsigned FLAG_NOLOG = 1U << 4;       // don't include in result logging
 
 namespace {
 
@@ -66,6 +67,7 @@ struct StatisticsField
 
 const StatisticsField k_statistics_fields[] = {
   // Field "none" intentionally omitted.
+  FIELD(admission_rejected, nullptr),
   FIELD(autoconf_test, "Autoconf compile/link", FLAG_UNCACHEABLE),
   FIELD(bad_compiler_arguments, "Bad compiler arguments", FLAG_UNCACHEABLE),
   FIELD(bad_output_file, "Could not write to output file", FLAG_ERROR),
@@ -75,7 +77,16 @@ const StatisticsField k_statistics_fields[] = {
   FIELD(called_for_preprocessing, "Called for preprocessing", FLAG_UNCACHEABLE),
   FIELD(cleanups_performed, nullptr),
   FIELD(compile_failed, "Compilation failed", FLAG_UNCACHEABLE),
+  FIELD(compile_slot_wait, nullptr),
+  FIELD(compile_slot_wait_ms, nullptr, FLAG_NOLOG),
+  FIELD(compiler_block_input, nullptr, FLAG_NOLOG),
+  FIELD(compiler_block_output, nullptr, FLAG_NOLOG),
   FIELD(compiler_check_failed, "Compiler check failed", FLAG_ERROR),
+  FIELD(compiler_cpu_ms, nullptr, FLAG_NOLOG),
+  FIELD(compiler_peak_rss_4g_or_more, nullptr, FLAG_NOLOG),
+  FIELD(compiler_peak_rss_below_1g, nullptr, FLAG_NOLOG),
+  FIELD(compiler_peak_rss_below_256m, nullptr, FLAG_NOLOG),
+  FIELD(compiler_peak_rss_below_4g, nullptr, FLAG_NOLOG),
   FIELD(compiler_produced_empty_output,
         "Compiler produced empty output",
         FLAG_UNCACHEABLE),
@@ -88,6 +99,8 @@ const StatisticsField k_statistics_fields[] = {
   FIELD(could_not_use_precompiled_header,
         "Could not use precompiled header",
         FLAG_UNCACHEABLE),
+  FIELD(digest_map_hit, nullptr),
+  FIELD(digest_map_miss, nullptr),
   FIELD(direct_cache_hit, nullptr),
   FIELD(direct_cache_miss, nullptr),
   FIELD(error_hashing_extra_file, "Error hashing extra file", FLAG_ERROR),
@@ -101,10 +114,16 @@ const StatisticsField k_statistics_fields[] = {
   FIELD(output_to_stdout, "Output to stdout", FLAG_UNCACHEABLE),
   FIELD(preprocessed_cache_hit, nullptr),
   FIELD(preprocessed_cache_miss, nullptr),
+  FIELD(preprocessor_cpu_ms, nullptr, FLAG_NOLOG),
   FIELD(preprocessor_error, "Preprocessing failed", FLAG_UNCACHEABLE),
+  FIELD(local_lease_timeout, nullptr),
+  FIELD(local_lease_wait, nullptr),
   FIELD(local_storage_hit, nullptr),
   FIELD(local_storage_miss, nullptr),
   FIELD(recache, "Forced recache", FLAG_UNCACHEABLE),
+  FIELD(remote_lease_timeout, nullptr),
+  FIELD(remote_lease_wait, nullptr),
+  FIELD(remote_lease_win, nullptr),
   FIELD(remote_storage_error, nullptr),
   FIELD(remote_storage_hit, nullptr),
   FIELD(remote_storage_miss, nullptr),
@@ -163,7 +182,7 @@ Statistics::get_statistics_ids() const
 {
   std::vector<std::string> result;
   for (const auto& field : k_statistics_fields) {
-    if (!(field.flags & FLAG_NOZERO)) {
+    if (!(field.flags & (FLAG_NOZERO | FLAG_NOLOG))) {
       for (size_t i = 0; i < m_counters.get(field.statistic); ++i) {
         result.emplace_back(field.id);
       }
@@ -286,12 +305,58 @@ Statistics::format_human_readable(const Config& config,
     }
   }
 
+  const uint64_t slot_waits = S(compile_slot_wait);
+  if (slot_waits > 0 || verbosity > 1) {
+    table.add_heading("Compile slots:");
+    table.add_row({"  Waits:", slot_waits});
+    table.add_row(
+      {"  Wait time (s):",
+       C(FMT("{:.2f}", static_cast<double>(S(compile_slot_wait_ms)) / 1000))
+         .right_align()});
+  }
+
+  const uint64_t rss_256m = S(compiler_peak_rss_below_256m);
+  const uint64_t rss_1g = S(compiler_peak_rss_below_1g);
+  const uint64_t rss_4g = S(compiler_peak_rss_below_4g);
+  const uint64_t rss_more = S(compiler_peak_rss_4g_or_more);
+  const uint64_t measured = rss_256m + rss_1g + rss_4g + rss_more;
+  if ((measured > 0 && verbosity > 0) || verbosity > 1) {
+    const auto seconds = [](uint64_t ms) {
+      return C(FMT("{:.2f}", static_cast<double>(ms) / 1000)).right_align();
+    };
+    table.add_heading("Compiler resource usage:");
+    table.add_row({"  CPU time (s):", seconds(S(compiler_cpu_ms))});
+    table.add_row(
+      {"  Preprocessor CPU time (s):", seconds(S(preprocessor_cpu_ms))});
+    table.add_row({"  Block reads:", S(compiler_block_input)});
+    table.add_row({"  Block writes:", S(compiler_block_output)});
+    table.add_row({"  Peak memory:"});
+    add_ratio_row(table, "    < 256 MiB:", rss_256m, measured);
+    add_ratio_row(table, "    < 1 GiB:", rss_1g, measured);
+    add_ratio_row(table, "    < 4 GiB:", rss_4g, measured);
+    add_ratio_row(table, "    >= 4 GiB:", rss_more, measured);
+  }
+
   if (total_calls > 0 && verbosity > 0) {
     table.add_heading("Successful lookups:");
     add_ratio_row(table, "  Direct:", d_hits, d_hits + d_misses);
     add_ratio_row(table, "  Preprocessed:", p_hits, p_hits + p_misses);
   }
 
+  const uint64_t digest_map_hits = S(digest_map_hit);
+  const uint64_t digest_map_misses = S(digest_map_miss);
+  if (digest_map_hits + digest_map_misses > 0 || verbosity > 1) {
+    table.add_heading("Digest map:");
+    add_ratio_row(table,
+                  "  Hits:",
+                  digest_map_hits,
+                  digest_map_hits + digest_map_misses);
+    add_ratio_row(table,
+                  "  Misses:",
+                  digest_map_misses,
+                  digest_map_hits + digest_map_misses);
+  }
+
   const uint64_t g = 1'000'000'000;
   const uint64_t local_hits = S(local_storage_hit);
   const uint64_t local_misses = S(local_storage_miss);
@@ -329,10 +394,26 @@ Statistics::format_human_readable(const Config& config,
     }
   }
 
+  const uint64_t lease_waits = S(local_lease_wait);
+  const uint64_t lease_timeouts = S(local_lease_timeout);
+  if (lease_waits > 0 || verbosity > 1) {
+    table.add_row({"  Lease waits:", lease_waits});
+  }
+  if (lease_timeouts > 0 || verbosity > 1) {
+    table.add_row({"  Lease timeouts:", lease_timeouts});
+  }
+  const uint64_t admission_rejected = S(admission_rejected);
+  if (admission_rejected > 0 || verbosity > 1) {
+    table.add_row({"  Not admitted:", admission_rejected});
+  }
+
   const uint64_t remote_hits = S(remote_storage_hit);
   const uint64_t remote_misses = S(remote_storage_miss);
   const uint64_t remote_errors = S(remote_storage_error);
   const uint64_t remote_timeouts = S(remote_storage_timeout);
+  const uint64_t remote_lease_waits = S(remote_lease_wait);
+  const uint64_t remote_lease_wins = S(remote_lease_win);
+  const uint64_t remote_lease_timeouts = S(remote_lease_timeout);
 
   if (verbosity > 1
       || remote_hits + remote_misses + remote_errors + remote_timeouts > 0) {
@@ -346,6 +427,15 @@ Statistics::format_human_readable(const Config& config,
     if (verbosity > 1 || remote_timeouts > 0) {
       table.add_row({"  Timeouts:", remote_timeouts});
     }
+    if (verbosity > 1 || remote_lease_wins > 0) {
+      table.add_row({"  Lease wins:", remote_lease_wins});
+    }
+    if (verbosity > 1 || remote_lease_waits > 0) {
+      table.add_row({"  Lease waits:", remote_lease_waits});
+    }
+    if (verbosity > 1 || remote_lease_timeouts > 0) {
+      table.add_row({"  Lease timeouts:", remote_lease_timeouts});
+    }
   }
 
   return table.render();
@@ -24,8 +24,11 @@
 #include <Hash.hpp>
 #include <InodeCache.hpp>
 #include <ProgressBar.hpp>
+#include <TraceRing.hpp>
 #include <ccache.hpp>
+#include <core/AccessTrace.hpp>
 #include <core/CacheEntry.hpp>
+#include <core/CacheSimulator.hpp>
 #include <core/Manifest.hpp>
 #include <core/Result.hpp>
 #include <core/ResultExtractor.hpp>
@@ -37,6 +40,7 @@
 #include <storage/Storage.hpp>
 #include <storage/local/LocalStorage.hpp>
 #include <util/TextTable.hpp>
+#include <util/TimePoint.hpp>
 #include <util/XXH3_128.hpp>
 #include <util/expected.hpp>
 #include <util/file.hpp>
@@ -86,6 +90,8 @@ constexpr const char USAGE_TEXT[] =
     compiler [compiler options]            (ccache masquerading as the compiler)
 
 Common options:
+        --analyze              analyze the content of the cache and print a
+                               report (see also --format)
     -c, --cleanup              delete old files and recalculate size counters
                                (normally not needed as this is done
                                automatically)
@@ -98,6 +104,11 @@ Common options:
                                remove files created in namespace NAMESPACE
         --evict-older-than AGE remove files older than AGE (unsigned integer
                                with a d (days) or s (seconds) suffix)
+        --fleet-stats          show statistics counters aggregated from all
+                               hosts in remote storage with the fleet-stats
+                               attribute in human-readable format
+        --format FORMAT        specify the output format for --analyze: text
+                               (default) or json
     -F, --max-files NUM        set maximum number of files in cache to NUM (use
                                0 for no limit)
     -M, --max-size SIZE        set maximum size of cache to SIZE (use 0 for no
@@ -115,6 +126,9 @@ Common options:
     -s, --show-stats           show summary of configuration and statistics
                                counters in human-readable format (use
                                -v/--verbose once or twice for more details)
+        --simulate-size SIZES  predict the hit rate for each of the
+                               comma-separated cache sizes SIZES by replaying
+                               the access trace (see access_trace_file)
     -v, --verbose              increase verbosity
     -z, --zero-stats           zero statistics counters
 
@@ -135,6 +149,8 @@ Options for remote file-based storage:
 Options for scripting or debugging:
         --checksum-file PATH   print the checksum (128 bit XXH3) of the file at
                                PATH
+        --export-trace PATH    print the events in the trace ring at PATH in
+                               Chrome trace event (JSON) format
         --extract-result PATH  extract file data stored in result file at PATH
                                to the current working directory
     -k, --get-config KEY       print the value of configuration key KEY
@@ -252,6 +268,43 @@ print_compression_statistics(const storage::local::CompressionStatistics& cs)
   PRINT_RAW(stdout, table.render());
 }
 
+static void
+print_simulation_report(const SimulationReport& report)
+{
+  using C = util::TextTable::Cell;
+  const auto percent = [](uint64_t nominator, uint64_t denominator) {
+    return C(FMT("{:.1f} %",
+                 denominator > 0 ? 100.0 * nominator / denominator : 0.0))
+      .right_align();
+  };
+
+  util::TextTable table;
+  table.add_row({"Trace events:", C(report.events).colspan(3)});
+  table.add_row(
+    {"Trace period (days):",
+     C(FMT("{:.1f}",
+           (report.last_timestamp - report.first_timestamp) / 86400.0))
+       .right_align()
+       .colspan(3)});
+  table.add_row({"Sampled keys:",
+                 C(FMT("{:.1f} %", 100.0 * report.sampling_rate))
+                   .right_align()
+                   .colspan(3)});
+  table.add_row({"Observed hit rate:",
+                 percent(report.observed.hits, report.observed.lookups)
+                   .colspan(3)});
+  table.add_row({"Cache size", "Policy", "Hit rate", "Saved CPU time (s)"});
+  for (const auto& row : report.rows) {
+    const double saved_seconds = row.result.saved_cost / 1000;
+    table.add_row({C(Util::format_human_readable_size(row.max_size)),
+                   CacheSimulator::policy_to_string(row.policy),
+                   percent(row.result.hits, row.result.lookups),
+                   C(FMT("{:.1f}", saved_seconds)).right_align()});
+  }
+
+  PRINT_RAW(stdout, table.render());
+}
+
 static void
 trim_dir(const std::string& dir,
          const uint64_t trim_max_size,
@@ -304,6 +357,19 @@ trim_dir(const std::string& dir,
         Util::format_human_readable_size(size_after));
 }
 
+// Push pending statistics to the fleet statistics in remote storage, at most
+// once per fleet-stats-interval unless `force` is true.
+static void
+push_fleet_statistics(const Config& config, const bool force = false)
+{
+  if (config.remote_storage().empty()) {
+    return;
+  }
+  storage::Storage storage(config);
+  storage.initialize();
+  storage.push_fleet_statistics(force);
+}
+
 static std::string
 get_version_text(const std::string_view ccache_name)
 {
@@ -318,17 +384,22 @@ get_usage_text(const std::string_view ccache_name)
 }
 
 enum {
+  ANALYZE,
   CHECKSUM_FILE,
   CONFIG_PATH,
   DUMP_MANIFEST,
   DUMP_RESULT,
   EVICT_NAMESPACE,
   EVICT_OLDER_THAN,
+  EXPORT_TRACE,
   EXTRACT_RESULT,
+  FLEET_STATS,
+  FORMAT,
   HASH_FILE,
   INSPECT,
   PRINT_STATS,
   SHOW_LOG_STATS,
+  SIMULATE_SIZE,
   TRIM_DIR,
   TRIM_MAX_SIZE,
   TRIM_METHOD,
@@ -336,6 +407,7 @@ enum {
 
 const char options_string[] = "cCd:k:hF:M:po:svVxX:z";
 const option long_options[] = {
+  {"analyze", no_argument, nullptr, ANALYZE},
   {"checksum-file", required_argument, nullptr, CHECKSUM_FILE},
   {"cleanup", no_argument, nullptr, 'c'},
   {"clear", no_argument, nullptr, 'C'},
@@ -346,7 +418,10 @@ const option long_options[] = {
   {"dump-result", required_argument, nullptr, DUMP_RESULT},     // bwd compat
   {"evict-namespace", required_argument, nullptr, EVICT_NAMESPACE},
   {"evict-older-than", required_argument, nullptr, EVICT_OLDER_THAN},
+  {"export-trace", required_argument, nullptr, EXPORT_TRACE},
   {"extract-result", required_argument, nullptr, EXTRACT_RESULT},
+  {"fleet-stats", no_argument, nullptr, FLEET_STATS},
+  {"format", required_argument, nullptr, FORMAT},
   {"get-config", required_argument, nullptr, 'k'},
   {"hash-file", required_argument, nullptr, HASH_FILE},
   {"help", no_argument, nullptr, 'h'},
@@ -360,6 +435,7 @@ const option long_options[] = {
   {"show-config", no_argument, nullptr, 'p'},
   {"show-log-stats", no_argument, nullptr, SHOW_LOG_STATS},
   {"show-stats", no_argument, nullptr, 's'},
+  {"simulate-size", required_argument, nullptr, SIMULATE_SIZE},
   {"trim-dir", required_argument, nullptr, TRIM_DIR},
   {"trim-max-size", required_argument, nullptr, TRIM_MAX_SIZE},
   {"trim-method", required_argument, nullptr, TRIM_METHOD},
@@ -377,6 +453,7 @@ process_main_options(int argc, const char* const* argv)
   uint8_t verbosity = 0;
   std::optional<std::string> evict_namespace;
   std::optional<uint64_t> evict_max_age;
+  bool json_format = false;
 
   // First pass: Handle non-command options that affect command options.
   while ((c = getopt_long(argc,
@@ -396,6 +473,14 @@ process_main_options(int argc, const char* const* argv)
       Util::setenv("CCACHE_CONFIGPATH", arg);
       break;
 
+    case FORMAT:
+      if (arg == "json") {
+        json_format = true;
+      } else if (arg != "text") {
+        throw Error(FMT("unknown format: {}", arg));
+      }
+      break;
+
     case TRIM_MAX_SIZE:
       trim_max_size = Util::parse_size(arg);
       break;
@@ -429,12 +514,26 @@ process_main_options(int argc, const char* const* argv)
     switch (c) {
     case CONFIG_PATH:
     case 'd': // --dir
+    case FORMAT:
     case TRIM_MAX_SIZE:
     case TRIM_METHOD:
     case 'v': // --verbose
       // Already handled in the first pass.
       break;
 
+    case ANALYZE: {
+      ProgressBar progress_bar("Analyzing...");
+      const auto analysis = storage::local::LocalStorage(config).analyze(
+        [&](double progress) { progress_bar.update(progress); });
+      if (isatty(STDOUT_FILENO)) {
+        PRINT_RAW(stdout, "\n\n");
+      }
+      PRINT_RAW(stdout,
+                json_format ? analysis.format_json()
+                            : analysis.format_human_readable());
+      break;
+    }
+
     case CHECKSUM_FILE: {
       util::XXH3_128 checksum;
       Fd fd(arg == "-" ? STDIN_FILENO : open(arg.c_str(), O_RDONLY));
@@ -461,6 +560,12 @@ process_main_options(int argc, const char* const* argv)
       break;
     }
 
+    case EXPORT_TRACE: {
+      const auto events = TraceRing::read_events(arg);
+      PRINT_RAW(stdout, TraceRing::format_chrome_trace(events));
+      break;
+    }
+
     case EXTRACT_RESULT: {
       const auto cache_entry_data = read_from_path_or_stdin(arg);
       if (!cache_entry_data) {
@@ -484,6 +589,17 @@ process_main_options(int argc, const char* const* argv)
       return EXIT_SUCCESS;
     }
 
+    case FLEET_STATS: {
+      storage::Storage storage(config);
+      storage.initialize();
+      storage.push_fleet_statistics(true);
+      Statistics statistics(storage.get_fleet_statistics());
+      PRINT_RAW(stdout,
+                statistics.format_human_readable(
+                  config, util::TimePoint::now(), verbosity, true));
+      break;
+    }
+
     case HASH_FILE: {
       Hash hash;
       const auto result =
@@ -512,6 +628,7 @@ process_main_options(int argc, const char* const* argv)
 
     case 'c': // --cleanup
     {
+      push_fleet_statistics(config);
       ProgressBar progress_bar("Cleaning...");
       storage::local::LocalStorage(config).clean_all(
         [&](double progress) { progress_bar.update(progress); });
@@ -650,6 +767,21 @@ process_main_options(int argc, const char* const* argv)
       break;
     }
 
+    case SIMULATE_SIZE: {
+      if (config.access_trace_file().empty()) {
+        throw Error("access_trace_file is not set");
+      }
+      std::vector<uint64_t> sizes;
+      for (const auto& size : Util::split_into_strings(arg, ",")) {
+        sizes.push_back(Util::parse_size(size));
+      }
+      print_simulation_report(
+        simulate_cache_sizes(AccessTrace(config.access_trace_file()),
+                             sizes,
+                             config.limit_multiple()));
+      break;
+    }
+
     case 'z': // --zero-stats
       storage::local::LocalStorage(config).zero_all_statistics();
       PRINT_RAW(stdout, "Statistics zeroed\n");
@@ -43,10 +43,27 @@
 #  include <sys/wait.h>
 #endif
 
+#ifdef HAVE_SYS_RESOURCE_H
+#  include <sys/resource.h>
+#endif
+
 #ifdef _WIN32
 #  include "Finalizer.hpp"
 #endif
 
+#include <algorithm>
+
+ResourceUsage&
+ResourceUsage::operator+=(const ResourceUsage& other)
+{
+  user_time = user_time + other.user_time;
+  system_time = system_time + other.system_time;
+  max_rss = std::max(max_rss, other.max_rss);
+  block_input_operations += other.block_input_operations;
+  block_output_operations += other.block_output_operations;
+  return *this;
+}
+
 #ifdef _WIN32
 static int win32execute(const char* path,
                         const char* const* argv,
@@ -57,7 +74,11 @@ static int win32execute(const char* path,
                         CompilerType compiler_type);
 
 int
-execute(Context& ctx, const char* const* argv, Fd&& fd_out, Fd&& fd_err)
+execute(Context& ctx,
+        const char* const* argv,
+        Fd&& fd_out,
+        Fd&& fd_err,
+        ResourceUsage* /*usage*/)
 {
   return win32execute(argv[0],
                       argv,
@@ -203,7 +224,11 @@ win32execute(const char* path,
 // Execute a compiler backend, capturing all output to the given paths the full
 // path to the compiler to run is in argv[0].
 int
-execute(Context& ctx, const char* const* argv, Fd&& fd_out, Fd&& fd_err)
+execute(Context& ctx,
+        const char* const* argv,
+        Fd&& fd_out,
+        Fd&& fd_err,
+        ResourceUsage* usage)
 {
   LOG("Executing {}", Util::format_argv_for_logging(argv));
 
@@ -222,7 +247,7 @@ execute(Context& ctx, const char* const* argv, Fd&& fd_out, Fd&& fd_err)
     fd_out.close();
     dup2(*fd_err, STDERR_FILENO);
     fd_err.close();
-    exit(execv(argv[0], const_cast<char* const*>(argv)));
+    _exit(execv(argv[0], const_cast<char* const*>(argv)));
   }
 
   fd_out.close();
@@ -231,12 +256,37 @@ execute(Context& ctx, const char* const* argv, Fd&& fd_out, Fd&& fd_err)
   int status;
   int result;
 
+#ifdef HAVE_WAIT4
+  struct rusage rusage;
+  while ((result = wait4(ctx.compiler_pid, &status, 0, &rusage))
+         != ctx.compiler_pid) {
+    if (result == -1 && errno == EINTR) {
+      continue;
+    }
+    throw core::Fatal(FMT("wait4 failed: {}", strerror(errno)));
+  }
+  if (usage) {
+    usage->user_time = util::Duration(rusage.ru_utime.tv_sec,
+                                      1000 * rusage.ru_utime.tv_usec);
+    usage->system_time = util::Duration(rusage.ru_stime.tv_sec,
+                                        1000 * rusage.ru_stime.tv_usec);
+#  ifdef __APPLE__
+    usage->max_rss = rusage.ru_maxrss;
+#  else
+    usage->max_rss = static_cast<uint64_t>(rusage.ru_maxrss) * 1024;
+#  endif
+    usage->block_input_operations = rusage.ru_inblock;
+    usage->block_output_operations = rusage.ru_oublock;
+  }
+#else
+  (void)usage;
   while ((result = waitpid(ctx.compiler_pid, &status, 0)) != ctx.compiler_pid) {
     if (result == -1 && errno == EINTR) {
       continue;
     }
     throw core::Fatal(FMT("waitpid failed: {}", strerror(errno)));
   }
+#endif
 
   {
     SignalHandlerBlocker signal_handler_blocker;
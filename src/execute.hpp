@@ -21,12 +21,34 @@
 #include "Config.hpp"
 #include "Fd.hpp"
 
+#include <util/Duration.hpp>
+
+#include <cstdint>
 #include <optional>
 #include <string>
 
 class Context;
 
-int execute(Context& ctx, const char* const* argv, Fd&& fd_out, Fd&& fd_err);
+// Resources used by a child process.
+struct ResourceUsage
+{
+  util::Duration user_time;
+  util::Duration system_time;
+  uint64_t max_rss = 0; // In bytes.
+  uint64_t block_input_operations = 0;
+  uint64_t block_output_operations = 0;
+
+  ResourceUsage& operator+=(const ResourceUsage& other);
+};
+
+// Execute `argv`, redirecting stdout and stderr to `fd_out` and `fd_err`. If
+// `usage` is non-null, it's set to the resources used by the child process if
+// the platform can report them.
+int execute(Context& ctx,
+            const char* const* argv,
+            Fd&& fd_out,
+            Fd&& fd_err,
+            ResourceUsage* usage = nullptr);
 
 void execute_noreturn(const char* const* argv,
                       const std::string& temp_dir,
@@ -21,7 +21,10 @@
 #include "Args.hpp"
 #include "Config.hpp"
 #include "Context.hpp"
+#include "DigestMap.hpp"
+#include "GitIndex.hpp"
 #include "Hash.hpp"
+#include "IncludePrefetcher.hpp"
 #include "Logging.hpp"
 #include "Stat.hpp"
 #include "Util.hpp"
@@ -33,6 +36,7 @@
 #include <core/wincompat.hpp>
 #include <fmtmacros.hpp>
 #include <util/file.hpp>
+#include <util/path.hpp>
 #include <util/string.hpp>
 
 #ifdef INODE_CACHE_SUPPORTED
@@ -242,8 +246,39 @@ hash_source_code_file(const Context& ctx,
 {
   const bool check_temporal_macros =
     !ctx.config.sloppiness().is_enabled(core::Sloppy::time_macros);
-  int result =
-    do_hash_file(ctx, digest, path, size_hint, check_temporal_macros);
+  std::optional<Digest> known_digest;
+  if (ctx.digest_map || ctx.git_index) {
+    const auto absolute_path = util::is_absolute_path(path)
+                                 ? path
+                                 : FMT("{}/{}", ctx.actual_cwd, path);
+    if (ctx.digest_map) {
+      known_digest = ctx.digest_map->get(absolute_path);
+    }
+    if (!known_digest && ctx.git_index) {
+      known_digest = ctx.git_index->get(absolute_path);
+    }
+  }
+  const auto prefetched = !known_digest && ctx.include_prefetcher
+                            ? ctx.include_prefetcher->get(path)
+                            : std::nullopt;
+  int result;
+  if (known_digest) {
+    digest = *known_digest;
+    result = HASH_SOURCE_CODE_OK;
+  } else if (prefetched) {
+    digest = prefetched->digest;
+    result = check_temporal_macros ? prefetched->result : HASH_SOURCE_CODE_OK;
+#ifdef INODE_CACHE_SUPPORTED
+    ctx.inode_cache.put(path,
+                        check_temporal_macros
+                          ? InodeCache::ContentType::checked_for_temporal_macros
+                          : InodeCache::ContentType::raw,
+                        digest,
+                        result);
+#endif
+  } else {
+    result = do_hash_file(ctx, digest, path, size_hint, check_temporal_macros);
+  }
 
   if (!check_temporal_macros || result == HASH_SOURCE_CODE_OK
       || (result & HASH_SOURCE_CODE_ERROR)) {
@@ -319,6 +354,51 @@ hash_source_code_file(const Context& ctx,
   return result;
 }
 
+std::optional<Digest>
+hash_immutable_include_file(const Context& ctx, const std::string& path)
+{
+  for (const auto& root : ctx.immutable_include_roots) {
+    if (!Util::matches_dir_prefix_or_file(root, path)) {
+      continue;
+    }
+
+    auto it = ctx.immutable_include_root_fingerprints.find(root);
+    if (it == ctx.immutable_include_root_fingerprints.end()) {
+      // The identity of the root directory changes if the root is replaced or
+      // if entries are added to or removed from it, e.g. when a toolchain is
+      // reinstalled.
+      std::optional<Digest> fingerprint;
+      const auto st = Stat::stat(root, Stat::OnError::log);
+      if (st) {
+        Hash hash;
+        hash.hash_delimiter("immutable_include_root");
+        hash.hash(root);
+        hash.hash(static_cast<int64_t>(st.device()));
+        hash.hash(static_cast<int64_t>(st.inode()));
+        hash.hash(st.mtime().nsec());
+        hash.hash(st.ctime().nsec());
+        fingerprint = hash.digest();
+        LOG("Fingerprint of immutable include root {}: {}",
+            root,
+            fingerprint->to_string());
+      }
+      it = ctx.immutable_include_root_fingerprints.emplace(root, fingerprint)
+             .first;
+    }
+    if (!it->second) {
+      return std::nullopt;
+    }
+
+    Hash hash;
+    hash.hash_delimiter("immutable_include");
+    hash.hash(it->second->to_string());
+    hash.hash(path);
+    return hash.digest();
+  }
+
+  return std::nullopt;
+}
+
 bool
 hash_binary_file(const Context& ctx,
                  Digest& digest,
@@ -18,13 +18,15 @@
 
 #pragma once
 
+#include "Digest.hpp"
+
 #include <cstddef>
+#include <optional>
 #include <string>
 #include <string_view>
 
 class Config;
 class Context;
-class Digest;
 class Hash;
 
 const int HASH_SOURCE_CODE_OK = 0;
@@ -48,6 +50,13 @@ int hash_source_code_file(const Context& ctx,
                           const std::string& path,
                           size_t size_hint = 0);
 
+// Compute a digest for `path` if it is located below one of the configured
+// immutable include roots. The digest is derived from the fingerprint of the
+// root and the path, so the file itself is neither stat-ed nor read. Returns
+// std::nullopt if `path` is not below such a root.
+std::optional<Digest> hash_immutable_include_file(const Context& ctx,
+                                                  const std::string& path);
+
 // Hash a binary file (using the inode cache if enabled) and put its digest in
 // `digest`
 //
@@ -0,0 +1,342 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "Server.hpp"
+
+#include "Store.hpp"
+
+#include <Util.hpp>
+#include <ccache.hpp>
+#include <core/exceptions.hpp>
+#include <fmtmacros.hpp>
+#include <util/Tokenizer.hpp>
+
+#include <third_party/httplib.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace server {
+
+namespace {
+
+const auto k_content_type = "application/octet-stream";
+
+} // namespace
+
+Server::Server(Store& store, const Options& options)
+  : m_store(store),
+    m_options(options),
+    m_server(std::make_unique<httplib::Server>())
+{
+  // Each keep-alive connection occupies a thread while open.
+  const size_t threads =
+    m_options.threads > 0
+      ? m_options.threads
+      : std::max<size_t>(8, 2 * std::thread::hardware_concurrency());
+  m_server->new_task_queue = [threads] {
+    return new httplib::ThreadPool(threads);
+  };
+  m_server->set_keep_alive_max_count(m_options.keep_alive_max_count);
+  if (m_options.unix_socket.empty()) {
+    m_server->set_tcp_nodelay(true);
+  } else {
+#ifdef _WIN32
+    throw core::Fatal("Unix sockets are not supported");
+#else
+    m_server->set_address_family(AF_UNIX);
+#endif
+  }
+  m_server->set_default_headers({{"Server", FMT("ccache/{}", CCACHE_VERSION)}});
+
+  if (m_options.verbose) {
+    m_server->set_logger([](const auto& request, const auto& response) {
+      PRINT(stderr,
+            "{} {} {} {}\n",
+            request.method,
+            request.path,
+            response.status,
+            request.method == "PUT" ? request.body.size()
+                                    : response.body.size());
+    });
+  }
+
+  m_server->Get("/", [](const auto& /*request*/, auto& response) {
+    response.set_content(FMT("ccache-server {}\n", CCACHE_VERSION),
+                         "text/plain");
+  });
+  m_server->Get("/_metrics", [this](const auto& /*request*/, auto& response) {
+    response.set_content(format_metrics(), "text/plain; version=0.0.4");
+  });
+  m_server->Post("/_batch", [this](const auto& request, auto& response) {
+    handle_batch(request, response);
+  });
+  // Note: HEAD requests are dispatched to GET handlers.
+  m_server->Get("/.+", [this](const auto& request, auto& response) {
+    handle_get(request, response);
+  });
+  m_server->Put("/.+", [this](const auto& request, auto& response) {
+    handle_put(request, response);
+  });
+  m_server->Delete("/.+", [this](const auto& request, auto& response) {
+    handle_delete(request, response);
+  });
+}
+
+Server::~Server() = default;
+
+int
+Server::bind()
+{
+  if (!m_options.unix_socket.empty()) {
+    // Remove a socket left behind by a previous server.
+    Util::unlink_tmp(m_options.unix_socket, Util::UnlinkLog::ignore_failure);
+    // The port is ignored for unix sockets but must be nonzero.
+    if (!m_server->bind_to_port(m_options.unix_socket, 80)) {
+      throw core::Fatal(FMT("Failed to bind to {}", m_options.unix_socket));
+    }
+    return 0;
+  }
+
+  const int port =
+    m_options.port == 0
+      ? m_server->bind_to_any_port(m_options.host)
+      : (m_server->bind_to_port(m_options.host, m_options.port) ? m_options.port
+                                                                : -1);
+  if (port < 0) {
+    throw core::Fatal(
+      FMT("Failed to bind to {} port {}", m_options.host, m_options.port));
+  }
+  return port;
+}
+
+bool
+Server::listen()
+{
+  return m_server->listen_after_bind();
+}
+
+void
+Server::stop()
+{
+  m_server->stop();
+}
+
+std::optional<std::string>
+Server::key_from_path(const std::string_view url_path)
+{
+  // "<prefix>/ab/cdef" (subdirs layout) or "<prefix>/abcdef" (flat layout).
+  const auto slash = url_path.rfind('/');
+  const auto name = url_path.substr(slash + 1);
+  const auto dir = url_path.substr(0, slash == std::string_view::npos ? 0
+                                                                      : slash);
+  const auto subdir = dir.substr(dir.rfind('/') + 1);
+  auto key = subdir.length() == 2 ? FMT("{}{}", subdir, name)
+                                  : std::string(name);
+  if (!Store::is_valid_key(key)) {
+    return std::nullopt;
+  }
+  return key;
+}
+
+void
+Server::handle_get(const httplib::Request& request,
+                   httplib::Response& response)
+{
+  const bool is_head = request.method == "HEAD";
+  ++(is_head ? m_counters.head_requests : m_counters.get_requests);
+
+  const auto key = key_from_path(request.path);
+  if (!key) {
+    response.status = 400;
+    return;
+  }
+
+  if (is_head) {
+    const auto etag = m_store.head(*key);
+    if (!etag) {
+      ++m_counters.misses;
+      response.status = 404;
+      return;
+    }
+    ++m_counters.hits;
+    response.set_header("ETag", *etag);
+    return;
+  }
+
+  const auto entry =
+    m_store.get(*key, request.get_header_value("If-None-Match"));
+  if (!entry) {
+    ++m_counters.misses;
+    response.status = 404;
+    return;
+  }
+  ++m_counters.hits;
+  response.set_header("ETag", entry->etag);
+  if (entry->unchanged) {
+    ++m_counters.not_modified;
+    response.status = 304;
+    return;
+  }
+  m_counters.bytes_sent += entry->value.size();
+  response.set_content(reinterpret_cast<const char*>(entry->value.data()),
+                       entry->value.size(),
+                       k_content_type);
+}
+
+void
+Server::handle_put(const httplib::Request& request,
+                   httplib::Response& response)
+{
+  ++m_counters.put_requests;
+
+  const auto key = key_from_path(request.path);
+  if (!key) {
+    response.status = 400;
+    return;
+  }
+
+  m_counters.bytes_received += request.body.size();
+  const bool only_if_missing = request.get_header_value("If-None-Match") == "*";
+  const auto if_match = request.get_header_value("If-Match");
+  try {
+    const auto etag = m_store.put(
+      *key,
+      {reinterpret_cast<const uint8_t*>(request.body.data()),
+       request.body.size()},
+      only_if_missing,
+      if_match);
+    if (!etag) {
+      response.status = 412; // Precondition Failed
+      return;
+    }
+    response.status = 201; // Created
+    response.set_header("ETag", *etag);
+  } catch (const core::Error& e) {
+    ++m_counters.errors;
+    PRINT(stderr, "ccache-server: error: {}\n", e.what());
+    response.status = 500;
+  }
+}
+
+void
+Server::handle_delete(const httplib::Request& request,
+                      httplib::Response& response)
+{
+  ++m_counters.delete_requests;
+
+  const auto key = key_from_path(request.path);
+  if (!key) {
+    response.status = 400;
+    return;
+  }
+  switch (m_store.remove(*key, request.get_header_value("If-Match"))) {
+  case Store::RemoveResult::removed:
+    response.status = 200;
+    break;
+  case Store::RemoveResult::missing:
+    response.status = 404;
+    break;
+  case Store::RemoveResult::changed:
+    response.status = 412; // Precondition Failed
+    break;
+  }
+}
+
+void
+Server::handle_batch(const httplib::Request& request,
+                     httplib::Response& response)
+{
+  ++m_counters.batch_requests;
+
+  std::string body;
+  for (const auto key : util::Tokenizer(request.body, "\r\n")) {
+    const auto entry =
+      Store::is_valid_key(key) ? m_store.get(std::string(key)) : std::nullopt;
+    if (!entry) {
+      ++m_counters.misses;
+      body += FMT("{} -\n", key);
+      continue;
+    }
+    ++m_counters.hits;
+    m_counters.bytes_sent += entry->value.size();
+    body += FMT("{} {}\n", key, entry->value.size());
+    body.append(reinterpret_cast<const char*>(entry->value.data()),
+                entry->value.size());
+  }
+  response.set_content(body, k_content_type);
+}
+
+std::string
+Server::format_metrics() const
+{
+  std::string result;
+  const auto add = [&](std::string_view name,
+                       std::string_view type,
+                       std::string_view help,
+                       uint64_t value) {
+    result += FMT("# HELP ccache_server_{} {}\n", name, help);
+    result += FMT("# TYPE ccache_server_{} {}\n", name, type);
+    result += FMT("ccache_server_{} {}\n", name, value);
+  };
+
+  result += "# HELP ccache_server_requests_total Requests by method.\n";
+  result += "# TYPE ccache_server_requests_total counter\n";
+  for (const auto& [method, value] : {
+         std::make_pair("GET", m_counters.get_requests.load()),
+         std::make_pair("HEAD", m_counters.head_requests.load()),
+         std::make_pair("PUT", m_counters.put_requests.load()),
+         std::make_pair("DELETE", m_counters.delete_requests.load()),
+         std::make_pair("BATCH", m_counters.batch_requests.load()),
+       }) {
+    result += FMT(
+      "ccache_server_requests_total{{method=\"{}\"}} {}\n", method, value);
+  }
+
+  add("hits_total", "counter", "Lookups of existing entries.", m_counters.hits);
+  add("misses_total",
+      "counter",
+      "Lookups of missing entries.",
+      m_counters.misses);
+  add("not_modified_total",
+      "counter",
+      "Conditional gets of unchanged entries.",
+      m_counters.not_modified);
+  add("sent_bytes_total",
+      "counter",
+      "Bytes of entry data sent.",
+      m_counters.bytes_sent);
+  add("received_bytes_total",
+      "counter",
+      "Bytes of entry data received.",
+      m_counters.bytes_received);
+  add("errors_total", "counter", "Failed stores.", m_counters.errors);
+  add("evictions_total",
+      "counter",
+      "Entries evicted to stay below the maximum size.",
+      m_store.eviction_count());
+  add("entries", "gauge", "Entries in the store.", m_store.entry_count());
+  add("size_bytes", "gauge", "Size of entries in the store.", m_store.size());
+  add("max_size_bytes",
+      "gauge",
+      "Maximum size of the store, 0 if unlimited.",
+      m_store.max_size());
+  return result;
+}
+
+} // namespace server
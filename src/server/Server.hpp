@@ -0,0 +1,107 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <NonCopyable.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace httplib {
+class Server;
+struct Request;
+struct Response;
+} // namespace httplib
+
+namespace server {
+
+class Store;
+
+// An HTTP server for the HTTP storage backend, serving entries from a Store.
+//
+// Entries are accessed with GET, HEAD, PUT and DELETE using the URL paths of
+// the "subdirs" and "flat" layouts; the path prefix is ignored. In addition:
+//
+// - "GET /_metrics" returns counters in the Prometheus text format.
+// - "POST /_batch" with one key per line in the body returns the entries in
+//   one response, each as "<key> <size>\n<value>" or "<key> -\n" if missing.
+class Server : NonCopyable
+{
+public:
+  struct Options
+  {
+    std::string host = "127.0.0.1";
+    int port = 8080;         // 0 means any free port.
+    std::string unix_socket; // Listen on this socket instead if non-empty.
+    size_t threads = 0;
+    size_t keep_alive_max_count = 100;
+    bool verbose = false;
+  };
+
+  Server(Store& store, const Options& options);
+  ~Server();
+
+  // Bind to the configured address and return the port (0 for a unix
+  // socket). Throws core::Fatal on error.
+  int bind();
+
+  // Serve requests until stop() is called. Returns false on error.
+  bool listen();
+
+  void stop();
+
+  // Return the store key that `url_path` refers to, if valid.
+  static std::optional<std::string> key_from_path(std::string_view url_path);
+
+private:
+  struct Counters
+  {
+    std::atomic<uint64_t> get_requests{0};
+    std::atomic<uint64_t> head_requests{0};
+    std::atomic<uint64_t> put_requests{0};
+    std::atomic<uint64_t> delete_requests{0};
+    std::atomic<uint64_t> batch_requests{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> not_modified{0};
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<uint64_t> bytes_received{0};
+    std::atomic<uint64_t> errors{0};
+  };
+
+  Store& m_store;
+  const Options m_options;
+  std::unique_ptr<httplib::Server> m_server;
+  Counters m_counters;
+
+  void handle_get(const httplib::Request& request, httplib::Response& response);
+  void handle_put(const httplib::Request& request, httplib::Response& response);
+  void handle_delete(const httplib::Request& request,
+                     httplib::Response& response);
+  void handle_batch(const httplib::Request& request,
+                    httplib::Response& response);
+  std::string format_metrics() const;
+};
+
+} // namespace server
@@ -0,0 +1,278 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "Store.hpp"
+
+#include <AtomicFile.hpp>
+#include <Stat.hpp>
+#include <Util.hpp>
+#include <assertions.hpp>
+#include <fmtmacros.hpp>
+#include <util/file.hpp>
+#include <util/string.hpp>
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace server {
+
+namespace {
+
+const std::string_view k_lease_suffix = ".lease";
+
+uint64_t
+generate_instance_id()
+{
+  std::random_device random_device;
+  std::uniform_int_distribution<uint64_t> distribution;
+  return distribution(random_device);
+}
+
+} // namespace
+
+Store::Store(const std::string& dir, const uint64_t max_size)
+  : m_dir(dir),
+    m_max_size(max_size),
+    m_instance_id(generate_instance_id())
+{
+}
+
+void
+Store::load()
+{
+  std::vector<std::tuple<util::TimePoint, std::string, Stat>> files;
+  Util::traverse(m_dir, [&](const std::string& path, const bool is_dir) {
+    if (is_dir) {
+      return;
+    }
+    const auto subdir = Util::dir_name(path);
+    if (Util::dir_name(subdir) != m_dir) {
+      return;
+    }
+    auto key = FMT("{}{}", Util::base_name(subdir), Util::base_name(path));
+    if (Util::base_name(subdir).length() != 2 || !is_valid_key(key)) {
+      return;
+    }
+    auto stat = Stat::lstat(path);
+    if (stat.is_regular()) {
+      files.emplace_back(stat.mtime(), std::move(key), std::move(stat));
+    }
+  });
+
+  // Insert the most recently modified file last so that it ends up first in
+  // the LRU list.
+  std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+    return std::get<0>(a) < std::get<0>(b);
+  });
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& [mtime, key, stat] : files) {
+    insert(key, stat.size(), next_etag());
+  }
+  evict();
+}
+
+std::optional<Store::Entry>
+Store::get(const std::string& key, const std::string_view if_none_match)
+{
+  std::string etag;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_index.find(key);
+    if (it == m_index.end()) {
+      return std::nullopt;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru_position);
+    etag = it->second.etag;
+  }
+
+  if (etag == if_none_match) {
+    return Entry{{}, etag, true};
+  }
+
+  auto value = util::read_file<util::Bytes>(get_path(key));
+  if (!value) {
+    // The file was evicted or removed after releasing the lock, or it was
+    // removed by somebody else.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_index.find(key);
+    if (it != m_index.end() && it->second.etag == etag) {
+      erase(key);
+    }
+    return std::nullopt;
+  }
+  return Entry{std::move(*value), etag, false};
+}
+
+std::optional<std::string>
+Store::head(const std::string& key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto it = m_index.find(key);
+  if (it == m_index.end()) {
+    return std::nullopt;
+  }
+  m_lru.splice(m_lru.begin(), m_lru, it->second.lru_position);
+  return it->second.etag;
+}
+
+std::optional<std::string>
+Store::put(const std::string& key,
+           const nonstd::span<const uint8_t> value,
+           const bool only_if_missing,
+           const std::string_view if_match)
+{
+  ASSERT(is_valid_key(key));
+
+  // Write the content to a temporary file without holding the lock, so that
+  // a large upload doesn't block other requests.
+  const auto path = get_path(key);
+  Util::ensure_dir_exists(Util::dir_name(path));
+  AtomicFile file(path, AtomicFile::Mode::binary);
+  file.write(value);
+
+  // Check the precondition and move the file in place atomically with respect
+  // to other requests. Conditional puts are used for leases and manifest
+  // merges, so only one of several competing puts may succeed.
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (only_if_missing || !if_match.empty()) {
+    const auto it = m_index.find(key);
+    const bool precondition_met =
+      only_if_missing ? it == m_index.end()
+                      : it != m_index.end()
+                          && (if_match == "*" || it->second.etag == if_match);
+    if (!precondition_met) {
+      return std::nullopt;
+    }
+  }
+  file.commit();
+  auto etag = next_etag();
+  insert(key, value.size(), etag);
+  evict();
+  return etag;
+}
+
+Store::RemoveResult
+Store::remove(const std::string& key, const std::string_view if_match)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto it = m_index.find(key);
+  if (it == m_index.end()) {
+    return RemoveResult::missing;
+  }
+  if (!if_match.empty() && if_match != "*" && it->second.etag != if_match) {
+    return RemoveResult::changed;
+  }
+  erase(key);
+  Util::unlink_tmp(get_path(key), Util::UnlinkLog::ignore_failure);
+  return RemoveResult::removed;
+}
+
+uint64_t
+Store::max_size() const
+{
+  return m_max_size;
+}
+
+uint64_t
+Store::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_size;
+}
+
+uint64_t
+Store::entry_count() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_index.size();
+}
+
+uint64_t
+Store::eviction_count() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_eviction_count;
+}
+
+bool
+Store::is_valid_key(std::string_view key)
+{
+  if (util::ends_with(key, k_lease_suffix)) {
+    key = key.substr(0, key.length() - k_lease_suffix.length());
+  }
+  return key.length() > 2 && key.length() <= 100
+         && std::all_of(key.begin(), key.end(), [](const char c) {
+              return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z');
+            });
+}
+
+std::string
+Store::get_path(const std::string_view key) const
+{
+  return FMT("{}/{}/{}", m_dir, key.substr(0, 2), key.substr(2));
+}
+
+std::string
+Store::next_etag()
+{
+  ++m_generation;
+  return FMT("\"{:x}-{:x}\"", m_instance_id, m_generation);
+}
+
+void
+Store::insert(const std::string& key, const uint64_t size, std::string etag)
+{
+  const auto it = m_index.find(key);
+  if (it != m_index.end()) {
+    m_size -= it->second.size;
+    it->second.size = size;
+    it->second.etag = std::move(etag);
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru_position);
+  } else {
+    m_lru.push_front(key);
+    m_index.emplace(key, IndexEntry{size, std::move(etag), m_lru.begin()});
+  }
+  m_size += size;
+}
+
+void
+Store::erase(const std::string& key)
+{
+  const auto it = m_index.find(key);
+  ASSERT(it != m_index.end());
+  m_size -= it->second.size;
+  m_lru.erase(it->second.lru_position);
+  m_index.erase(it);
+}
+
+void
+Store::evict()
+{
+  // Always keep the most recently used entry, even if it's too large.
+  while (m_max_size > 0 && m_size > m_max_size && m_lru.size() > 1) {
+    const std::string key = m_lru.back();
+    erase(key);
+    Util::unlink_tmp(get_path(key), Util::UnlinkLog::ignore_failure);
+    ++m_eviction_count;
+  }
+}
+
+} // namespace server
@@ -0,0 +1,132 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <NonCopyable.hpp>
+#include <util/Bytes.hpp>
+
+#include <third_party/nonstd/span.hpp>
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace server {
+
+// A size-bounded store of cache entries in a directory that evicts the least
+// recently used entries when full. An entry with key "abcdef" is stored in the
+// file "ab/cdef", i.e. like in the subdirs layout of the HTTP storage backend.
+//
+// The LRU order is kept in memory and initialized from the modification times
+// of the files when loading the directory. All methods are thread-safe. File
+// content is read and written without holding the index lock; only the final
+// rename of a written file is done while holding it.
+//
+// ETags are generation numbers prefixed with a random ID of the store
+// instance, so they change on every put even if the file system's timestamps
+// are coarse and never repeat across server restarts.
+class Store : NonCopyable
+{
+public:
+  struct Entry
+  {
+    util::Bytes value;      // Empty if unchanged.
+    std::string etag;       // Version of the entry.
+    bool unchanged = false; // True if the version matched `if_none_match`.
+  };
+
+  // A `max_size` of 0 means no limit.
+  Store(const std::string& dir, uint64_t max_size);
+
+  // Index entries already present in the directory. Throws core::Error on
+  // error.
+  void load();
+
+  // Get the entry for `key` and mark it as recently used. If
+  // `if_none_match` equals the entry's ETag, the value is not read.
+  std::optional<Entry> get(const std::string& key,
+                           std::string_view if_none_match = {});
+
+  // Return the ETag of `key` and mark it as recently used, or std::nullopt if
+  // there is no such entry.
+  std::optional<std::string> head(const std::string& key);
+
+  // Store `value` for `key`, evicting other entries if needed. Returns the
+  // ETag of the new entry, or std::nullopt if `only_if_missing` is true and
+  // the entry already exists or if `if_match` is non-empty and not the ETag of
+  // the entry. Throws core::Error on error.
+  std::optional<std::string> put(const std::string& key,
+                                 nonstd::span<const uint8_t> value,
+                                 bool only_if_missing = false,
+                                 std::string_view if_match = {});
+
+  enum class RemoveResult {
+    removed,
+    missing,
+    changed // `if_match` was not the ETag of the entry.
+  };
+
+  // Remove `key`, or only if its ETag is `if_match` if `if_match` is
+  // non-empty.
+  RemoveResult remove(const std::string& key, std::string_view if_match = {});
+
+  uint64_t max_size() const;
+  uint64_t size() const;
+  uint64_t entry_count() const;
+  uint64_t eviction_count() const;
+
+  // Return true if `key` is a ccache key (optionally with a ".lease" suffix),
+  // which also makes it a safe file name.
+  static bool is_valid_key(std::string_view key);
+
+private:
+  using LruList = std::list<std::string>;
+
+  struct IndexEntry
+  {
+    uint64_t size;
+    std::string etag;
+    LruList::iterator lru_position;
+  };
+
+  const std::string m_dir;
+  const uint64_t m_max_size;
+  const uint64_t m_instance_id;
+
+  mutable std::mutex m_mutex;
+  LruList m_lru; // Most recently used first.
+  std::unordered_map<std::string, IndexEntry> m_index;
+  uint64_t m_size = 0;
+  uint64_t m_eviction_count = 0;
+  uint64_t m_generation = 0;
+
+  std::string get_path(std::string_view key) const;
+
+  // The following methods require m_mutex to be held.
+  std::string next_etag();
+  void insert(const std::string& key, uint64_t size, std::string etag);
+  void erase(const std::string& key);
+  void evict();
+};
+
+} // namespace server
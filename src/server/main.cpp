@@ -0,0 +1,183 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <Util.hpp>
+#include <ccache.hpp>
+#include <core/exceptions.hpp>
+#include <fmtmacros.hpp>
+#include <server/Server.hpp>
+#include <server/Store.hpp>
+#include <util/expected.hpp>
+#include <util/string.hpp>
+
+#ifdef HAVE_GETOPT_LONG
+#  include <getopt.h>
+#elif defined(_WIN32)
+#  include <third_party/win32/getopt.h>
+#else
+extern "C" {
+#  include <third_party/getopt_long.h>
+}
+#endif
+
+#include <cstdlib>
+#include <limits>
+
+namespace {
+
+constexpr const char USAGE_TEXT[] =
+  R"(Usage:
+    {0} [options] DIR
+
+Serve cache entries stored in DIR over HTTP for ccache's HTTP storage backend.
+
+Options:
+    -b, --bind ADDRESS         listen on ADDRESS (default: 127.0.0.1)
+    -k, --keep-alive-max N     serve at most N requests per connection
+                               (default: 100)
+    -M, --max-size SIZE        evict least recently used entries when the total
+                               size exceeds SIZE (use suffix k, M, G, T or
+                               Ki, Mi, Gi, Ti; default suffix: G); use 0 for
+                               no limit (default: 10G)
+    -p, --port PORT            listen on PORT; use 0 for any free port
+                               (default: 8080)
+    -s, --socket PATH          listen on unix socket PATH instead of a TCP
+                               port
+    -j, --threads N            serve at most N connections concurrently
+                               (default: twice the number of CPUs, at least 8)
+    -v, --verbose              log requests to standard error
+    -h, --help                 print this help text
+    -V, --version              print version information
+
+See also the manual on <https://ccache.dev/documentation.html>.
+)";
+
+uint64_t
+parse_count(const std::string& value, const std::string_view description)
+{
+  return util::value_or_throw<core::Error>(util::parse_unsigned(
+    value, 0, std::numeric_limits<int>::max(), description));
+}
+
+int
+server_main(int argc, char* const* argv)
+{
+  const char* const options_string = "b:hj:k:M:p:s:vV";
+  const option long_options[] = {
+    {"bind", required_argument, nullptr, 'b'},
+    {"help", no_argument, nullptr, 'h'},
+    {"keep-alive-max", required_argument, nullptr, 'k'},
+    {"max-size", required_argument, nullptr, 'M'},
+    {"port", required_argument, nullptr, 'p'},
+    {"socket", required_argument, nullptr, 's'},
+    {"threads", required_argument, nullptr, 'j'},
+    {"verbose", no_argument, nullptr, 'v'},
+    {"version", no_argument, nullptr, 'V'},
+    {nullptr, 0, nullptr, 0}};
+
+  server::Server::Options options;
+  uint64_t max_size = 10ULL * 1000 * 1000 * 1000;
+
+  int c;
+  while ((c = getopt_long(argc, argv, options_string, long_options, nullptr))
+         != -1) {
+    const std::string arg = optarg ? optarg : std::string();
+
+    switch (c) {
+    case 'b': // --bind
+      options.host = arg;
+      break;
+
+    case 'h': // --help
+      PRINT(stdout, USAGE_TEXT, Util::base_name(argv[0]));
+      return EXIT_SUCCESS;
+
+    case 'j': // --threads
+      options.threads = parse_count(arg, "threads");
+      break;
+
+    case 'k': // --keep-alive-max
+      options.keep_alive_max_count = parse_count(arg, "keep-alive-max");
+      break;
+
+    case 'M': // --max-size
+      max_size = Util::parse_size(arg);
+      break;
+
+    case 'p': // --port
+      options.port = parse_count(arg, "port");
+      break;
+
+    case 's': // --socket
+      options.unix_socket = arg;
+      break;
+
+    case 'v': // --verbose
+      options.verbose = true;
+      break;
+
+    case 'V': // --version
+      PRINT(stdout, "ccache-server version {}\n", CCACHE_VERSION);
+      return EXIT_SUCCESS;
+
+    default:
+      PRINT(stderr, USAGE_TEXT, Util::base_name(argv[0]));
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (optind != argc - 1) {
+    PRINT(stderr, USAGE_TEXT, Util::base_name(argv[0]));
+    return EXIT_FAILURE;
+  }
+  std::string dir = argv[optind];
+  while (dir.length() > 1 && dir.back() == '/') {
+    dir.pop_back();
+  }
+
+  Util::ensure_dir_exists(dir);
+  server::Store store(dir, max_size);
+  store.load();
+
+  server::Server server(store, options);
+  const int port = server.bind();
+  PRINT(stdout,
+        "Serving {} ({} entries, {}) on {}\n",
+        dir,
+        store.entry_count(),
+        Util::format_human_readable_size(store.size()),
+        options.unix_socket.empty()
+          ? FMT("http://{}:{}/", options.host, port)
+          : FMT("http+unix:{}", options.unix_socket));
+  fflush(stdout);
+
+  return server.listen() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace
+
+int
+main(int argc, char* const* argv)
+{
+  try {
+    return server_main(argc, argv);
+  } catch (const core::ErrorBase& e) {
+    PRINT(stderr, "ccache-server: error: {}\n", e.what());
+    return EXIT_FAILURE;
+  }
+}
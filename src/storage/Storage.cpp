@@ -19,6 +19,8 @@
 #include "Storage.hpp"
 
 #include <Config.hpp>
+#include <Digest.hpp>
+#include <Hash.hpp>
 #include <Logging.hpp>
 #include <MiniTrace.hpp>
 #include <TemporaryFile.hpp>
@@ -34,6 +36,7 @@
 #endif
 #include <core/CacheEntry.hpp>
 #include <util/Bytes.hpp>
+#include <util/Duration.hpp>
 #include <util/Timer.hpp>
 #include <util/Tokenizer.hpp>
 #include <util/XXH3_64.hpp>
@@ -43,9 +46,19 @@
 
 #include <third_party/url.hpp>
 
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <signal.h> // NOLINT: signal is defined in signal.h
+#  include <unistd.h>
+#endif
+
 #include <cmath>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -56,6 +69,7 @@ const std::unordered_map<std::string /*scheme*/,
   k_remote_storage_implementations = {
     {"file", std::make_shared<remote::FileStorage>()},
     {"http", std::make_shared<remote::HttpStorage>()},
+    {"http+unix", std::make_shared<remote::HttpStorage>()},
 #ifdef HAVE_REDIS_STORAGE_BACKEND
     {"redis", std::make_shared<remote::RedisStorage>()},
     {"redis+unix", std::make_shared<remote::RedisStorage>()},
@@ -85,7 +99,12 @@ struct RemoteStorageConfig
 {
   std::vector<RemoteStorageShardConfig> shards;
   remote::RemoteStorage::Backend::Params params;
+  bool lease = false;
   bool read_only = false;
+  bool backfill = false;
+  bool fleet_stats = false;
+  util::Duration fleet_stats_interval = util::Duration(60);
+  bool merge_manifests = false;
 };
 
 struct RemoteStorageBackendEntry
@@ -104,6 +123,15 @@ struct RemoteStorageEntry
   std::vector<RemoteStorageBackendEntry> backends;
 };
 
+// An entry retrieved from a remote storage to be written to faster remote
+// storages that missed it.
+struct RemoteStorageBackfill
+{
+  Digest key;
+  util::Bytes value;
+  std::vector<RemoteStorageEntry*> entries;
+};
+
 static std::string
 to_string(const RemoteStorageConfig& entry)
 {
@@ -149,7 +177,19 @@ parse_storage_config(const std::string_view entry)
     const auto& raw_value = right_hand_side.value_or("true");
     const auto value =
       util::value_or_throw<core::Error>(util::percent_decode(raw_value));
-    if (key == "read-only") {
+    if (key == "backfill") {
+      result.backfill = (value == "true");
+    } else if (key == "fleet-stats") {
+      result.fleet_stats = (value == "true");
+    } else if (key == "fleet-stats-interval") {
+      result.fleet_stats_interval =
+        util::Duration(util::value_or_throw<core::Error>(
+          util::parse_unsigned(value, std::nullopt, std::nullopt, key)));
+    } else if (key == "lease") {
+      result.lease = (value == "true");
+    } else if (key == "merge-manifests") {
+      result.merge_manifests = (value == "true");
+    } else if (key == "read-only") {
       result.read_only = (value == "true");
     } else if (key == "shards") {
       if (url_str.find('*') == std::string::npos) {
@@ -207,10 +247,114 @@ get_storage(const Url& url)
   }
 }
 
+// Key of the fleet statistics entry in remote storage.
+static Digest
+fleet_statistics_key()
+{
+  return Hash().hash_delimiter("fleet_stats").digest();
+}
+
 Storage::Storage(const Config& config) : local(config), m_config(config)
 {
 }
 
+// A remote lease taken by this process. A helper thread renews the lease
+// every third of its time to live so that it doesn't expire while the
+// compilation is still running. The thread uses a backend instance of its own
+// since backends aren't thread-safe.
+class RemoteLease
+{
+public:
+  RemoteLease(const Digest& key,
+              std::string owner,
+              std::chrono::milliseconds ttl,
+              std::shared_ptr<remote::RemoteStorage> storage,
+              remote::RemoteStorage::Backend::Params params);
+  ~RemoteLease();
+
+  const std::string& owner() const;
+
+private:
+  const Digest m_key;
+  const std::string m_owner;
+  const std::chrono::milliseconds m_ttl;
+  std::thread m_keep_alive_thread;
+  std::mutex m_stop_keep_alive_mutex;
+  bool m_stop_keep_alive = false;
+  std::condition_variable m_stop_keep_alive_condition;
+
+  void keep_alive(const remote::RemoteStorage& storage,
+                  const remote::RemoteStorage::Backend::Params& params);
+};
+
+RemoteLease::RemoteLease(const Digest& key,
+                         std::string owner,
+                         const std::chrono::milliseconds ttl,
+                         std::shared_ptr<remote::RemoteStorage> storage,
+                         remote::RemoteStorage::Backend::Params params)
+  : m_key(key),
+    m_owner(std::move(owner)),
+    m_ttl(ttl)
+{
+  m_keep_alive_thread = std::thread(
+    [this, storage = std::move(storage), params = std::move(params)] {
+      keep_alive(*storage, params);
+    });
+}
+
+RemoteLease::~RemoteLease()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_stop_keep_alive_mutex);
+    m_stop_keep_alive = true;
+  }
+  m_stop_keep_alive_condition.notify_one();
+  m_keep_alive_thread.join();
+}
+
+const std::string&
+RemoteLease::owner() const
+{
+  return m_owner;
+}
+
+void
+RemoteLease::keep_alive(const remote::RemoteStorage& storage,
+                        const remote::RemoteStorage::Backend::Params& params)
+{
+  std::unique_ptr<remote::RemoteStorage::Backend> backend;
+  try {
+    backend = storage.create_backend(params);
+  } catch (const std::exception& e) {
+    LOG("Failed to construct backend for renewing lease on {}: {}",
+        m_key.to_string(),
+        e.what());
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(m_stop_keep_alive_mutex);
+  while (!m_stop_keep_alive_condition.wait_for(
+    lock, m_ttl / 3, [this] { return m_stop_keep_alive; })) {
+    lock.unlock();
+    const auto renewed = backend->renew_lease(m_key, m_owner, m_ttl);
+    lock.lock();
+    if (renewed && !*renewed) {
+      LOG("Lost lease on {} to somebody else", m_key.to_string());
+      return;
+    }
+    // On failure, try again next time since the lease hasn't expired yet.
+  }
+}
+
+static std::string
+generate_lease_owner()
+{
+  std::random_device random_device;
+  std::uniform_int_distribution<uint64_t> distribution;
+  return FMT(
+    "{:016x}{:016x}", distribution(random_device), distribution(random_device));
+}
+
 // Define the destructor in the implementation file to avoid having to declare
 // RemoteStorageEntry and its constituents in the header file.
 // NOLINTNEXTLINE(modernize-use-equals-default)
@@ -227,7 +371,10 @@ Storage::initialize()
 void
 Storage::finalize()
 {
+  backfill_remote_storage();
+  add_pending_fleet_statistics();
   local.finalize();
+  push_fleet_statistics_in_background();
 }
 
 void
@@ -237,6 +384,13 @@ Storage::get(const Digest& key,
 {
   MTR_SCOPE("storage", "get");
 
+  // Manifests are mutable, so remember which remote version a local copy is
+  // based on to be able to revalidate it cheaply instead of transferring it
+  // again.
+  const bool use_version_tag =
+    type == core::CacheEntryType::manifest && !m_config.remote_only();
+  std::optional<std::string> version_tag;
+
   if (!m_config.remote_only()) {
     auto value = local.get(key, type);
     local.increment_statistic(value ? core::Statistic::local_storage_hit
@@ -245,31 +399,65 @@ Storage::get(const Digest& key,
       if (m_config.reshare()) {
         put_in_remote_storage(key, *value, true);
       }
+      const auto local_version =
+        use_version_tag ? local::LocalStorage::get_local_version(*value) : "";
       if (entry_receiver(std::move(*value))) {
         return;
       }
+      if (use_version_tag) {
+        version_tag = local.get_remote_version_tag(key, type, local_version);
+      }
     }
   }
 
-  get_from_remote_storage(key, [&](util::Bytes&& data) {
-    if (!m_config.remote_only()) {
-      local.put(key, type, data, true);
-    }
-    return entry_receiver(std::move(data));
-  });
+  get_from_remote_storage(
+    key,
+    use_version_tag ? version_tag.value_or("") : std::optional<std::string>(),
+    [&](util::Bytes&& data, const std::string& new_version_tag) {
+      if (!m_config.remote_only()) {
+        local.put(key, type, data, true);
+        if (use_version_tag && !new_version_tag.empty()) {
+          local.set_remote_version_tag(
+            key,
+            type,
+            local::LocalStorage::get_local_version(data),
+            new_version_tag);
+        }
+      }
+      return entry_receiver(std::move(data));
+    });
 }
 
 void
 Storage::put(const Digest& key,
              const core::CacheEntryType type,
              nonstd::span<const uint8_t> value)
+{
+  put(key, type, value, value);
+}
+
+void
+Storage::put(const Digest& key,
+             const core::CacheEntryType type,
+             nonstd::span<const uint8_t> value,
+             nonstd::span<const uint8_t> remote_value)
+{
+  put(key, type, value, remote_value, {});
+}
+
+void
+Storage::put(const Digest& key,
+             const core::CacheEntryType type,
+             nonstd::span<const uint8_t> value,
+             nonstd::span<const uint8_t> remote_value,
+             const ValueMerger& merger)
 {
   MTR_SCOPE("storage", "put");
 
-  if (!m_config.remote_only()) {
+  if (puts_locally()) {
     local.put(key, type, value);
   }
-  put_in_remote_storage(key, value, false);
+  put_in_remote_storage(key, remote_value, false, merger);
 }
 
 void
@@ -283,6 +471,126 @@ Storage::remove(const Digest& key, const core::CacheEntryType type)
   remove_from_remote_storage(key);
 }
 
+void
+Storage::skip_local_puts()
+{
+  m_skip_local_puts = true;
+}
+
+bool
+Storage::puts_locally() const
+{
+  return !m_config.remote_only() && !m_skip_local_puts;
+}
+
+Storage::LeaseResult
+Storage::acquire_remote_lease(const Digest& key,
+                              const std::chrono::milliseconds ttl)
+{
+  MTR_SCOPE("remote_storage", "acquire_lease");
+
+  auto entry = get_lease_storage();
+  auto backend =
+    entry ? get_backend(*entry, key, "taking lease in", true) : nullptr;
+  if (!backend) {
+    return LeaseResult::unavailable;
+  }
+
+  // The owner token lets the backend tell our lease apart from a lease taken
+  // by somebody else after ours expired.
+  auto owner = generate_lease_owner();
+  Timer timer;
+  const auto result = backend->impl->acquire_lease(key, owner, ttl);
+  const auto ms = timer.measure_ms();
+  if (!result) {
+    mark_backend_as_failed(*backend, result.error());
+    return LeaseResult::unavailable;
+  }
+
+  LOG("{} lease on {} in {} ({:.2f} ms)",
+      *result ? "Took" : "Somebody else holds",
+      key.to_string(),
+      backend->url_for_logging,
+      ms);
+  if (!*result) {
+    return LeaseResult::held;
+  }
+
+  auto params = entry->config.params;
+  params.url = backend->url;
+  m_remote_lease = std::make_unique<RemoteLease>(
+    key, std::move(owner), ttl, entry->storage, std::move(params));
+  return LeaseResult::acquired;
+}
+
+bool
+Storage::has_remote_lease(const Digest& key)
+{
+  MTR_SCOPE("remote_storage", "has_lease");
+
+  auto backend = get_lease_backend(key, "checking lease in");
+  if (!backend) {
+    return false;
+  }
+
+  const auto result = backend->impl->has_lease(key);
+  if (!result) {
+    mark_backend_as_failed(*backend, result.error());
+    return false;
+  }
+  return *result;
+}
+
+void
+Storage::release_remote_lease(const Digest& key)
+{
+  MTR_SCOPE("remote_storage", "release_lease");
+
+  if (!m_remote_lease) {
+    return;
+  }
+  const auto owner = m_remote_lease->owner();
+  m_remote_lease.reset(); // Stop renewing the lease.
+
+  auto backend = get_lease_backend(key, "releasing lease in");
+  if (!backend) {
+    return;
+  }
+
+  const auto result = backend->impl->release_lease(key, owner);
+  if (!result) {
+    mark_backend_as_failed(*backend, result.error());
+    return;
+  }
+  LOG("{} lease on {} in {}",
+      *result ? "Released" : "Somebody else has taken over the",
+      key.to_string(),
+      backend->url_for_logging);
+}
+
+core::StatisticsCounters
+Storage::get_fleet_statistics()
+{
+  auto entry = get_fleet_statistics_entry();
+  if (!entry) {
+    throw core::Error(
+      "no remote storage with the fleet-stats attribute is configured");
+  }
+  const auto key = fleet_statistics_key();
+  auto backend =
+    get_backend(*entry, key, "getting fleet statistics from", false);
+  if (!backend) {
+    throw core::Error(
+      FMT("failed to connect to remote storage {}", entry->url_for_logging));
+  }
+  const auto result = backend->impl->get_statistics(key);
+  if (!result) {
+    throw core::Error(FMT("failed to get fleet statistics from {}",
+                          backend->url_for_logging));
+  }
+  return *result;
+}
+
 bool
 Storage::has_remote_storage() const
 {
@@ -423,12 +731,56 @@ Storage::get_backend(RemoteStorageEntry& entry,
   }
 }
 
+RemoteStorageEntry*
+Storage::get_lease_storage()
+{
+  for (const auto& entry : m_remote_storages) {
+    if (entry->config.lease) {
+      return entry.get();
+    }
+  }
+  return nullptr;
+}
+
+RemoteStorageBackendEntry*
+Storage::get_lease_backend(const Digest& key,
+                           const std::string_view operation_description)
+{
+  auto entry = get_lease_storage();
+  return entry ? get_backend(*entry, key, operation_description, true)
+               : nullptr;
+}
+
+// A version tag is "<url> <version>" where <url> identifies the backend that
+// issued <version>.
+static std::string
+format_version_tag(const RemoteStorageBackendEntry& backend,
+                   const std::string& version)
+{
+  return version.empty() ? ""
+                         : FMT("{} {}", backend.url_for_logging, version);
+}
+
+static std::string
+get_version_from_tag(const RemoteStorageBackendEntry& backend,
+                     const std::string& version_tag)
+{
+  const auto [url, version] = util::split_once(version_tag, ' ');
+  return url == backend.url_for_logging && version ? std::string(*version)
+                                                   : "";
+}
+
 void
-Storage::get_from_remote_storage(const Digest& key,
-                                 const EntryReceiver& entry_receiver)
+Storage::get_from_remote_storage(
+  const Digest& key,
+  const std::optional<std::string>& version_tag,
+  const VersionedEntryReceiver& entry_receiver)
 {
   MTR_SCOPE("remote_storage", "get");
 
+  // Earlier remote storages with the backfill attribute that missed the entry.
+  std::vector<RemoteStorageEntry*> backfill_entries;
+
   for (const auto& entry : m_remote_storages) {
     auto backend = get_backend(*entry, key, "getting from", false);
     if (!backend) {
@@ -436,21 +788,48 @@ Storage::get_from_remote_storage(const Digest& key,
     }
 
     Timer timer;
-    auto result = backend->impl->get(key);
-    const auto ms = timer.measure_ms();
-    if (!result) {
-      mark_backend_as_failed(*backend, result.error());
-      continue;
+    remote::RemoteStorage::Backend::ConditionalGetResult result;
+    if (version_tag) {
+      auto conditional_result = backend->impl->get_if_changed(
+        key, get_version_from_tag(*backend, *version_tag));
+      if (!conditional_result) {
+        mark_backend_as_failed(*backend, conditional_result.error());
+        continue;
+      }
+      result = std::move(*conditional_result);
+    } else {
+      auto value = backend->impl->get(key);
+      if (!value) {
+        mark_backend_as_failed(*backend, value.error());
+        continue;
+      }
+      result.value = std::move(*value);
     }
+    const auto ms = timer.measure_ms();
 
-    auto& value = *result;
-    if (value) {
+    auto& value = result.value;
+    if (result.unchanged) {
+      LOG("{} in {} is unchanged ({:.2f} ms)",
+          key.to_string(),
+          backend->url_for_logging,
+          ms);
+    } else if (value) {
       LOG("Retrieved {} from {} ({:.2f} ms)",
           key.to_string(),
           backend->url_for_logging,
           ms);
       local.increment_statistic(core::Statistic::remote_storage_hit);
-      if (entry_receiver(std::move(*value))) {
+      std::optional<util::Bytes> backfill_value;
+      if (!backfill_entries.empty()) {
+        backfill_value = *value;
+      }
+      if (entry_receiver(std::move(*value),
+                         format_version_tag(*backend, result.version))) {
+        if (backfill_value) {
+          m_remote_backfills.push_back(
+            std::make_unique<RemoteStorageBackfill>(RemoteStorageBackfill{
+              key, std::move(*backfill_value), std::move(backfill_entries)}));
+        }
         return;
       }
     } else {
@@ -459,6 +838,64 @@ Storage::get_from_remote_storage(const Digest& key,
           backend->url_for_logging,
           ms);
       local.increment_statistic(core::Statistic::remote_storage_miss);
+      if (entry->config.backfill && !entry->config.read_only) {
+        backfill_entries.push_back(entry.get());
+      }
+    }
+  }
+}
+
+// Put `value` of type `type` in `backend`. Manifests are versioned since local
+// copies of them are revalidated, see Storage::get.
+static nonstd::expected<bool, remote::RemoteStorage::Backend::Failure>
+put_in_backend(remote::RemoteStorage::Backend& backend,
+               const Digest& key,
+               const core::CacheEntryType type,
+               nonstd::span<const uint8_t> value,
+               bool only_if_missing)
+{
+  return type == core::CacheEntryType::manifest
+           ? backend.put_versioned(key, value, only_if_missing)
+           : backend.put(key, value, only_if_missing);
+}
+
+// Put `value` merged with the entry already present, if any, in `backend`. The
+// entry is only replaced if nobody else changed it in the meantime so that
+// concurrent merges don't lose each other's additions.
+static nonstd::expected<bool, remote::RemoteStorage::Backend::Failure>
+merge_into_backend(remote::RemoteStorage::Backend& backend,
+                   const Digest& key,
+                   nonstd::span<const uint8_t> value,
+                   const Storage::ValueMerger& merger)
+{
+  const size_t max_attempts = 5;
+
+  for (size_t attempt = 1;; ++attempt) {
+    auto current = backend.get_if_changed(key, "");
+    if (!current) {
+      return nonstd::make_unexpected(current.error());
+    }
+
+    if (!current->value) {
+      const auto result = backend.put_if_unchanged(key, value, "");
+      if (!result || *result) {
+        return result;
+      }
+    } else if (current->version.empty()) {
+      // The backend doesn't keep track of versions, so just overwrite.
+      return backend.put_versioned(key, merger(*current->value));
+    } else {
+      const auto merged = merger(*current->value);
+      const auto result =
+        backend.put_if_unchanged(key, merged, current->version);
+      if (!result || *result) {
+        return result;
+      }
+    }
+
+    if (attempt == max_attempts) {
+      LOG("Giving up merging {} after {} attempts", key.to_string(), attempt);
+      return false;
     }
   }
 }
@@ -466,11 +903,13 @@ Storage::get_from_remote_storage(const Digest& key,
 void
 Storage::put_in_remote_storage(const Digest& key,
                                nonstd::span<const uint8_t> value,
-                               bool only_if_missing)
+                               bool only_if_missing,
+                               const ValueMerger& merger)
 {
   MTR_SCOPE("remote_storage", "put");
 
-  if (!core::CacheEntry::Header(value).self_contained) {
+  const core::CacheEntry::Header header(value);
+  if (!header.self_contained) {
     LOG("Not putting {} in remote storage since it's not self-contained",
         key.to_string());
     return;
@@ -483,7 +922,11 @@ Storage::put_in_remote_storage(const Digest& key,
     }
 
     Timer timer;
-    const auto result = backend->impl->put(key, value, only_if_missing);
+    const auto result =
+      merger && entry->config.merge_manifests
+        ? merge_into_backend(*backend->impl, key, value, merger)
+        : put_in_backend(
+          *backend->impl, key, header.entry_type, value, only_if_missing);
     const auto ms = timer.measure_ms();
     if (!result) {
       // The backend is expected to log details about the error.
@@ -500,6 +943,153 @@ Storage::put_in_remote_storage(const Digest& key,
   }
 }
 
+void
+Storage::backfill_remote_storage()
+{
+  MTR_SCOPE("remote_storage", "backfill");
+
+  for (const auto& backfill : m_remote_backfills) {
+    for (auto* entry : backfill->entries) {
+      auto backend = get_backend(*entry, backfill->key, "backfilling", true);
+      if (!backend) {
+        continue;
+      }
+
+      Timer timer;
+      // Don't overwrite an entry that was stored after the miss. The value
+      // has been accepted by the entry receiver, so the header is valid.
+      const auto result = put_in_backend(
+        *backend->impl,
+        backfill->key,
+        core::CacheEntry::Header(backfill->value).entry_type,
+        backfill->value,
+        true);
+      const auto ms = timer.measure_ms();
+      if (!result) {
+        mark_backend_as_failed(*backend, result.error());
+        continue;
+      }
+
+      LOG("{} {} in {} ({:.2f} ms)",
+          *result ? "Backfilled" : "Did not have to backfill",
+          backfill->key.to_string(),
+          backend->url_for_logging,
+          ms);
+    }
+  }
+  m_remote_backfills.clear();
+}
+
+RemoteStorageEntry*
+Storage::get_fleet_statistics_entry() const
+{
+  for (const auto& entry : m_remote_storages) {
+    if (entry->config.fleet_stats) {
+      return entry.get();
+    }
+  }
+  return nullptr;
+}
+
+void
+Storage::add_pending_fleet_statistics()
+{
+  if (!get_fleet_statistics_entry() || !m_config.stats()) {
+    return;
+  }
+
+  // The size of the local cache is not a fleet statistic.
+  auto updates = local.get_statistics_updates();
+  updates.set(core::Statistic::cache_size_kibibyte, 0);
+  updates.set(core::Statistic::files_in_cache, 0);
+  if (!updates.all_zero()) {
+    local.add_pending_fleet_statistics(updates);
+  }
+}
+
+void
+Storage::push_fleet_statistics_in_background()
+{
+#ifndef _WIN32
+  auto entry = get_fleet_statistics_entry();
+  if (!entry || !m_config.stats()
+      || !local.is_fleet_statistics_push_due(
+        entry->config.fleet_stats_interval)) {
+    return;
+  }
+
+  const pid_t pid = fork();
+  if (pid == -1) {
+    LOG("Failed to fork for pushing fleet statistics: {}", strerror(errno));
+    return;
+  } else if (pid != 0) {
+    LOG("Pushing fleet statistics in process {}", pid);
+    return;
+  }
+
+  // Child: Detach from the session and the output of the compilation so that
+  // the build doesn't wait for it, and don't run the parent's signal handler.
+  setsid();
+  for (const int signum : {SIGINT, SIGTERM, SIGHUP, SIGQUIT}) {
+    signal(signum, SIG_DFL);
+  }
+  const int null_fd = open("/dev/null", O_RDWR);
+  if (null_fd != -1) {
+    dup2(null_fd, STDIN_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    close(null_fd);
+  }
+  try {
+    push_fleet_statistics();
+  } catch (const core::ErrorBase& e) {
+    LOG("Failed to push fleet statistics: {}", e.what());
+  }
+  _exit(0);
+#endif
+}
+
+void
+Storage::push_fleet_statistics(const bool force)
+{
+  MTR_SCOPE("remote_storage", "push_fleet_statistics");
+
+  auto entry = get_fleet_statistics_entry();
+  if (!entry) {
+    return;
+  }
+
+  const auto pending = local.take_pending_fleet_statistics(
+    force ? std::nullopt
+          : std::optional(entry->config.fleet_stats_interval));
+  if (!pending) {
+    return;
+  }
+
+  const auto key = fleet_statistics_key();
+  auto backend = get_backend(*entry, key, "pushing fleet statistics to", true);
+  if (!backend) {
+    local.add_pending_fleet_statistics(*pending);
+    return;
+  }
+
+  Timer timer;
+  const auto result = backend->impl->add_statistics(key, *pending);
+  const auto ms = timer.measure_ms();
+  if (!result) {
+    mark_backend_as_failed(*backend, result.error());
+  }
+  if (!result || !*result) {
+    // Try again next time.
+    local.add_pending_fleet_statistics(*pending);
+    return;
+  }
+
+  LOG("Pushed fleet statistics to {} ({:.2f} ms)",
+      backend->url_for_logging,
+      ms);
+}
+
 void
 Storage::remove_from_remote_storage(const Digest& key)
 {
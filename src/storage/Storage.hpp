@@ -26,6 +26,7 @@
 
 #include <third_party/nonstd/span.hpp>
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -38,7 +39,9 @@ namespace storage {
 
 std::string get_features();
 
+class RemoteLease;
 struct RemoteStorageBackendEntry;
+struct RemoteStorageBackfill;
 struct RemoteStorageEntry;
 
 class Storage
@@ -62,14 +65,71 @@ public:
            core::CacheEntryType type,
            nonstd::span<const uint8_t> value);
 
+  // Like above but put `remote_value` instead of `value` in remote storage.
+  void put(const Digest& key,
+           core::CacheEntryType type,
+           nonstd::span<const uint8_t> value,
+           nonstd::span<const uint8_t> remote_value);
+
+  // Return the value to put in remote storage when `current` is already
+  // present.
+  using ValueMerger =
+    std::function<util::Bytes(nonstd::span<const uint8_t> current)>;
+
+  // Like above but in remote storages with the merge-manifests attribute,
+  // merge `remote_value` with the entry already present using `merger` and only
+  // replace the entry if nobody else has changed it in the meantime.
+  void put(const Digest& key,
+           core::CacheEntryType type,
+           nonstd::span<const uint8_t> value,
+           nonstd::span<const uint8_t> remote_value,
+           const ValueMerger& merger);
+
   void remove(const Digest& key, core::CacheEntryType type);
 
+  // Don't put entries in local storage for the rest of the invocation, e.g.
+  // because the result was not admitted.
+  void skip_local_puts();
+
+  // Return true if put() stores entries in local storage.
+  bool puts_locally() const;
+
+  enum class LeaseResult {
+    acquired,   // The lease was taken by this process.
+    held,       // Somebody else holds the lease.
+    unavailable // No remote storage supports leases or the operation failed.
+  };
+
+  // Try to take a lease on `key` in the first remote storage that has leases
+  // enabled. The lease is renewed in the background until released, so it
+  // only expires `ttl` after this process stops renewing it.
+  LeaseResult acquire_remote_lease(const Digest& key,
+                                   std::chrono::milliseconds ttl);
+
+  // Return true if somebody holds an unexpired remote lease on `key`.
+  bool has_remote_lease(const Digest& key);
+
+  // Release the remote lease on `key` if it was taken by this process.
+  void release_remote_lease(const Digest& key);
+
+  // Get the statistics aggregated from all hosts in the first remote storage
+  // with the fleet-stats attribute. Throws core::Error on failure.
+  core::StatisticsCounters get_fleet_statistics();
+
+  // Push the statistics of this host not yet pushed to the first remote
+  // storage with the fleet-stats attribute. Unless `force` is true, nothing is
+  // pushed until fleet-stats-interval has passed since the last push.
+  void push_fleet_statistics(bool force = false);
+
   bool has_remote_storage() const;
   std::string get_remote_storage_config_for_logging() const;
 
 private:
   const Config& m_config;
   std::vector<std::unique_ptr<RemoteStorageEntry>> m_remote_storages;
+  std::vector<std::unique_ptr<RemoteStorageBackfill>> m_remote_backfills;
+  std::unique_ptr<RemoteLease> m_remote_lease;
+  bool m_skip_local_puts = false;
 
   void add_remote_storages();
 
@@ -81,14 +141,43 @@ private:
                                          std::string_view operation_description,
                                          const bool for_writing);
 
+  RemoteStorageEntry* get_lease_storage();
+
+  RemoteStorageBackendEntry*
+  get_lease_backend(const Digest& key, std::string_view operation_description);
+
+  using VersionedEntryReceiver =
+    std::function<bool(util::Bytes&& value, const std::string& version_tag)>;
+
+  // Get `key` from remote storage. If `version_tag` is set, versions of entries
+  // are tracked and an entry matching a non-empty `version_tag` is not
+  // transferred again.
   void get_from_remote_storage(const Digest& key,
-                               const EntryReceiver& entry_receiver);
+                               const std::optional<std::string>& version_tag,
+                               const VersionedEntryReceiver& entry_receiver);
 
   void put_in_remote_storage(const Digest& key,
                              nonstd::span<const uint8_t> value,
-                             bool only_if_missing);
+                             bool only_if_missing,
+                             const ValueMerger& merger = {});
+
+  // Write entries retrieved from remote storage to earlier remote storages
+  // with the backfill attribute that missed them. This is deferred to
+  // finalize() so that it doesn't delay delivering the result.
+  void backfill_remote_storage();
 
   void remove_from_remote_storage(const Digest& key);
+
+  RemoteStorageEntry* get_fleet_statistics_entry() const;
+
+  // Add the statistics updates of this invocation to the pending fleet
+  // statistics, to be pushed by push_fleet_statistics.
+  void add_pending_fleet_statistics();
+
+  // Push the pending fleet statistics from a detached child process if
+  // fleet-stats-interval has passed since the last push, so that the
+  // compilation doesn't wait for remote storage.
+  void push_fleet_statistics_in_background();
 };
 
 } // namespace storage
@@ -0,0 +1,212 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "CacheAnalysis.hpp"
+
+#include <Util.hpp>
+#include <fmtmacros.hpp>
+#include <util/TextTable.hpp>
+#include <util/string.hpp>
+
+#include <iterator>
+#include <vector>
+
+namespace storage::local {
+
+namespace {
+
+const char* const k_age_labels[] = {
+  "< 1 hour", "< 1 day", "< 1 week", "< 30 days", ">= 30 days"};
+
+const char* const k_manifest_size_labels[] = {
+  "< 4 KiB", "< 16 KiB", "< 64 KiB", "< 256 KiB", ">= 256 KiB"};
+
+const char* const k_manifest_result_labels[] = {
+  "<= 1", "2-4", "5-16", "17-64", ">= 65"};
+
+static_assert(std::size(k_age_labels)
+              == CacheAnalysis::k_age_limits.size() + 1);
+static_assert(std::size(k_manifest_size_labels)
+              == CacheAnalysis::k_manifest_size_limits.size() + 1);
+static_assert(std::size(k_manifest_result_labels)
+              == CacheAnalysis::k_manifest_result_limits.size() + 1);
+
+double
+compression_ratio(const CacheAnalysis::CompressionAmount& amount)
+{
+  return amount.size > 0 ? static_cast<double>(amount.content_size)
+                             / static_cast<double>(amount.size)
+                         : 0.0;
+}
+
+std::string
+compression_level_name(const std::optional<int8_t> level)
+{
+  return level ? FMT("{}", *level) : "uncompressed";
+}
+
+util::TextTable::Cell
+size_cell(const uint64_t size)
+{
+  return util::TextTable::Cell(Util::format_human_readable_size(size))
+    .right_align();
+}
+
+void
+add_amount_row(util::TextTable& table,
+               const std::string& label,
+               const CacheAnalysis::Amount& amount)
+{
+  table.add_row({FMT("  {}:", label), amount.count, size_cell(amount.size)});
+}
+
+template<typename T>
+void
+add_histogram_rows(util::TextTable& table,
+                   const T& histogram,
+                   const char* const* labels)
+{
+  for (size_t i = 0; i < histogram.size(); ++i) {
+    add_amount_row(table, labels[i], histogram[i]);
+  }
+}
+
+std::string
+format_json_amount(const CacheAnalysis::Amount& amount)
+{
+  return FMT("{{\"count\": {}, \"size\": {}}}", amount.count, amount.size);
+}
+
+std::string
+format_json_amounts(const std::map<std::string, CacheAnalysis::Amount>& map)
+{
+  std::vector<std::string> entries;
+  for (const auto& [name, amount] : map) {
+    entries.push_back(FMT(
+      "\"{}\": {}", util::escape_json(name), format_json_amount(amount)));
+  }
+  return FMT("{{{}}}", util::join(entries, ", "));
+}
+
+// Format `histogram` as a list of buckets with their exclusive upper bounds.
+template<typename T, typename L>
+std::string
+format_json_histogram(const T& histogram, const L& limits)
+{
+  std::vector<std::string> entries;
+  for (size_t i = 0; i < histogram.size(); ++i) {
+    entries.push_back(
+      FMT("{{\"below\": {}, \"count\": {}, \"size\": {}}}",
+          i < limits.size() ? FMT("{}", limits[i]) : "null",
+          histogram[i].count,
+          histogram[i].size));
+  }
+  return FMT("[{}]", util::join(entries, ", "));
+}
+
+} // namespace
+
+std::string
+CacheAnalysis::format_human_readable() const
+{
+  using C = util::TextTable::Cell;
+  util::TextTable table;
+
+  table.add_row(
+    {"Entry types:", C("Files").right_align(), C("Size").right_align()});
+  for (const auto& [name, amount] : entry_types) {
+    add_amount_row(table, name, amount);
+  }
+
+  table.add_heading("Result file types (uncompressed):");
+  for (const auto& [name, amount] : file_types) {
+    add_amount_row(table, name, amount);
+  }
+
+  table.add_heading("Age:");
+  add_histogram_rows(table, age, k_age_labels);
+
+  table.add_heading("Time since last hit:");
+  add_histogram_rows(table, last_hit, k_age_labels);
+  add_amount_row(table, "never hit", never_hit);
+
+  table.add_heading("Compression levels:");
+  for (const auto& [level, amount] : compression_levels) {
+    table.add_row({FMT("  {}:", compression_level_name(level)),
+                   amount.count,
+                   size_cell(amount.size),
+                   FMT("({:.3f} x)", compression_ratio(amount))});
+  }
+
+  table.add_heading("Duplicated result files:");
+  add_amount_row(table, "duplicates", duplicated);
+
+  table.add_heading("Manifest sizes:");
+  add_histogram_rows(table, manifest_sizes, k_manifest_size_labels);
+
+  table.add_heading("Results per manifest:");
+  add_histogram_rows(table, manifest_results, k_manifest_result_labels);
+  table.add_row({"  max:", max_manifest_results});
+
+  table.add_heading("Namespaces:");
+  for (const auto& [name, amount] : namespaces) {
+    add_amount_row(table, name.empty() ? "(none)" : name, amount);
+  }
+
+  return table.render();
+}
+
+std::string
+CacheAnalysis::format_json() const
+{
+  std::vector<std::string> levels;
+  for (const auto& [level, amount] : compression_levels) {
+    levels.push_back(FMT(
+      "\"{}\": {{\"count\": {}, \"size\": {}, \"content_size\": {},"
+      " \"ratio\": {:.3f}}}",
+      compression_level_name(level),
+      amount.count,
+      amount.size,
+      amount.content_size,
+      compression_ratio(amount)));
+  }
+
+  std::string result = "{\n";
+  result += FMT("  \"entry_types\": {},\n", format_json_amounts(entry_types));
+  result += FMT("  \"file_types\": {},\n", format_json_amounts(file_types));
+  result +=
+    FMT("  \"age\": {},\n", format_json_histogram(age, k_age_limits));
+  result += FMT("  \"last_hit\": {},\n",
+                format_json_histogram(last_hit, k_age_limits));
+  result += FMT("  \"never_hit\": {},\n", format_json_amount(never_hit));
+  result +=
+    FMT("  \"compression_levels\": {{{}}},\n", util::join(levels, ", "));
+  result += FMT("  \"duplicated\": {},\n", format_json_amount(duplicated));
+  result +=
+    FMT("  \"manifest_sizes\": {},\n",
+        format_json_histogram(manifest_sizes, k_manifest_size_limits));
+  result +=
+    FMT("  \"manifest_results\": {},\n",
+        format_json_histogram(manifest_results, k_manifest_result_limits));
+  result += FMT("  \"max_manifest_results\": {},\n", max_manifest_results);
+  result += FMT("  \"namespaces\": {}\n", format_json_amounts(namespaces));
+  result += "}\n";
+  return result;
+}
+
+} // namespace storage::local
@@ -0,0 +1,129 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace storage::local {
+
+// Summary of the content of the local cache, as computed by
+// LocalStorage::analyze.
+struct CacheAnalysis
+{
+  struct Amount
+  {
+    uint64_t count = 0;
+    uint64_t size = 0;
+
+    void add(uint64_t size);
+    Amount& operator+=(const Amount& other);
+  };
+
+  struct CompressionAmount
+  {
+    uint64_t count = 0;
+    uint64_t size = 0;         // Size of cache entry files.
+    uint64_t content_size = 0; // Size of uncompressed cache entries.
+  };
+
+  // Upper bounds (exclusive) of the age buckets in seconds. The last bucket
+  // has no upper bound.
+  static constexpr std::array<uint64_t, 4> k_age_limits{
+    3600, 24 * 3600, 7 * 24 * 3600, 30 * 24 * 3600};
+
+  // Upper bounds (exclusive) of the manifest size buckets in bytes.
+  static constexpr std::array<uint64_t, 4> k_manifest_size_limits{
+    4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024};
+
+  // Upper bounds (exclusive) of the results per manifest buckets.
+  static constexpr std::array<uint64_t, 4> k_manifest_result_limits{
+    2, 5, 17, 65};
+
+  using AgeHistogram = std::array<Amount, k_age_limits.size() + 1>;
+
+  // Files per type: "manifest", "result", "raw" or "unknown".
+  std::map<std::string, Amount> entry_types;
+
+  // Files stored in results per Result::FileType name. Sizes are uncompressed.
+  std::map<std::string, Amount> file_types;
+
+  // Manifests and results per time since creation.
+  AgeHistogram age;
+
+  // Manifests and results per time since last written or retrieved.
+  AgeHistogram last_hit;
+
+  // Manifests and results that have not been retrieved since created.
+  Amount never_hit;
+
+  // Manifests and results per compression level (std::nullopt means
+  // uncompressed).
+  std::map<std::optional<int8_t>, CompressionAmount> compression_levels;
+
+  // Files stored in results with the same content as an earlier seen file. The
+  // size is the number of bytes that would be saved if all copies were shared.
+  Amount duplicated;
+
+  // Manifests per size.
+  std::array<Amount, k_manifest_size_limits.size() + 1> manifest_sizes;
+
+  // Manifests per number of referenced results.
+  std::array<Amount, k_manifest_result_limits.size() + 1> manifest_results;
+  uint64_t max_manifest_results = 0;
+
+  // Manifests and results per namespace ("" means no namespace).
+  std::map<std::string, Amount> namespaces;
+
+  std::string format_human_readable() const;
+  std::string format_json() const;
+};
+
+// Return the index of the bucket that `value` belongs to given the upper
+// bounds in `limits`.
+template<typename T>
+size_t
+bucket_index(const T& limits, const uint64_t value)
+{
+  size_t i = 0;
+  while (i < limits.size() && value >= limits[i]) {
+    ++i;
+  }
+  return i;
+}
+
+inline void
+CacheAnalysis::Amount::add(const uint64_t size_)
+{
+  ++count;
+  size += size_;
+}
+
+inline CacheAnalysis::Amount&
+CacheAnalysis::Amount::operator+=(const Amount& other)
+{
+  count += other.count;
+  size += other.size;
+  return *this;
+}
+
+} // namespace storage::local
@@ -41,6 +41,8 @@ CacheFile::type() const
     return Type::result;
   } else if (util::ends_with(m_path, "W")) {
     return Type::raw;
+  } else if (util::ends_with(m_path, "V")) {
+    return Type::remote_version_tag;
   } else {
     return Type::unknown;
   }
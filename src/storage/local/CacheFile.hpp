@@ -26,7 +26,7 @@
 class CacheFile
 {
 public:
-  enum class Type { result, manifest, raw, unknown };
+  enum class Type { result, manifest, raw, remote_version_tag, unknown };
 
   explicit CacheFile(const std::string& path);
 
@@ -0,0 +1,154 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "Doorkeeper.hpp"
+
+#include <Digest.hpp>
+#include <Fd.hpp>
+#include <Logging.hpp>
+#include <Stat.hpp>
+#include <Util.hpp>
+#include <fmtmacros.hpp>
+
+#include <fcntl.h>
+
+#ifndef _WIN32
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+#include <cstring>
+
+namespace storage::local {
+
+struct Doorkeeper::SharedRegion
+{
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t insertions;
+  uint8_t bits[k_bits / 8];
+};
+
+static_assert(Digest::size() >= 4 * Doorkeeper::k_hashes);
+
+Doorkeeper::Doorkeeper(const std::string& path) : m_path(path)
+{
+}
+
+#ifndef _WIN32
+
+Doorkeeper::~Doorkeeper()
+{
+  if (m_sr) {
+    munmap(m_sr, sizeof(SharedRegion));
+  }
+}
+
+bool
+Doorkeeper::check_and_add(const Digest& key)
+{
+  if (!m_sr && !map_file()) {
+    return true;
+  }
+
+  // The key is a cryptographic hash, so its bytes can be used as independent
+  // hash values.
+  bool seen = true;
+  for (size_t i = 0; i < k_hashes; ++i) {
+    uint32_t hash;
+    Util::big_endian_to_int(key.bytes() + 4 * i, hash);
+    const size_t bit = hash % k_bits;
+    const uint8_t mask = 1U << (bit % 8);
+    const uint8_t old =
+      __atomic_fetch_or(&m_sr->bits[bit / 8], mask, __ATOMIC_RELAXED);
+    if (!(old & mask)) {
+      seen = false;
+    }
+  }
+
+  if (!seen
+      && __atomic_add_fetch(&m_sr->insertions, 1, __ATOMIC_RELAXED)
+           == k_max_insertions) {
+    LOG("Clearing doorkeeper {} after {} insertions", m_path, k_max_insertions);
+    memset(m_sr->bits, 0, sizeof(m_sr->bits));
+    __atomic_store_n(&m_sr->insertions, 0, __ATOMIC_RELAXED);
+  }
+
+  return seen;
+}
+
+bool
+Doorkeeper::map_file()
+{
+  Fd fd(open(m_path.c_str(), O_RDWR | O_CREAT, 0666));
+  if (!fd && errno == ENOENT && Util::create_dir(Util::dir_name(m_path))) {
+    fd = Fd(open(m_path.c_str(), O_RDWR | O_CREAT, 0666));
+  }
+  if (!fd) {
+    LOG("Failed to open {}: {}", m_path, strerror(errno));
+    return false;
+  }
+  const auto st = Stat::stat(m_path);
+  if (st.size() < sizeof(SharedRegion)
+      && ftruncate(*fd, sizeof(SharedRegion)) != 0) {
+    LOG("Failed to resize {}: {}", m_path, strerror(errno));
+    return false;
+  }
+  void* p = mmap(
+    nullptr, sizeof(SharedRegion), PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+  if (p == MAP_FAILED) {
+    LOG("Failed to mmap {}: {}", m_path, strerror(errno));
+    return false;
+  }
+  m_sr = static_cast<SharedRegion*>(p);
+
+  const uint32_t version = __atomic_load_n(&m_sr->version, __ATOMIC_RELAXED);
+  if (version != k_version) {
+    // A new file (version 0) or one written by another ccache version. Racing
+    // with another process doing the same is harmless.
+    if (version != 0) {
+      LOG("Resetting doorkeeper {} with version {}", m_path, version);
+    }
+    memset(m_sr->bits, 0, sizeof(m_sr->bits));
+    __atomic_store_n(&m_sr->insertions, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_sr->version, k_version, __ATOMIC_RELAXED);
+  }
+  return true;
+}
+
+#else
+
+Doorkeeper::~Doorkeeper()
+{
+}
+
+bool
+Doorkeeper::check_and_add(const Digest& /*key*/)
+{
+  return true;
+}
+
+bool
+Doorkeeper::map_file()
+{
+  return false;
+}
+
+#endif
+
+} // namespace storage::local
@@ -0,0 +1,73 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <NonCopyable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Digest;
+
+namespace storage::local {
+
+// A Bloom filter of recently missed keys, stored in a memory-mapped file shared
+// by all ccache processes using a cache directory. It's used as the
+// "doorkeeper" of TinyLFU admission control: a result is only admitted to local
+// storage if its key was seen before, which keeps results that are never
+// retrieved again (e.g. from one-off builds) from evicting useful ones.
+//
+// The filter is cleared after a fixed number of insertions so that it only
+// remembers recent keys and its false positive rate stays bounded. Concurrent
+// updates are lock-free; a lost update just makes the filter slightly less
+// accurate.
+class Doorkeeper : NonCopyable
+{
+public:
+  static constexpr uint32_t k_version = 1;
+
+  // Number of bits in the filter.
+  static constexpr size_t k_bits = size_t(1) << 23;
+
+  // Number of bits set for each key.
+  static constexpr size_t k_hashes = 4;
+
+  // Clear the filter after this many insertions, which keeps the false
+  // positive rate at about 2% or lower.
+  static constexpr uint64_t k_max_insertions = 1'000'000;
+
+  Doorkeeper(const std::string& path);
+  ~Doorkeeper();
+
+  // Record `key` and return true if it was (probably) recorded before since
+  // the filter was last cleared. Returns true if the filter file can't be used,
+  // i.e. everything is admitted on errors.
+  bool check_and_add(const Digest& key);
+
+private:
+  struct SharedRegion;
+
+  const std::string m_path;
+  SharedRegion* m_sr = nullptr;
+
+  bool map_file();
+};
+
+} // namespace storage::local
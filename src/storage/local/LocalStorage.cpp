@@ -27,9 +27,12 @@
 #include <core/exceptions.hpp>
 #include <core/wincompat.hpp>
 #include <fmtmacros.hpp>
+#include <storage/local/Doorkeeper.hpp>
 #include <storage/local/StatsFile.hpp>
 #include <util/Duration.hpp>
+#include <util/XXH3_64.hpp>
 #include <util/file.hpp>
+#include <util/string.hpp>
 
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
@@ -102,6 +105,8 @@ LocalStorage::finalize()
     clean_internal_tempdir();
   }
 
+  write_access_trace();
+
   if (!m_config.stats()) {
     return;
   }
@@ -185,13 +190,16 @@ LocalStorage::get(const Digest& key, const core::CacheEntryType type) const
   const auto cache_file = look_up_cache_file(key, type);
   if (!cache_file.stat) {
     LOG("No {} in local storage", key.to_string());
+    record_access(key, type, core::AccessTrace::Kind::miss, 0);
     return std::nullopt;
   }
   const auto value = util::read_file<util::Bytes>(cache_file.path);
   if (!value) {
     LOG("Failed to read {}: {}", cache_file.path, value.error());
+    record_access(key, type, core::AccessTrace::Kind::miss, 0);
     return std::nullopt;
   }
+  record_access(key, type, core::AccessTrace::Kind::hit, value->size());
 
   LOG("Retrieved {} from local storage ({})", key.to_string(), cache_file.path);
 
@@ -201,6 +209,12 @@ LocalStorage::get(const Digest& key, const core::CacheEntryType type) const
   return *value;
 }
 
+static std::string
+get_remote_version_tag_path(std::string_view entry_path)
+{
+  return FMT("{}V", entry_path.substr(0, entry_path.length() - 1));
+}
+
 void
 LocalStorage::put(const Digest& key,
                   const core::CacheEntryType type,
@@ -246,6 +260,7 @@ LocalStorage::put(const Digest& key,
   }
 
   LOG("Stored {} in local storage ({})", key.to_string(), cache_file.path);
+  record_access(key, type, core::AccessTrace::Kind::store, new_stat.size());
 
   auto& counter_updates = (type == core::CacheEntryType::manifest)
                             ? m_manifest_counter_updates
@@ -255,6 +270,12 @@ LocalStorage::put(const Digest& key,
     Util::size_change_kibibyte(cache_file.stat, new_stat));
   counter_updates.increment(Statistic::files_in_cache, cache_file.stat ? 0 : 1);
 
+  if (type == core::CacheEntryType::manifest && cache_file.stat) {
+    // The remote version tag, if any, belongs to the replaced manifest.
+    Util::unlink_safe(get_remote_version_tag_path(cache_file.path),
+                      Util::UnlinkLog::ignore_failure);
+  }
+
   // Make sure we have a CACHEDIR.TAG in the cache part of cache_dir. This can
   // be done almost anywhere, but we might as well do it near the end as we save
   // the stat call if we exit early.
@@ -330,6 +351,88 @@ LocalStorage::put_raw_files(
   }
 }
 
+// A remote version tag file contains "<local version> <tag>", where <local
+// version> identifies the content of the local entry that the tag applies to.
+// This makes a tag left behind by an entry that was later replaced or evicted
+// harmless.
+
+std::optional<std::string>
+LocalStorage::get_remote_version_tag(const Digest& key,
+                                     const core::CacheEntryType type,
+                                     std::string_view local_version) const
+{
+  const auto cache_file = look_up_cache_file(key, type);
+  if (!cache_file.stat) {
+    return std::nullopt;
+  }
+  const auto content = util::read_file<std::string>(
+    get_remote_version_tag_path(cache_file.path));
+  if (!content) {
+    return std::nullopt;
+  }
+  const auto [version, tag] = util::split_once(*content, ' ');
+  if (version != local_version || !tag) {
+    LOG("Ignoring remote version tag of other {} content", key.to_string());
+    return std::nullopt;
+  }
+  return std::string(*tag);
+}
+
+void
+LocalStorage::set_remote_version_tag(const Digest& key,
+                                     const core::CacheEntryType type,
+                                     std::string_view local_version,
+                                     std::string_view tag)
+{
+  const auto cache_file = look_up_cache_file(key, type);
+  const auto path = get_remote_version_tag_path(cache_file.path);
+  try {
+    AtomicFile file(path, AtomicFile::Mode::text);
+    file.write(FMT("{} {}", local_version, tag));
+    file.commit();
+  } catch (core::Error& e) {
+    LOG("Failed to write to {}: {}", path, e.what());
+  }
+}
+
+std::string
+LocalStorage::get_local_version(nonstd::span<const uint8_t> value)
+{
+  util::XXH3_64 hash;
+  hash.update(value.data(), value.size());
+  return FMT("{:016x}", hash.digest());
+}
+
+bool
+LocalStorage::admit(const Digest& key)
+{
+  if (m_config.admission_policy() == AdmissionPolicy::always) {
+    return true;
+  }
+
+  Doorkeeper doorkeeper(
+    FMT("{}/doorkeeper.v{}", m_config.cache_dir(), Doorkeeper::k_version));
+  if (doorkeeper.check_and_add(key)) {
+    return true;
+  }
+  LOG("Not admitting {} to local storage since it was not seen before",
+      key.to_string());
+  increment_statistic(Statistic::admission_rejected);
+  return false;
+}
+
+std::string
+LocalStorage::get_compile_slot_path(const uint32_t slot) const
+{
+  return FMT("{}/lock/compile_slot_{}", m_config.cache_dir(), slot);
+}
+
+std::string
+LocalStorage::get_compile_lease_path(const Digest& key) const
+{
+  return FMT("{}/lock/{}", m_config.cache_dir(), key.to_string());
+}
+
 void
 LocalStorage::increment_statistic(const Statistic statistic,
                                   const int64_t value)
@@ -343,8 +446,115 @@ LocalStorage::increment_statistics(const core::StatisticsCounters& statistics)
   m_result_counter_updates.increment(statistics);
 }
 
+void
+LocalStorage::add_pending_fleet_statistics(
+  const core::StatisticsCounters& updates)
+{
+  // The pending statistics are sharded like the local statistics. A shard
+  // locked by another process is skipped in favor of the next one, so an
+  // invocation only waits if all of them are locked.
+  const auto first_shard = static_cast<uint8_t>(getpid() % 16);
+  const auto add_updates = [&](auto& counters) { counters.increment(updates); };
+  for (uint8_t i = 0; i < 16; ++i) {
+    const auto shard = static_cast<uint8_t>((first_shard + i) % 16);
+    if (StatsFile(get_pending_fleet_statistics_path(shard))
+          .update(add_updates, util::LockFileGuard::Mode::non_blocking)) {
+      return;
+    }
+  }
+  StatsFile(get_pending_fleet_statistics_path(first_shard))
+    .update(add_updates);
+}
+
+std::optional<core::StatisticsCounters>
+LocalStorage::take_pending_fleet_statistics(
+  const std::optional<util::Duration> min_interval)
+{
+  // The "zeroed" timestamp of the taken file records when the pending
+  // statistics were last taken. Its lock makes concurrent takers skip.
+  const auto now = util::TimePoint::now();
+  core::StatisticsCounters taken;
+  StatsFile(get_taken_fleet_statistics_path())
+    .update(
+      [&](auto& taken_counters) {
+        const util::TimePoint last_taken(
+          taken_counters.get(Statistic::stats_zeroed_timestamp));
+        if (min_interval && now - last_taken < *min_interval) {
+          return;
+        }
+        taken_counters.set(Statistic::stats_zeroed_timestamp, now.sec());
+        for (uint8_t shard = 0; shard < 16; ++shard) {
+          StatsFile(get_pending_fleet_statistics_path(shard))
+            .update([&](auto& counters) {
+              taken.increment(counters);
+              counters = {};
+            });
+        }
+      },
+      util::LockFileGuard::Mode::non_blocking);
+  if (taken.all_zero()) {
+    return std::nullopt;
+  }
+  return taken;
+}
+
+bool
+LocalStorage::is_fleet_statistics_push_due(
+  const util::Duration min_interval) const
+{
+  // The taken file is rewritten each time the pending statistics are taken.
+  const auto stat = Stat::stat(get_taken_fleet_statistics_path());
+  return !stat || util::TimePoint::now() - stat.mtime() >= min_interval;
+}
+
 // Private methods
 
+std::string
+LocalStorage::get_pending_fleet_statistics_path(const uint8_t shard) const
+{
+  return FMT("{}/fleet_stats/{:x}", m_config.cache_dir(), shard);
+}
+
+std::string
+LocalStorage::get_taken_fleet_statistics_path() const
+{
+  return FMT("{}/fleet_stats/taken", m_config.cache_dir());
+}
+
+void
+LocalStorage::record_access(const Digest& key,
+                            const core::CacheEntryType type,
+                            const core::AccessTrace::Kind kind,
+                            const uint64_t size) const
+{
+  if (!m_config.access_trace_file().empty()) {
+    m_access_events.push_back(
+      core::AccessTrace::make_event(key, type, kind, size));
+  }
+}
+
+void
+LocalStorage::write_access_trace()
+{
+  if (m_access_events.empty()) {
+    return;
+  }
+
+  // Attribute the compiler CPU time to the stored result so that the value of
+  // future hits can be estimated.
+  const auto cost =
+    m_result_counter_updates.get(core::Statistic::compiler_cpu_ms);
+  for (auto& event : m_access_events) {
+    if (event.type == core::CacheEntryType::result
+        && event.kind == core::AccessTrace::Kind::store) {
+      event.cost = static_cast<uint32_t>(cost);
+    }
+  }
+
+  core::AccessTrace(m_config.access_trace_file()).write(m_access_events);
+  m_access_events.clear();
+}
+
 LocalStorage::LookUpCacheFileResult
 LocalStorage::look_up_cache_file(const Digest& key,
                                  const core::CacheEntryType type) const
@@ -454,6 +664,14 @@ LocalStorage::update_stats_and_maybe_move_cache_file(
           // to rename is OK.
         }
       }
+      if (type == core::CacheEntryType::manifest) {
+        try {
+          Util::rename(get_remote_version_tag_path(current_path),
+                       get_remote_version_tag_path(wanted_path));
+        } catch (const core::Error&) {
+          // There may be no version tag.
+        }
+      }
     }
   }
   return counters;
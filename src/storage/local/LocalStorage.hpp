@@ -19,12 +19,15 @@
 #pragma once
 
 #include <Digest.hpp>
+#include <core/AccessTrace.hpp>
 #include <core/Result.hpp>
 #include <core/StatisticsCounters.hpp>
 #include <core/types.hpp>
+#include <storage/local/CacheAnalysis.hpp>
 #include <storage/local/util.hpp>
 #include <storage/types.hpp>
 #include <util/Bytes.hpp>
+#include <util/Duration.hpp>
 #include <util/TimePoint.hpp>
 
 #include <third_party/nonstd/span.hpp>
@@ -74,6 +77,45 @@ public:
   put_raw_files(const Digest& key,
                 const std::vector<core::Result::Serializer::RawFile> raw_files);
 
+  // --- Admission control ---
+
+  // Return true if a new result for `key` should be stored according to the
+  // admission_policy setting. Keys are recorded so that a later miss for the
+  // same key is admitted.
+  bool admit(const Digest& key);
+
+  // --- Remote version tags ---
+
+  // Return the tag of the remote storage entry version that the local copy of
+  // `key` is based on, if known. `local_version` is the version of the local
+  // copy as returned by `get_local_version`; a tag recorded for other content
+  // is ignored.
+  std::optional<std::string>
+  get_remote_version_tag(const Digest& key,
+                         core::CacheEntryType type,
+                         std::string_view local_version) const;
+
+  // Remember `tag` as the remote storage entry version that the local copy of
+  // `key` with version `local_version` is based on. The tag is stored in a
+  // small file next to the entry and removed when the entry is replaced. Tag
+  // files are not counted in the cache statistics.
+  void set_remote_version_tag(const Digest& key,
+                              core::CacheEntryType type,
+                              std::string_view local_version,
+                              std::string_view tag);
+
+  // Return a version identifying the local entry content `value`.
+  static std::string get_local_version(nonstd::span<const uint8_t> value);
+
+  // --- Compile leases ---
+
+  // Return the path of the lock file for machine-wide compile slot `slot`.
+  std::string get_compile_slot_path(uint32_t slot) const;
+
+  // Return the path of the lock file that coordinates concurrent compilations
+  // producing the cache entry `key`.
+  std::string get_compile_lease_path(const Digest& key) const;
+
   // --- Statistics ---
 
   void increment_statistic(core::Statistic statistic, int64_t value = 1);
@@ -89,6 +131,22 @@ public:
   std::pair<core::StatisticsCounters, util::TimePoint>
   get_all_statistics() const;
 
+  // --- Fleet statistics ---
+
+  // Add `updates` to the statistics not yet pushed to the fleet statistics in
+  // remote storage.
+  void add_pending_fleet_statistics(const core::StatisticsCounters& updates);
+
+  // Take the pending fleet statistics for pushing. Nothing is taken if another
+  // process is taking them or if `min_interval` is set and hasn't passed since
+  // they were last taken.
+  std::optional<core::StatisticsCounters> take_pending_fleet_statistics(
+    std::optional<util::Duration> min_interval = std::nullopt);
+
+  // Return true if `min_interval` has passed since the pending fleet
+  // statistics were last taken. This only costs a stat call.
+  bool is_fleet_statistics_push_due(util::Duration min_interval) const;
+
   // --- Cleanup ---
 
   void evict(const ProgressReceiver& progress_receiver,
@@ -107,6 +165,10 @@ public:
   void recompress(std::optional<int8_t> level,
                   const ProgressReceiver& progress_receiver);
 
+  // --- Analysis ---
+
+  CacheAnalysis analyze(const ProgressReceiver& progress_receiver) const;
+
 private:
   const Config& m_config;
 
@@ -128,6 +190,9 @@ private:
 
   std::vector<std::string> m_added_raw_files;
 
+  // Accesses to log to the access trace file, if enabled.
+  mutable std::vector<core::AccessTrace::Event> m_access_events;
+
   struct LookUpCacheFileResult
   {
     std::string path;
@@ -140,6 +205,15 @@ private:
 
   void clean_internal_tempdir();
 
+  std::string get_pending_fleet_statistics_path(uint8_t shard) const;
+  std::string get_taken_fleet_statistics_path() const;
+
+  void record_access(const Digest& key,
+                     core::CacheEntryType type,
+                     core::AccessTrace::Kind kind,
+                     uint64_t size) const;
+  void write_access_trace();
+
   std::optional<core::StatisticsCounters>
   update_stats_and_maybe_move_cache_file(
     const Digest& key,
@@ -0,0 +1,287 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "LocalStorage.hpp"
+
+#include <Config.hpp>
+#include <Logging.hpp>
+#include <core/CacheEntry.hpp>
+#include <core/Manifest.hpp>
+#include <core/Result.hpp>
+#include <core/exceptions.hpp>
+#include <fmtmacros.hpp>
+#include <util/TaskPool.hpp>
+#include <util/XXH3_128.hpp>
+#include <util/expected.hpp>
+#include <util/file.hpp>
+#include <util/string.hpp>
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace storage::local {
+
+namespace {
+
+// Slack in seconds between the creation time recorded in a cache entry header
+// and the modification time of the file when it was written.
+const uint64_t k_write_slack = 2;
+
+struct PayloadFile
+{
+  std::string digest;
+  uint64_t size;
+};
+
+// Analysis of a single cache file, merged into the CacheAnalysis under lock.
+struct FileAnalysis
+{
+  CacheAnalysis partial;
+  std::vector<PayloadFile> payload_files;
+};
+
+const char*
+entry_type_name(const CacheFile::Type type)
+{
+  switch (type) {
+  case CacheFile::Type::manifest:
+    return "manifest";
+  case CacheFile::Type::result:
+    return "result";
+  case CacheFile::Type::raw:
+    return "raw";
+  case CacheFile::Type::remote_version_tag:
+    return "remote version tag";
+  case CacheFile::Type::unknown:
+    break;
+  }
+  return "unknown";
+}
+
+std::string
+digest_data(nonstd::span<const uint8_t> data)
+{
+  util::XXH3_128 hash;
+  hash.update(data);
+  const auto digest = hash.digest();
+  return std::string(digest.begin(), digest.end());
+}
+
+class PayloadVisitor : public core::Result::Deserializer::Visitor
+{
+public:
+  PayloadVisitor(const std::string& result_path, FileAnalysis& analysis)
+    : m_result_path(result_path),
+      m_analysis(analysis)
+  {
+  }
+
+  void
+  on_embedded_file(uint8_t /*file_number*/,
+                   core::Result::FileType file_type,
+                   nonstd::span<const uint8_t> data) override
+  {
+    add(file_type, data);
+  }
+
+  void
+  on_raw_file(uint8_t file_number,
+              core::Result::FileType file_type,
+              uint64_t /*file_size*/) override
+  {
+    const auto path =
+      LocalStorage::get_raw_file_path(m_result_path, file_number);
+    const auto data = util::value_or_throw<core::Error>(
+      util::read_file<util::Bytes>(path), FMT("Failed to read {}: ", path));
+    add(file_type, data);
+  }
+
+private:
+  const std::string& m_result_path;
+  FileAnalysis& m_analysis;
+
+  void
+  add(core::Result::FileType file_type, nonstd::span<const uint8_t> data)
+  {
+    m_analysis.partial.file_types[core::Result::file_type_to_string(file_type)]
+      .add(data.size());
+    m_analysis.payload_files.push_back({digest_data(data), data.size()});
+  }
+};
+
+FileAnalysis
+analyze_file(const CacheFile& cache_file, const util::TimePoint& now)
+{
+  FileAnalysis analysis;
+  auto& partial = analysis.partial;
+  const uint64_t file_size = cache_file.lstat().size();
+  partial.entry_types[entry_type_name(cache_file.type())].add(file_size);
+
+  if (cache_file.type() != CacheFile::Type::manifest
+      && cache_file.type() != CacheFile::Type::result) {
+    return analysis;
+  }
+
+  const auto data = util::value_or_throw<core::Error>(
+    util::read_file<util::Bytes>(cache_file.path()),
+    FMT("Failed to read {}: ", cache_file.path()));
+  core::CacheEntry cache_entry(data);
+  const auto& header = cache_entry.header();
+
+  const uint64_t now_sec = now.sec();
+  const uint64_t mtime_sec = cache_file.lstat().mtime().sec();
+  const uint64_t age =
+    now_sec > header.creation_time ? now_sec - header.creation_time : 0;
+  const uint64_t since_hit = now_sec > mtime_sec ? now_sec - mtime_sec : 0;
+  partial.age[bucket_index(CacheAnalysis::k_age_limits, age)].add(file_size);
+  partial.last_hit[bucket_index(CacheAnalysis::k_age_limits, since_hit)].add(
+    file_size);
+  // LocalStorage::get bumps the modification time on each hit, so an entry
+  // that was never retrieved still has about the same time as when created.
+  if (mtime_sec <= header.creation_time + k_write_slack) {
+    partial.never_hit.add(file_size);
+  }
+
+  auto& compression =
+    header.compression_type == core::CompressionType::none
+      ? partial.compression_levels[std::nullopt]
+      : partial.compression_levels[header.compression_level];
+  ++compression.count;
+  compression.size += file_size;
+  compression.content_size += header.entry_size;
+
+  partial.namespaces[header.namespace_].add(file_size);
+
+  if (cache_file.type() == CacheFile::Type::manifest) {
+    core::Manifest manifest;
+    manifest.read(cache_entry.payload());
+    const uint64_t results = manifest.result_count();
+    partial.manifest_sizes[bucket_index(CacheAnalysis::k_manifest_size_limits,
+                                        file_size)]
+      .add(file_size);
+    partial
+      .manifest_results[bucket_index(CacheAnalysis::k_manifest_result_limits,
+                                     results)]
+      .add(file_size);
+    partial.max_manifest_results = results;
+  } else {
+    core::Result::Deserializer deserializer(cache_entry.payload());
+    PayloadVisitor visitor(cache_file.path(), analysis);
+    deserializer.visit(visitor);
+  }
+
+  return analysis;
+}
+
+template<typename K, typename V>
+void
+merge_map(std::map<K, V>& target, const std::map<K, V>& source)
+{
+  for (const auto& [key, value] : source) {
+    target[key] += value;
+  }
+}
+
+template<typename T>
+void
+merge_array(T& target, const T& source)
+{
+  for (size_t i = 0; i < target.size(); ++i) {
+    target[i] += source[i];
+  }
+}
+
+} // namespace
+
+CacheAnalysis
+LocalStorage::analyze(const ProgressReceiver& progress_receiver) const
+{
+  util::TaskPool task_pool;
+  const auto now = util::TimePoint::now();
+
+  std::mutex mutex;
+  CacheAnalysis result;
+  // Content digests of payload files seen so far.
+  std::unordered_set<std::string> seen_payload_files;
+
+  const auto merge = [&](const FileAnalysis& analysis) {
+    const auto& partial = analysis.partial;
+    std::unique_lock<std::mutex> lock(mutex);
+    merge_map(result.entry_types, partial.entry_types);
+    merge_map(result.file_types, partial.file_types);
+    merge_array(result.age, partial.age);
+    merge_array(result.last_hit, partial.last_hit);
+    result.never_hit += partial.never_hit;
+    for (const auto& [level, amount] : partial.compression_levels) {
+      auto& compression = result.compression_levels[level];
+      compression.count += amount.count;
+      compression.size += amount.size;
+      compression.content_size += amount.content_size;
+    }
+    merge_array(result.manifest_sizes, partial.manifest_sizes);
+    merge_array(result.manifest_results, partial.manifest_results);
+    result.max_manifest_results =
+      std::max(result.max_manifest_results, partial.max_manifest_results);
+    merge_map(result.namespaces, partial.namespaces);
+
+    for (const auto& payload_file : analysis.payload_files) {
+      if (!seen_payload_files.insert(payload_file.digest).second) {
+        result.duplicated.add(payload_file.size);
+      }
+    }
+  };
+
+  // Declared after everything that the tasks use so that they are finished
+  // before any of it is destroyed.
+  const size_t read_ahead = 2 * task_pool.max_threads();
+  util::TaskGroup tasks(task_pool, read_ahead);
+
+  for_each_level_1_subdir(
+    m_config.cache_dir(),
+    [&](const auto& subdir, const auto& sub_progress_receiver) {
+      const std::vector<CacheFile> files =
+        get_level_1_files(subdir, [&](double progress) {
+          sub_progress_receiver(0.1 * progress);
+        });
+
+      for (size_t i = 0; i < files.size(); ++i) {
+        tasks.run([&merge, file = files[i], now] {
+          try {
+            merge(analyze_file(file, now));
+          } catch (core::Error& e) {
+            LOG("Failed to analyze {}: {}", file.path(), e.what());
+          }
+        });
+
+        sub_progress_receiver(0.1 + 0.9 * i / files.size());
+      }
+
+      if (util::ends_with(subdir, "f")) {
+        // Wait here instead of after for_each_level_1_subdir to avoid
+        // updating the progress bar to 100% before all work is done.
+        tasks.wait();
+      }
+    },
+    progress_receiver);
+
+  return result;
+}
+
+} // namespace storage::local
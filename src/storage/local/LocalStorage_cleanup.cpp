@@ -130,6 +130,17 @@ LocalStorage::clean_dir(const std::string& subdir,
       continue;
     }
 
+    if (file.type() == CacheFile::Type::remote_version_tag) {
+      // Not counted as a cache file. Removed together with its manifest below,
+      // or here if the manifest is gone.
+      const auto manifest_path =
+        FMT("{}M", file.path().substr(0, file.path().length() - 1));
+      if (!Stat::lstat(manifest_path)) {
+        delete_file(file.path(), 0, nullptr, nullptr);
+      }
+      continue;
+    }
+
     if (namespace_ && file.type() == CacheFile::Type::raw) {
       const auto result_filename =
         FMT("{}R", file.path().substr(0, file.path().length() - 2));
@@ -154,7 +165,8 @@ LocalStorage::clean_dir(const std::string& subdir,
        ++i, progress_receiver(2.0 / 3 + 1.0 * i / files.size() / 3)) {
     const auto& file = files[i];
 
-    if (!file.lstat() || file.lstat().is_directory()) {
+    if (!file.lstat() || file.lstat().is_directory()
+        || file.type() == CacheFile::Type::remote_version_tag) {
       continue;
     }
 
@@ -210,6 +222,14 @@ LocalStorage::clean_dir(const std::string& subdir,
       delete_file(o_file, 0, nullptr, nullptr);
     }
 
+    if (file.type() == CacheFile::Type::manifest) {
+      // The remote version tag of the manifest is useless without it.
+      delete_file(FMT("{}V", file.path().substr(0, file.path().length() - 1)),
+                  0,
+                  nullptr,
+                  nullptr);
+    }
+
     delete_file(
       file.path(), file.lstat().size_on_disk(), &cache_size, &files_in_cache);
     cleaned = true;
@@ -22,7 +22,6 @@
 #include <Context.hpp>
 #include <File.hpp>
 #include <Logging.hpp>
-#include <ThreadPool.hpp>
 #include <assertions.hpp>
 #include <core/CacheEntry.hpp>
 #include <core/Manifest.hpp>
@@ -31,6 +30,7 @@
 #include <core/wincompat.hpp>
 #include <fmtmacros.hpp>
 #include <storage/local/StatsFile.hpp>
+#include <util/TaskPool.hpp>
 #include <util/expected.hpp>
 #include <util/file.hpp>
 #include <util/string.hpp>
@@ -43,7 +43,6 @@
 
 #include <memory>
 #include <string>
-#include <thread>
 
 namespace storage::local {
 
@@ -193,10 +192,10 @@ void
 LocalStorage::recompress(const std::optional<int8_t> level,
                          const ProgressReceiver& progress_receiver)
 {
-  const size_t threads = std::thread::hardware_concurrency();
-  const size_t read_ahead = 2 * threads;
-  ThreadPool thread_pool(threads, read_ahead);
+  util::TaskPool task_pool;
   RecompressionStatistics statistics;
+  const size_t read_ahead = 2 * task_pool.max_threads();
+  util::TaskGroup tasks(task_pool, read_ahead);
 
   for_each_level_1_subdir(
     m_config.cache_dir(),
@@ -211,8 +210,9 @@ LocalStorage::recompress(const std::optional<int8_t> level,
       for (size_t i = 0; i < files.size(); ++i) {
         const auto& file = files[i];
 
-        if (file.type() != CacheFile::Type::unknown) {
-          thread_pool.enqueue([&statistics, stats_file, file, level] {
+        if (file.type() != CacheFile::Type::unknown
+            && file.type() != CacheFile::Type::remote_version_tag) {
+          tasks.run([&statistics, stats_file, file, level] {
             try {
               recompress_file(statistics, stats_file, file, level);
             } catch (core::Error&) {
@@ -229,7 +229,7 @@ LocalStorage::recompress(const std::optional<int8_t> level,
       if (util::ends_with(subdir, "f")) {
         // Wait here instead of after for_each_level_1_subdir to avoid
         // updating the progress bar to 100% before all work is done.
-        thread_pool.shut_down();
+        tasks.wait();
       }
     },
     progress_receiver);
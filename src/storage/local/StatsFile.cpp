@@ -60,10 +60,11 @@ StatsFile::read() const
 
 std::optional<core::StatisticsCounters>
 StatsFile::update(
-  std::function<void(core::StatisticsCounters& counters)> function) const
+  std::function<void(core::StatisticsCounters& counters)> function,
+  const util::LockFileGuard::Mode lock_mode) const
 {
   util::ShortLivedLockFile lock_file(m_path);
-  util::LockFileGuard lock(lock_file);
+  util::LockFileGuard lock(lock_file, lock_mode);
   if (!lock.acquired()) {
     LOG("Failed to acquire lock for {}", m_path);
     return std::nullopt;
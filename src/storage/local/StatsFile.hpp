@@ -19,6 +19,7 @@
 #pragma once
 
 #include <core/StatisticsCounters.hpp>
+#include <util/LockFile.hpp>
 
 #include <functional>
 #include <optional>
@@ -37,9 +38,12 @@ public:
 
   // Acquire a lock, read counters, call `function` with the counters, write the
   // counters and release the lock. Returns the resulting counters or nullopt on
-  // error (e.g. if the lock could not be acquired).
+  // error (e.g. if the lock could not be acquired or, in non-blocking mode, is
+  // held by somebody else).
   std::optional<core::StatisticsCounters>
-    update(std::function<void(core::StatisticsCounters& counters)>) const;
+  update(std::function<void(core::StatisticsCounters& counters)>,
+         util::LockFileGuard::Mode lock_mode =
+           util::LockFileGuard::Mode::blocking) const;
 
 private:
   const std::string m_path;
@@ -21,18 +21,27 @@
 #include <AtomicFile.hpp>
 #include <Digest.hpp>
 #include <Logging.hpp>
+#include <TemporaryFile.hpp>
 #include <UmaskScope.hpp>
 #include <Util.hpp>
 #include <assertions.hpp>
 #include <core/exceptions.hpp>
+#include <core/wincompat.hpp>
 #include <fmtmacros.hpp>
 #include <util/Bytes.hpp>
+#include <util/LockFile.hpp>
+#include <util/XXH3_64.hpp>
 #include <util/expected.hpp>
 #include <util/file.hpp>
 #include <util/string.hpp>
 
 #include <sys/stat.h> // for mode_t
 
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+#include <functional>
 #include <string_view>
 
 namespace storage::remote {
@@ -47,12 +56,35 @@ public:
   nonstd::expected<std::optional<util::Bytes>, Failure>
   get(const Digest& key) override;
 
+  nonstd::expected<ConditionalGetResult, Failure>
+  get_if_changed(const Digest& key, const std::string& version) override;
+
   nonstd::expected<bool, Failure> put(const Digest& key,
                                       nonstd::span<const uint8_t> value,
                                       bool only_if_missing) override;
 
+  nonstd::expected<bool, Failure>
+  put_if_unchanged(const Digest& key,
+                   nonstd::span<const uint8_t> value,
+                   const std::string& version) override;
+
   nonstd::expected<bool, Failure> remove(const Digest& key) override;
 
+  nonstd::expected<bool, Failure>
+  acquire_lease(const Digest& key,
+                const std::string& owner,
+                std::chrono::milliseconds ttl) override;
+
+  nonstd::expected<bool, Failure> has_lease(const Digest& key) override;
+
+  nonstd::expected<bool, Failure>
+  renew_lease(const Digest& key,
+              const std::string& owner,
+              std::chrono::milliseconds ttl) override;
+
+  nonstd::expected<bool, Failure>
+  release_lease(const Digest& key, const std::string& owner) override;
+
 private:
   enum class Layout { flat, subdirs };
 
@@ -62,8 +94,79 @@ private:
   Layout m_layout = Layout::subdirs;
 
   std::string get_entry_path(const Digest& key) const;
+  std::string get_lease_path(const Digest& key) const;
 };
 
+// The version of an entry is a hash of its content since timestamps may be
+// coarse or updated by reads (see the update-mtime attribute).
+std::string
+get_version(nonstd::span<const uint8_t> value)
+{
+  util::XXH3_64 hash;
+  hash.update(value.data(), value.size());
+  return FMT("{:016x}", hash.digest());
+}
+
+// Hard link `path` to `target` unless `path` already exists. Returns true if
+// linked, false if `path` exists or std::nullopt on other errors.
+std::optional<bool>
+link_unless_exists(const std::string& target, const std::string& path)
+{
+#ifndef _WIN32
+  if (link(target.c_str(), path.c_str()) == 0) {
+    return true;
+  } else if (errno == EEXIST) {
+    return false;
+  }
+#else
+  if (CreateHardLink(path.c_str(), target.c_str(), nullptr)) {
+    return true;
+  } else if (GetLastError() == ERROR_ALREADY_EXISTS) {
+    return false;
+  }
+#endif
+  LOG("Failed to create {}: {}", path, strerror(errno));
+  return std::nullopt;
+}
+
+// Remove the lease at `path` if `matches` returns true for its content. The
+// lease is first moved to a unique name so that it can be examined without
+// racing with clients that replace it, and moved back if it doesn't match.
+// Returns true if the lease was removed.
+//
+// Note: A third client may take the lease while it's moved away, in which
+// case the owner of the moved lease notices that it was lost when renewing it.
+bool
+remove_lease_if(const std::string& path,
+                const std::function<bool(std::string_view)>& matches)
+{
+  TemporaryFile tmp_file(path);
+  if (!tmp_file.fd) {
+    LOG("Failed to create temporary file for {}: {}", path, strerror(errno));
+    return false;
+  }
+  tmp_file.fd.close();
+
+  try {
+    Util::rename(path, tmp_file.path);
+  } catch (const core::Error&) {
+    // Already removed by somebody else.
+    Util::unlink_tmp(tmp_file.path);
+    return false;
+  }
+
+  const auto value = util::read_file<std::string>(tmp_file.path);
+  const bool removed = value && matches(*value);
+  if (!removed) {
+    // Somebody else replaced the lease before it was moved. Put it back unless
+    // yet another client has taken the lease in the meantime.
+    LOG("Lease {} was changed by somebody else", path);
+    link_unless_exists(tmp_file.path, path);
+  }
+  Util::unlink_tmp(tmp_file.path);
+  return removed;
+}
+
 FileStorageBackend::FileStorageBackend(const Params& params)
 {
   ASSERT(params.url.scheme() == "file");
@@ -129,6 +232,25 @@ FileStorageBackend::get(const Digest& key)
   return std::move(*value);
 }
 
+nonstd::expected<RemoteStorage::Backend::ConditionalGetResult,
+                 RemoteStorage::Backend::Failure>
+FileStorageBackend::get_if_changed(const Digest& key,
+                                   const std::string& version)
+{
+  auto value = get(key);
+  if (!value) {
+    return nonstd::make_unexpected(value.error());
+  } else if (!*value) {
+    return ConditionalGetResult{};
+  }
+
+  auto current_version = get_version(**value);
+  if (current_version == version) {
+    return ConditionalGetResult{std::nullopt, version, true};
+  }
+  return ConditionalGetResult{std::move(*value), current_version, false};
+}
+
 nonstd::expected<bool, RemoteStorage::Backend::Failure>
 FileStorageBackend::put(const Digest& key,
                         const nonstd::span<const uint8_t> value,
@@ -165,12 +287,152 @@ FileStorageBackend::put(const Digest& key,
   }
 }
 
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+FileStorageBackend::put_if_unchanged(const Digest& key,
+                                     const nonstd::span<const uint8_t> value,
+                                     const std::string& version)
+{
+  const auto path = get_entry_path(key);
+
+  UmaskScope umask_scope(m_umask);
+
+  const auto dir = Util::dir_name(path);
+  if (!Util::create_dir(dir)) {
+    LOG("Failed to create directory {}: {}", dir, strerror(errno));
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  // Clients putting conditionally take the same lock, so the entry can't
+  // change between checking the version and writing.
+  util::ShortLivedLockFile lock_file(path);
+  util::LockFileGuard lock(lock_file);
+  if (!lock.acquired()) {
+    LOG("Failed to lock {}", path);
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  const auto current = util::read_file<util::Bytes>(path);
+  const auto current_version = current ? get_version(*current) : "";
+  if (current_version != version) {
+    LOG("{} was changed by somebody else", path);
+    return false;
+  }
+  return put(key, value, false);
+}
+
 nonstd::expected<bool, RemoteStorage::Backend::Failure>
 FileStorageBackend::remove(const Digest& key)
 {
   return Util::unlink_safe(get_entry_path(key));
 }
 
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+FileStorageBackend::acquire_lease(const Digest& key,
+                                  const std::string& owner,
+                                  const std::chrono::milliseconds ttl)
+{
+  const auto path = get_lease_path(key);
+
+  UmaskScope umask_scope(m_umask);
+
+  // Write the lease to a temporary file and then link it into place so that
+  // other clients never observe a partially written lease. Linking fails if
+  // the lease already exists.
+  TemporaryFile tmp_file(path);
+  if (!tmp_file.fd) {
+    LOG("Failed to create temporary file for {}: {}", path, strerror(errno));
+    return nonstd::make_unexpected(Failure::error);
+  }
+  const auto lease = format_lease(owner, ttl);
+  const auto write_result =
+    util::write_fd(*tmp_file.fd, lease.data(), lease.size());
+  tmp_file.fd.close();
+  if (!write_result) {
+    LOG("Failed to write {}: {}", tmp_file.path, write_result.error());
+    Util::unlink_tmp(tmp_file.path);
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  // Try a second time if an expired lease had to be broken.
+  std::optional<bool> acquired = false;
+  for (int i = 0; i < 2; ++i) {
+    acquired = link_unless_exists(tmp_file.path, path);
+    if (!acquired || *acquired) {
+      break;
+    }
+    const auto current = util::read_file<std::string>(path);
+    if (!current) {
+      continue; // Released in the meantime.
+    } else if (!is_lease_expired(*current)) {
+      break;
+    }
+    // Only remove the expired lease if nobody else has replaced it in the
+    // meantime. If several clients break the same lease, only one of them can
+    // create a new one.
+    LOG("Breaking expired lease {}", path);
+    remove_lease_if(path, [&](std::string_view value) {
+      return value == *current;
+    });
+  }
+
+  Util::unlink_tmp(tmp_file.path);
+  if (!acquired) {
+    return nonstd::make_unexpected(Failure::error);
+  }
+  return *acquired;
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+FileStorageBackend::has_lease(const Digest& key)
+{
+  const auto path = get_lease_path(key);
+  const auto value = util::read_file<std::string>(path);
+  if (!value) {
+    // Don't log failure if the lease doesn't exist.
+    return false;
+  }
+  return !is_lease_expired(*value);
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+FileStorageBackend::renew_lease(const Digest& key,
+                                const std::string& owner,
+                                const std::chrono::milliseconds ttl)
+{
+  const auto path = get_lease_path(key);
+  const auto current = util::read_file<std::string>(path);
+  if (!current || get_lease_owner(*current) != owner) {
+    return false;
+  }
+
+  // Other clients only replace a lease after it has expired, so overwriting
+  // our own lease is safe as long as it's renewed well before that.
+  UmaskScope umask_scope(m_umask);
+  try {
+    AtomicFile file(path, AtomicFile::Mode::text);
+    file.write(format_lease(owner, ttl));
+    file.commit();
+    return true;
+  } catch (const core::Error& e) {
+    LOG("Failed to write {}: {}", path, e.what());
+    return nonstd::make_unexpected(Failure::error);
+  }
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+FileStorageBackend::release_lease(const Digest& key, const std::string& owner)
+{
+  const auto path = get_lease_path(key);
+  const auto current = util::read_file<std::string>(path);
+  if (!current || get_lease_owner(*current) != owner) {
+    return false;
+  }
+  // Our lease may have expired and been replaced after reading it.
+  return remove_lease_if(path, [&](std::string_view value) {
+    return get_lease_owner(value) == owner;
+  });
+}
+
 std::string
 FileStorageBackend::get_entry_path(const Digest& key) const
 {
@@ -189,6 +451,12 @@ FileStorageBackend::get_entry_path(const Digest& key) const
   ASSERT(false);
 }
 
+std::string
+FileStorageBackend::get_lease_path(const Digest& key) const
+{
+  return get_entry_path(key) + ".lease";
+}
+
 } // namespace
 
 std::unique_ptr<RemoteStorage::Backend>
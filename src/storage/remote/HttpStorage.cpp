@@ -44,25 +44,75 @@ public:
   nonstd::expected<std::optional<util::Bytes>, Failure>
   get(const Digest& key) override;
 
+  nonstd::expected<ConditionalGetResult, Failure>
+  get_if_changed(const Digest& key, const std::string& version) override;
+
   nonstd::expected<bool, Failure> put(const Digest& key,
                                       nonstd::span<const uint8_t> value,
                                       bool only_if_missing) override;
 
+  nonstd::expected<bool, Failure>
+  put_if_unchanged(const Digest& key,
+                   nonstd::span<const uint8_t> value,
+                   const std::string& version) override;
+
   nonstd::expected<bool, Failure> remove(const Digest& key) override;
 
+  nonstd::expected<bool, Failure>
+  acquire_lease(const Digest& key,
+                const std::string& owner,
+                std::chrono::milliseconds ttl) override;
+
+  nonstd::expected<bool, Failure> has_lease(const Digest& key) override;
+
+  nonstd::expected<bool, Failure>
+  renew_lease(const Digest& key,
+              const std::string& owner,
+              std::chrono::milliseconds ttl) override;
+
+  nonstd::expected<bool, Failure>
+  release_lease(const Digest& key, const std::string& owner) override;
+
 private:
   enum class Layout { bazel, flat, subdirs };
 
+  struct Lease
+  {
+    std::string value;
+    std::string etag;
+  };
+
   const std::string m_url_path;
   httplib::Client m_http_client;
   Layout m_layout = Layout::subdirs;
 
   std::string get_entry_path(const Digest& key) const;
+  std::string get_lease_path(const Digest& key) const;
+
+  // Get the lease object at `url_path`, or std::nullopt if there is none.
+  nonstd::expected<std::optional<Lease>, Failure>
+  get_lease(const std::string& url_path);
+
+  // Delete the lease object at `url_path` if its ETag still is `etag`.
+  // Returns true if it was deleted or false if it was changed or deleted by
+  // somebody else.
+  nonstd::expected<bool, Failure> delete_lease(const std::string& url_path,
+                                               const std::string& etag);
 };
 
+bool
+is_unix_socket_url(const Url& url)
+{
+  return url.scheme() == "http+unix";
+}
+
 std::string
 get_url_path(const Url& url)
 {
+  if (is_unix_socket_url(url)) {
+    // The path is the socket path.
+    return "/";
+  }
   auto path = url.path();
   if (path.empty() || path.back() != '/') {
     path += '/';
@@ -85,6 +135,22 @@ get_partial_url(const Url& from_url)
 std::string
 get_url(const Url& url)
 {
+  if (is_unix_socket_url(url)) {
+    if (!url.host().empty() && url.host() != "localhost") {
+      throw core::Fatal(
+        FMT("invalid socket path \"{}\": specifying a host other than"
+            " localhost is not supported",
+            url.str()));
+    }
+    if (url.path().empty()) {
+      throw core::Fatal(
+        FMT("A socket path is required in HTTP storage URL \"{}\"",
+            url.str()));
+    }
+    // httplib treats the host as a socket path for AF_UNIX.
+    return url.path();
+  }
+
   if (url.host().empty()) {
     throw core::Fatal(
       FMT("A host is required in HTTP storage URL \"{}\"", url.str()));
@@ -107,9 +173,19 @@ HttpStorageBackend::HttpStorageBackend(const Params& params)
     m_http_client.set_basic_auth(std::string(user), std::string(*password));
   }
 
-  m_http_client.set_default_headers({
+  httplib::Headers default_headers{
     {"User-Agent", FMT("ccache/{}", CCACHE_VERSION)},
-  });
+  };
+  if (is_unix_socket_url(params.url)) {
+#ifdef _WIN32
+    throw core::Fatal("HTTP storage over a unix socket is not supported");
+#else
+    m_http_client.set_address_family(AF_UNIX);
+    // Don't send the socket path as Host header since proxies may reject it.
+    default_headers.emplace("Host", "localhost");
+#endif
+  }
+  m_http_client.set_default_headers(default_headers);
   m_http_client.set_keep_alive(true);
 
   auto connect_timeout = k_default_connect_timeout;
@@ -166,6 +242,41 @@ HttpStorageBackend::get(const Digest& key)
   return util::Bytes(result->body.data(), result->body.size());
 }
 
+nonstd::expected<RemoteStorage::Backend::ConditionalGetResult,
+                 RemoteStorage::Backend::Failure>
+HttpStorageBackend::get_if_changed(const Digest& key,
+                                   const std::string& version)
+{
+  const auto url_path = get_entry_path(key);
+  httplib::Headers headers;
+  if (!version.empty()) {
+    headers.emplace("If-None-Match", version);
+  }
+  const auto result = m_http_client.Get(url_path, headers);
+
+  if (result.error() != httplib::Error::Success || !result) {
+    LOG("Failed to get {} from http storage: {} ({})",
+        url_path,
+        to_string(result.error()),
+        static_cast<int>(result.error()));
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  if (result->status == 304) { // Not Modified
+    return ConditionalGetResult{std::nullopt, version, true};
+  }
+
+  if (result->status < 200 || result->status >= 300) {
+    // Don't log failure if the entry doesn't exist.
+    return ConditionalGetResult{};
+  }
+
+  return ConditionalGetResult{
+    util::Bytes(result->body.data(), result->body.size()),
+    result->get_header_value("ETag"),
+    false};
+}
+
 nonstd::expected<bool, RemoteStorage::Backend::Failure>
 HttpStorageBackend::put(const Digest& key,
                         const nonstd::span<const uint8_t> value,
@@ -241,6 +352,224 @@ HttpStorageBackend::remove(const Digest& key)
   return true;
 }
 
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+HttpStorageBackend::put_if_unchanged(const Digest& key,
+                                     const nonstd::span<const uint8_t> value,
+                                     const std::string& version)
+{
+  const auto url_path = get_entry_path(key);
+
+  // The version is the ETag of the entry.
+  httplib::Headers headers;
+  if (version.empty()) {
+    headers.emplace("If-None-Match", "*");
+  } else {
+    headers.emplace("If-Match", version);
+  }
+
+  static const auto content_type = "application/octet-stream";
+  const auto result =
+    m_http_client.Put(url_path,
+                      headers,
+                      reinterpret_cast<const char*>(value.data()),
+                      value.size(),
+                      content_type);
+
+  if (result.error() != httplib::Error::Success || !result) {
+    LOG("Failed to put {} to http storage: {} ({})",
+        url_path,
+        to_string(result.error()),
+        static_cast<int>(result.error()));
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  if (result->status == 412) { // Precondition Failed
+    LOG("{} was changed by somebody else", url_path);
+    return false;
+  }
+
+  if (result->status < 200 || result->status >= 300) {
+    LOG("Failed to put {} to http storage: status code: {}",
+        url_path,
+        result->status);
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  return true;
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+HttpStorageBackend::acquire_lease(const Digest& key,
+                                  const std::string& owner,
+                                  const std::chrono::milliseconds ttl)
+{
+  const auto url_path = get_lease_path(key);
+  const auto lease = format_lease(owner, ttl);
+
+  // Try a second time if an expired lease had to be broken.
+  for (int i = 0; i < 2; ++i) {
+    // A conditional PUT only succeeds if there is no lease object already.
+    static const auto content_type = "text/plain";
+    const auto result = m_http_client.Put(url_path,
+                                          {{"If-None-Match", "*"}},
+                                          lease.data(),
+                                          lease.size(),
+                                          content_type);
+
+    if (result.error() != httplib::Error::Success || !result) {
+      LOG("Failed to put {} to http storage: {} ({})",
+          url_path,
+          to_string(result.error()),
+          static_cast<int>(result.error()));
+      return nonstd::make_unexpected(Failure::error);
+    }
+
+    if (result->status >= 200 && result->status < 300) {
+      return true;
+    }
+    if (result->status != 412) { // Precondition Failed
+      LOG("Failed to put {} to http storage: status code: {}",
+          url_path,
+          result->status);
+      return nonstd::make_unexpected(Failure::error);
+    }
+
+    const auto current = get_lease(url_path);
+    if (!current) {
+      return nonstd::make_unexpected(current.error());
+    } else if (!*current) {
+      continue; // Released in the meantime.
+    } else if (!is_lease_expired((*current)->value)) {
+      return false;
+    } else if ((*current)->etag.empty()) {
+      LOG("Can't break expired lease {} since the server sent no ETag",
+          url_path);
+      return false;
+    }
+
+    // Only delete the expired lease if nobody else has replaced it in the
+    // meantime. If several clients break the same lease, only one of them can
+    // create a new one.
+    LOG("Breaking expired lease {}", url_path);
+    const auto deleted = delete_lease(url_path, (*current)->etag);
+    if (!deleted) {
+      return nonstd::make_unexpected(deleted.error());
+    }
+  }
+
+  return false;
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+HttpStorageBackend::has_lease(const Digest& key)
+{
+  const auto lease = get_lease(get_lease_path(key));
+  if (!lease) {
+    return nonstd::make_unexpected(lease.error());
+  }
+  return *lease && !is_lease_expired((*lease)->value);
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+HttpStorageBackend::renew_lease(const Digest& key,
+                                const std::string& owner,
+                                const std::chrono::milliseconds ttl)
+{
+  const auto url_path = get_lease_path(key);
+  const auto current = get_lease(url_path);
+  if (!current) {
+    return nonstd::make_unexpected(current.error());
+  } else if (!*current || get_lease_owner((*current)->value) != owner) {
+    return false;
+  }
+
+  // Replace the lease only if it's still the one we just read.
+  const auto lease = format_lease(owner, ttl);
+  httplib::Headers headers;
+  if (!(*current)->etag.empty()) {
+    headers.emplace("If-Match", (*current)->etag);
+  }
+  static const auto content_type = "text/plain";
+  const auto result = m_http_client.Put(
+    url_path, headers, lease.data(), lease.size(), content_type);
+
+  if (result.error() != httplib::Error::Success || !result) {
+    LOG("Failed to put {} to http storage: {} ({})",
+        url_path,
+        to_string(result.error()),
+        static_cast<int>(result.error()));
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  if (result->status == 412) { // Precondition Failed
+    return false;
+  }
+  if (result->status < 200 || result->status >= 300) {
+    LOG("Failed to put {} to http storage: status code: {}",
+        url_path,
+        result->status);
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  return true;
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+HttpStorageBackend::release_lease(const Digest& key, const std::string& owner)
+{
+  const auto url_path = get_lease_path(key);
+  const auto current = get_lease(url_path);
+  if (!current) {
+    return nonstd::make_unexpected(current.error());
+  } else if (!*current || get_lease_owner((*current)->value) != owner) {
+    return false;
+  }
+  return delete_lease(url_path, (*current)->etag);
+}
+
+nonstd::expected<std::optional<HttpStorageBackend::Lease>,
+                 RemoteStorage::Backend::Failure>
+HttpStorageBackend::get_lease(const std::string& url_path)
+{
+  const auto result = m_http_client.Get(url_path);
+
+  if (result.error() != httplib::Error::Success || !result) {
+    LOG("Failed to get {} from http storage: {} ({})",
+        url_path,
+        to_string(result.error()),
+        static_cast<int>(result.error()));
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  if (result->status < 200 || result->status >= 300) {
+    // Don't log failure if the lease doesn't exist.
+    return std::nullopt;
+  }
+
+  return Lease{result->body, result->get_header_value("ETag")};
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+HttpStorageBackend::delete_lease(const std::string& url_path,
+                                 const std::string& etag)
+{
+  httplib::Headers headers;
+  if (!etag.empty()) {
+    headers.emplace("If-Match", etag);
+  }
+  const auto result = m_http_client.Delete(url_path, headers);
+
+  if (result.error() != httplib::Error::Success || !result) {
+    LOG("Failed to delete {} from http storage: {} ({})",
+        url_path,
+        to_string(result.error()),
+        static_cast<int>(result.error()));
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  return result->status >= 200 && result->status < 300;
+}
+
 std::string
 HttpStorageBackend::get_entry_path(const Digest& key) const
 {
@@ -269,6 +598,12 @@ HttpStorageBackend::get_entry_path(const Digest& key) const
   ASSERT(false);
 }
 
+std::string
+HttpStorageBackend::get_lease_path(const Digest& key) const
+{
+  return get_entry_path(key) + ".lease";
+}
+
 } // namespace
 
 std::unique_ptr<RemoteStorage::Backend>
@@ -20,9 +20,11 @@
 
 #include <Digest.hpp>
 #include <Logging.hpp>
+#include <Util.hpp>
 #include <core/exceptions.hpp>
 #include <fmtmacros.hpp>
 #include <util/expected.hpp>
+#include <util/XXH3_128.hpp>
 #include <util/string.hpp>
 
 // Ignore "ISO C++ forbids flexible array member ‘buf’" warning from -Wpedantic.
@@ -55,6 +57,48 @@ using RedisReply = std::unique_ptr<redisReply, decltype(&freeReplyObject)>;
 
 const uint32_t DEFAULT_PORT = 6379;
 
+// Set KEYS[1] to ARGV[1] and its version KEYS[2] to ARGV[2], unless ARGV[3] is
+// "1" and KEYS[1] already exists. Scripts are executed atomically, so the value
+// and version can't get out of sync.
+const char k_put_versioned_script[] =
+  "if ARGV[3] == '1' and redis.call('EXISTS', KEYS[1]) == 1 then\n"
+  "  return 0\n"
+  "end\n"
+  "redis.call('SET', KEYS[1], ARGV[1])\n"
+  "redis.call('SET', KEYS[2], ARGV[2])\n"
+  "return 1\n";
+
+// Set KEYS[1] to ARGV[1] and its version KEYS[2] to ARGV[3] if the version is
+// ARGV[2], or if KEYS[1] is missing if ARGV[2] is empty.
+const char k_put_if_unchanged_script[] =
+  "local version = redis.call('GET', KEYS[2])\n"
+  "if ARGV[2] == '' then\n"
+  "  if redis.call('EXISTS', KEYS[1]) == 1 then return 0 end\n"
+  "elseif version ~= ARGV[2] then\n"
+  "  return 0\n"
+  "end\n"
+  "redis.call('SET', KEYS[1], ARGV[1])\n"
+  "redis.call('SET', KEYS[2], ARGV[3])\n"
+  "return 1\n";
+
+// Add the "<index> <value>" pairs in ARGV[1] to the fields of the hash KEYS[1].
+const char k_add_statistics_script[] =
+  "for index, value in string.gmatch(ARGV[1], '(%d+) (%d+)') do\n"
+  "  redis.call('HINCRBY', KEYS[1], index, value)\n"
+  "end\n"
+  "return 1\n";
+
+// Set the time to live of the lease KEYS[1] to ARGV[2] milliseconds if it's
+// held by ARGV[1].
+const char k_renew_lease_script[] =
+  "if redis.call('GET', KEYS[1]) ~= ARGV[1] then return 0 end\n"
+  "return redis.call('PEXPIRE', KEYS[1], ARGV[2])\n";
+
+// Delete the lease KEYS[1] if it's held by ARGV[1].
+const char k_release_lease_script[] =
+  "if redis.call('GET', KEYS[1]) ~= ARGV[1] then return 0 end\n"
+  "return redis.call('DEL', KEYS[1])\n";
+
 class RedisStorageBackend : public RemoteStorage::Backend
 {
 public:
@@ -63,12 +107,47 @@ public:
   nonstd::expected<std::optional<util::Bytes>, Failure>
   get(const Digest& key) override;
 
+  nonstd::expected<ConditionalGetResult, Failure>
+  get_if_changed(const Digest& key, const std::string& version) override;
+
   nonstd::expected<bool, Failure> put(const Digest& key,
                                       nonstd::span<const uint8_t> value,
                                       bool only_if_missing) override;
 
+  nonstd::expected<bool, Failure>
+  put_versioned(const Digest& key,
+                nonstd::span<const uint8_t> value,
+                bool only_if_missing) override;
+
+  nonstd::expected<bool, Failure>
+  put_if_unchanged(const Digest& key,
+                   nonstd::span<const uint8_t> value,
+                   const std::string& version) override;
+
   nonstd::expected<bool, Failure> remove(const Digest& key) override;
 
+  nonstd::expected<bool, Failure>
+  acquire_lease(const Digest& key,
+                const std::string& owner,
+                std::chrono::milliseconds ttl) override;
+
+  nonstd::expected<bool, Failure> has_lease(const Digest& key) override;
+
+  nonstd::expected<bool, Failure>
+  renew_lease(const Digest& key,
+              const std::string& owner,
+              std::chrono::milliseconds ttl) override;
+
+  nonstd::expected<bool, Failure>
+  release_lease(const Digest& key, const std::string& owner) override;
+
+  nonstd::expected<bool, Failure>
+  add_statistics(const Digest& key,
+                 const core::StatisticsCounters& counters) override;
+
+  nonstd::expected<core::StatisticsCounters, Failure>
+  get_statistics(const Digest& key) override;
+
 private:
   const std::string m_prefix;
   RedisContext m_context;
@@ -79,6 +158,8 @@ private:
   void authenticate(const Url& url);
   nonstd::expected<RedisReply, Failure> redis_command(const char* format, ...);
   std::string get_key_string(const Digest& digest) const;
+  std::string get_lease_key_string(const Digest& digest) const;
+  std::string get_version_key_string(const Digest& digest) const;
 };
 
 timeval
@@ -90,6 +171,18 @@ to_timeval(const uint32_t ms)
   return tv;
 }
 
+// The version of an entry is a hash of its value instead of a counter so that
+// a version can't come back for another value after the version key has been
+// evicted or the database has been flushed.
+std::string
+get_version(nonstd::span<const uint8_t> value)
+{
+  util::XXH3_128 hash;
+  hash.update(value);
+  const auto digest = hash.digest();
+  return Util::format_base16(digest.data(), digest.size());
+}
+
 std::pair<std::optional<std::string>, std::optional<std::string>>
 split_user_info(const std::string& user_info)
 {
@@ -175,6 +268,47 @@ RedisStorageBackend::get(const Digest& key)
   }
 }
 
+nonstd::expected<RemoteStorage::Backend::ConditionalGetResult,
+                 RemoteStorage::Backend::Failure>
+RedisStorageBackend::get_if_changed(const Digest& key,
+                                    const std::string& version)
+{
+  const auto key_string = get_key_string(key);
+  const auto version_key_string = get_version_key_string(key);
+
+  if (!version.empty()) {
+    LOG("Redis GET {}", version_key_string);
+    const auto reply = redis_command("GET %s", version_key_string.c_str());
+    if (!reply) {
+      return nonstd::make_unexpected(reply.error());
+    } else if ((*reply)->type == REDIS_REPLY_STRING
+               && std::string((*reply)->str, (*reply)->len) == version) {
+      return ConditionalGetResult{std::nullopt, version, true};
+    }
+  }
+
+  LOG("Redis MGET {} {}", key_string, version_key_string);
+  const auto reply =
+    redis_command("MGET %s %s", key_string.c_str(), version_key_string.c_str());
+  if (!reply) {
+    return nonstd::make_unexpected(reply.error());
+  } else if ((*reply)->type != REDIS_REPLY_ARRAY || (*reply)->elements != 2) {
+    LOG("Unknown reply type: {}", (*reply)->type);
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  const auto value_reply = (*reply)->element[0];
+  const auto version_reply = (*reply)->element[1];
+  ConditionalGetResult result;
+  if (value_reply->type == REDIS_REPLY_STRING) {
+    result.value = util::Bytes(value_reply->str, value_reply->len);
+  }
+  if (version_reply->type == REDIS_REPLY_STRING) {
+    result.version.assign(version_reply->str, version_reply->len);
+  }
+  return result;
+}
+
 nonstd::expected<bool, RemoteStorage::Backend::Failure>
 RedisStorageBackend::put(const Digest& key,
                          nonstd::span<const uint8_t> value,
@@ -200,8 +334,77 @@ RedisStorageBackend::put(const Digest& key,
     redis_command("SET %s %b", key_string.c_str(), value.data(), value.size());
   if (!reply) {
     return nonstd::make_unexpected(reply.error());
-  } else if ((*reply)->type == REDIS_REPLY_STATUS) {
-    return true;
+  } else if ((*reply)->type != REDIS_REPLY_STATUS) {
+    LOG("Unknown reply type: {}", (*reply)->type);
+    return nonstd::make_unexpected(Failure::error);
+  }
+  return true;
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RedisStorageBackend::put_versioned(const Digest& key,
+                                   nonstd::span<const uint8_t> value,
+                                   bool only_if_missing)
+{
+  const auto key_string = get_key_string(key);
+  const auto version_key_string = get_version_key_string(key);
+  const auto version = get_version(value);
+  LOG("Redis EVAL put_versioned {} {} [{} bytes] {}",
+      key_string,
+      version_key_string,
+      value.size(),
+      version);
+  const auto reply = redis_command("EVAL %s 2 %s %s %b %s %s",
+                                   k_put_versioned_script,
+                                   key_string.c_str(),
+                                   version_key_string.c_str(),
+                                   value.data(),
+                                   value.size(),
+                                   version.c_str(),
+                                   only_if_missing ? "1" : "0");
+  if (!reply) {
+    return nonstd::make_unexpected(reply.error());
+  } else if ((*reply)->type == REDIS_REPLY_INTEGER) {
+    if ((*reply)->integer == 0) {
+      LOG("Entry {} already in Redis", key_string);
+    }
+    return (*reply)->integer == 1;
+  } else {
+    LOG("Unknown reply type: {}", (*reply)->type);
+    return nonstd::make_unexpected(Failure::error);
+  }
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RedisStorageBackend::put_if_unchanged(const Digest& key,
+                                      nonstd::span<const uint8_t> value,
+                                      const std::string& version)
+{
+  const auto key_string = get_key_string(key);
+  const auto version_key_string = get_version_key_string(key);
+  const auto new_version = get_version(value);
+  LOG("Redis EVAL put_if_unchanged {} {} [{} bytes] {} {}",
+      key_string,
+      version_key_string,
+      value.size(),
+      version,
+      new_version);
+  const auto reply = redis_command("EVAL %s 2 %s %s %b %b %s",
+                                   k_put_if_unchanged_script,
+                                   key_string.c_str(),
+                                   version_key_string.c_str(),
+                                   value.data(),
+                                   value.size(),
+                                   version.data(),
+                                   version.size(),
+                                   new_version.c_str());
+  if (!reply) {
+    return nonstd::make_unexpected(reply.error());
+  } else if ((*reply)->type == REDIS_REPLY_INTEGER) {
+    if ((*reply)->integer == 0) {
+      LOG("{} was changed by somebody else", key_string);
+    }
+    return (*reply)->integer == 1;
   } else {
     LOG("Unknown reply type: {}", (*reply)->type);
     return nonstd::make_unexpected(Failure::error);
@@ -212,8 +415,10 @@ nonstd::expected<bool, RemoteStorage::Backend::Failure>
 RedisStorageBackend::remove(const Digest& key)
 {
   const auto key_string = get_key_string(key);
-  LOG("Redis DEL {}", key_string);
-  const auto reply = redis_command("DEL %s", key_string.c_str());
+  const auto version_key_string = get_version_key_string(key);
+  LOG("Redis DEL {} {}", key_string, version_key_string);
+  const auto reply = redis_command(
+    "DEL %s %s", key_string.c_str(), version_key_string.c_str());
   if (!reply) {
     return nonstd::make_unexpected(reply.error());
   } else if ((*reply)->type == REDIS_REPLY_INTEGER) {
@@ -224,6 +429,148 @@ RedisStorageBackend::remove(const Digest& key)
   }
 }
 
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RedisStorageBackend::acquire_lease(const Digest& key,
+                                   const std::string& owner,
+                                   const std::chrono::milliseconds ttl)
+{
+  // Redis expires the lease by itself, so there is no need to store the expiry
+  // time in the value and no expired lease to break.
+  const auto key_string = get_lease_key_string(key);
+  LOG("Redis SET {} {} NX PX {}", key_string, owner, ttl.count());
+  const auto reply = redis_command("SET %s %s NX PX %lld",
+                                   key_string.c_str(),
+                                   owner.c_str(),
+                                   static_cast<long long>(ttl.count()));
+  if (!reply) {
+    return nonstd::make_unexpected(reply.error());
+  } else if ((*reply)->type == REDIS_REPLY_STATUS) {
+    return true;
+  } else if ((*reply)->type == REDIS_REPLY_NIL) {
+    return false;
+  } else {
+    LOG("Unknown reply type: {}", (*reply)->type);
+    return nonstd::make_unexpected(Failure::error);
+  }
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RedisStorageBackend::has_lease(const Digest& key)
+{
+  const auto key_string = get_lease_key_string(key);
+  LOG("Redis EXISTS {}", key_string);
+  const auto reply = redis_command("EXISTS %s", key_string.c_str());
+  if (!reply) {
+    return nonstd::make_unexpected(reply.error());
+  } else if ((*reply)->type == REDIS_REPLY_INTEGER) {
+    return (*reply)->integer > 0;
+  } else {
+    LOG("Unknown reply type: {}", (*reply)->type);
+    return nonstd::make_unexpected(Failure::error);
+  }
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RedisStorageBackend::renew_lease(const Digest& key,
+                                 const std::string& owner,
+                                 const std::chrono::milliseconds ttl)
+{
+  const auto key_string = get_lease_key_string(key);
+  LOG("Redis EVAL renew_lease {} {} {}", key_string, owner, ttl.count());
+  const auto reply = redis_command("EVAL %s 1 %s %s %lld",
+                                   k_renew_lease_script,
+                                   key_string.c_str(),
+                                   owner.c_str(),
+                                   static_cast<long long>(ttl.count()));
+  if (!reply) {
+    return nonstd::make_unexpected(reply.error());
+  } else if ((*reply)->type == REDIS_REPLY_INTEGER) {
+    return (*reply)->integer > 0;
+  } else {
+    LOG("Unknown reply type: {}", (*reply)->type);
+    return nonstd::make_unexpected(Failure::error);
+  }
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RedisStorageBackend::release_lease(const Digest& key, const std::string& owner)
+{
+  const auto key_string = get_lease_key_string(key);
+  LOG("Redis EVAL release_lease {} {}", key_string, owner);
+  const auto reply = redis_command("EVAL %s 1 %s %s",
+                                   k_release_lease_script,
+                                   key_string.c_str(),
+                                   owner.c_str());
+  if (!reply) {
+    return nonstd::make_unexpected(reply.error());
+  } else if ((*reply)->type == REDIS_REPLY_INTEGER) {
+    return (*reply)->integer > 0;
+  } else {
+    LOG("Unknown reply type: {}", (*reply)->type);
+    return nonstd::make_unexpected(Failure::error);
+  }
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RedisStorageBackend::add_statistics(const Digest& key,
+                                    const core::StatisticsCounters& counters)
+{
+  // Counters are stored as fields of a hash so that they can be incremented
+  // atomically in a single round trip, without reading them first.
+  std::string increments;
+  for (size_t i = 0; i < counters.size(); ++i) {
+    if (counters.get_raw(i) != 0) {
+      increments += FMT("{} {} ", i, counters.get_raw(i));
+    }
+  }
+
+  const auto key_string = get_key_string(key);
+  LOG("Redis EVAL add_statistics {} {}", key_string, increments);
+  const auto reply = redis_command("EVAL %s 1 %s %s",
+                                   k_add_statistics_script,
+                                   key_string.c_str(),
+                                   increments.c_str());
+  if (!reply) {
+    return nonstd::make_unexpected(reply.error());
+  }
+  return true;
+}
+
+nonstd::expected<core::StatisticsCounters, RemoteStorage::Backend::Failure>
+RedisStorageBackend::get_statistics(const Digest& key)
+{
+  const auto key_string = get_key_string(key);
+  LOG("Redis HGETALL {}", key_string);
+  const auto reply = redis_command("HGETALL %s", key_string.c_str());
+  if (!reply) {
+    return nonstd::make_unexpected(reply.error());
+  } else if ((*reply)->type != REDIS_REPLY_ARRAY) {
+    LOG("Unknown reply type: {}", (*reply)->type);
+    return nonstd::make_unexpected(Failure::error);
+  }
+
+  core::StatisticsCounters counters;
+  for (size_t i = 0; i + 1 < (*reply)->elements; i += 2) {
+    const auto field_reply = (*reply)->element[i];
+    const auto value_reply = (*reply)->element[i + 1];
+    if (field_reply->type != REDIS_REPLY_STRING
+        || value_reply->type != REDIS_REPLY_STRING) {
+      continue;
+    }
+    // Ignore counters unknown to this version.
+    const auto index =
+      util::parse_unsigned(std::string(field_reply->str, field_reply->len),
+                           0,
+                           static_cast<uint64_t>(core::Statistic::END) - 1);
+    const auto value = util::parse_unsigned(
+      std::string(value_reply->str, value_reply->len));
+    if (index && value) {
+      counters.set_raw(*index, *value);
+    }
+  }
+  return counters;
+}
+
 void
 RedisStorageBackend::connect(const Url& url,
                              const uint32_t connect_timeout,
@@ -340,6 +687,18 @@ RedisStorageBackend::get_key_string(const Digest& digest) const
   return FMT("{}:{}", m_prefix, digest.to_string());
 }
 
+std::string
+RedisStorageBackend::get_lease_key_string(const Digest& digest) const
+{
+  return FMT("{}:lease:{}", m_prefix, digest.to_string());
+}
+
+std::string
+RedisStorageBackend::get_version_key_string(const Digest& digest) const
+{
+  return FMT("{}:version:{}", m_prefix, digest.to_string());
+}
+
 } // namespace
 
 std::unique_ptr<RemoteStorage::Backend>
@@ -18,15 +18,129 @@
 
 #include "RemoteStorage.hpp"
 
+#include <Digest.hpp>
+#include <Logging.hpp>
+#include <fmtmacros.hpp>
+#include <util/TimePoint.hpp>
 #include <util/expected.hpp>
 #include <util/string.hpp>
 
+#include <cstdlib>
+
 namespace storage::remote {
 
+namespace {
+
+// Statistics counters are stored like in local stats files: one decimal
+// counter per line in storage order.
+
+core::StatisticsCounters
+parse_statistics(const util::Bytes& data)
+{
+  core::StatisticsCounters counters;
+  const std::string text(data.begin(), data.end());
+  const char* str = text.c_str();
+  for (size_t i = 0;; ++i) {
+    char* end;
+    const uint64_t value = std::strtoull(str, &end, 10);
+    if (end == str) {
+      break;
+    }
+    counters.set_raw(i, value);
+    str = end;
+  }
+  return counters;
+}
+
+util::Bytes
+format_statistics(const core::StatisticsCounters& counters)
+{
+  std::string text;
+  for (size_t i = 0; i < counters.size(); ++i) {
+    text += FMT("{}\n", counters.get_raw(i));
+  }
+  return util::Bytes(text.data(), text.size());
+}
+
+} // namespace
+
+nonstd::expected<RemoteStorage::Backend::ConditionalGetResult,
+                 RemoteStorage::Backend::Failure>
+RemoteStorage::Backend::get_if_changed(const Digest& key,
+                                       const std::string& /*version*/)
+{
+  auto value = get(key);
+  if (!value) {
+    return nonstd::make_unexpected(value.error());
+  }
+  return ConditionalGetResult{std::move(*value), "", false};
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RemoteStorage::Backend::put_versioned(const Digest& key,
+                                      nonstd::span<const uint8_t> value,
+                                      bool only_if_missing)
+{
+  return put(key, value, only_if_missing);
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RemoteStorage::Backend::put_if_unchanged(const Digest& key,
+                                         nonstd::span<const uint8_t> value,
+                                         const std::string& /*version*/)
+{
+  return put(key, value);
+}
+
+nonstd::expected<bool, RemoteStorage::Backend::Failure>
+RemoteStorage::Backend::add_statistics(const Digest& key,
+                                       const core::StatisticsCounters& counters)
+{
+  const size_t max_attempts = 5;
+
+  for (size_t attempt = 1; attempt <= max_attempts; ++attempt) {
+    auto current = get_if_changed(key, "");
+    if (!current) {
+      return nonstd::make_unexpected(current.error());
+    }
+
+    auto sum = current->value ? parse_statistics(*current->value)
+                              : core::StatisticsCounters();
+    sum.increment(counters);
+    if (current->value && current->version.empty()) {
+      // The backend doesn't keep track of versions, so just overwrite.
+      return put(key, format_statistics(sum));
+    }
+    const auto result =
+      put_if_unchanged(key, format_statistics(sum), current->version);
+    if (!result || *result) {
+      return result;
+    }
+  }
+
+  LOG("Giving up adding statistics to {} after {} attempts",
+      key.to_string(),
+      max_attempts);
+  return false;
+}
+
+nonstd::expected<core::StatisticsCounters, RemoteStorage::Backend::Failure>
+RemoteStorage::Backend::get_statistics(const Digest& key)
+{
+  const auto value = get(key);
+  if (!value) {
+    return nonstd::make_unexpected(value.error());
+  }
+  return *value ? parse_statistics(**value) : core::StatisticsCounters();
+}
+
 bool
 RemoteStorage::Backend::is_framework_attribute(const std::string& name)
 {
-  return name == "read-only" || name == "shards";
+  return name == "backfill" || name == "fleet-stats"
+         || name == "fleet-stats-interval" || name == "lease"
+         || name == "merge-manifests" || name == "read-only"
+         || name == "shards";
 }
 
 std::chrono::milliseconds
@@ -36,4 +150,27 @@ RemoteStorage::Backend::parse_timeout_attribute(const std::string& value)
     util::parse_unsigned(value, 1, 60 * 1000, "timeout")));
 }
 
+std::string
+RemoteStorage::Backend::format_lease(const std::string_view owner,
+                                     const std::chrono::milliseconds ttl)
+{
+  // Milliseconds since the epoch followed by the owner.
+  return FMT(
+    "{} {}", util::TimePoint::now().nsec() / 1'000'000 + ttl.count(), owner);
+}
+
+std::string_view
+RemoteStorage::Backend::get_lease_owner(std::string_view value)
+{
+  return util::split_once(value, ' ').second.value_or("");
+}
+
+bool
+RemoteStorage::Backend::is_lease_expired(std::string_view value)
+{
+  const auto expiry = util::parse_signed(util::split_once(value, ' ').first);
+  // Treat garbage as expired so that a broken lease can't block anybody.
+  return !expiry || *expiry <= util::TimePoint::now().nsec() / 1'000'000;
+}
+
 } // namespace storage::remote
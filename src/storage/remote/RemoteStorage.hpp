@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <core/StatisticsCounters.hpp>
 #include <storage/types.hpp>
 #include <util/Bytes.hpp>
 
@@ -29,6 +30,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Digest;
@@ -76,6 +78,13 @@ public:
       Failure m_failure;
     };
 
+    struct ConditionalGetResult
+    {
+      std::optional<util::Bytes> value; // Unset if not present or unchanged.
+      std::string version;              // Version of the entry, if known.
+      bool unchanged = false;           // True if the version was unchanged.
+    };
+
     virtual ~Backend() = default;
 
     // Get the value associated with `key`. Returns the value on success or
@@ -83,6 +92,13 @@ public:
     virtual nonstd::expected<std::optional<util::Bytes>, Failure>
     get(const Digest& key) = 0;
 
+    // Like `get` but also return the version of the entry, if the backend keeps
+    // track of versions. If `version` is non-empty and equal to the version of
+    // the entry, the value is not transferred. The default implementation calls
+    // `get`.
+    virtual nonstd::expected<ConditionalGetResult, Failure>
+    get_if_changed(const Digest& key, const std::string& version);
+
     // Put `value` associated to `key` in the storage. A true `only_if_missing`
     // is a hint that the value does not have to be set if already present.
     // Returns true if the entry was stored, otherwise false.
@@ -91,10 +107,73 @@ public:
         nonstd::span<const uint8_t> value,
         bool only_if_missing = false) = 0;
 
+    // Like `put` but for entries that are revalidated with `get_if_changed`,
+    // i.e. manifests, so that the backend gives the entry a new version if it
+    // has to keep track of versions itself. The default implementation calls
+    // `put`.
+    virtual nonstd::expected<bool, Failure>
+    put_versioned(const Digest& key,
+                  nonstd::span<const uint8_t> value,
+                  bool only_if_missing = false);
+
+    // Put `value` associated to `key` in the storage only if the version of
+    // the entry still is `version` as returned by `get_if_changed`, or only if
+    // the entry is missing if `version` is empty. Returns true if the entry was
+    // stored or false if it was changed by somebody else. The default
+    // implementation, for backends that don't keep track of versions, calls
+    // `put`.
+    virtual nonstd::expected<bool, Failure>
+    put_if_unchanged(const Digest& key,
+                     nonstd::span<const uint8_t> value,
+                     const std::string& version);
+
     // Remove `key` and its associated value. Returns true if the entry was
     // removed, otherwise false.
     virtual nonstd::expected<bool, Failure> remove(const Digest& key) = 0;
 
+    // Try to take a lease on `key` for `owner`, signaling to other clients
+    // that a value for `key` is being produced. `owner` is a random token
+    // unique to the lease holder. The lease expires after `ttl` unless renewed
+    // or released before that. An expired lease held by somebody else is
+    // broken, but only if it's still the same lease when doing so, so that
+    // only one of several competing clients can take it. Returns true if the
+    // lease was taken or false if somebody else holds it.
+    virtual nonstd::expected<bool, Failure>
+    acquire_lease(const Digest& key,
+                  const std::string& owner,
+                  std::chrono::milliseconds ttl) = 0;
+
+    // Return true if somebody holds an unexpired lease on `key`, otherwise
+    // false.
+    virtual nonstd::expected<bool, Failure> has_lease(const Digest& key) = 0;
+
+    // Make the lease on `key` expire `ttl` from now if it's still held by
+    // `owner`. Returns true if the lease was renewed or false if `owner` no
+    // longer holds it.
+    virtual nonstd::expected<bool, Failure>
+    renew_lease(const Digest& key,
+                const std::string& owner,
+                std::chrono::milliseconds ttl) = 0;
+
+    // Release the lease on `key` if it's still held by `owner`. Returns true
+    // if the lease was released, otherwise false.
+    virtual nonstd::expected<bool, Failure>
+    release_lease(const Digest& key, const std::string& owner) = 0;
+
+    // Add `counters` to the statistics counters stored under `key`. Returns
+    // true if the counters were added or false if the stored counters kept
+    // being changed by somebody else. The default implementation stores the
+    // counters as text and updates them with `get_if_changed` and
+    // `put_if_unchanged`, so for backends that don't keep track of versions
+    // concurrent updates may be lost.
+    virtual nonstd::expected<bool, Failure>
+    add_statistics(const Digest& key, const core::StatisticsCounters& counters);
+
+    // Get the statistics counters stored under `key` by `add_statistics`. All
+    // counters are zero if there are none.
+    virtual nonstd::expected<core::StatisticsCounters, Failure>
+    get_statistics(const Digest& key);
+
     // Determine whether an attribute is handled by the remote storage
     // framework itself.
     static bool is_framework_attribute(const std::string& name);
@@ -102,6 +181,19 @@ public:
     // Parse a timeout `value`, throwing `Failed` on error.
     static std::chrono::milliseconds
     parse_timeout_attribute(const std::string& value);
+
+    // Format the content of a lease object held by `owner` that is valid for
+    // `ttl` from now, for backends that store the lease as an object.
+    static std::string format_lease(std::string_view owner,
+                                    std::chrono::milliseconds ttl);
+
+    // Return the owner of the lease object content `value` as created by
+    // `format_lease`.
+    static std::string_view get_lease_owner(std::string_view value);
+
+    // Return true if the lease object content `value`, as created by
+    // `format_lease`, has expired.
+    static bool is_lease_expired(std::string_view value);
   };
 
   virtual ~RemoteStorage() = default;
@@ -0,0 +1,285 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "IoUring.hpp"
+
+#include <Logging.hpp>
+#include <assertions.hpp>
+
+#ifdef HAVE_IO_URING_STATX
+#  include <fcntl.h>
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace util {
+
+#ifdef HAVE_IO_URING_STATX
+
+namespace {
+
+const unsigned k_queue_depth = 64;
+
+int
+io_uring_setup(unsigned entries, io_uring_params* params)
+{
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int
+io_uring_enter(int fd, unsigned to_submit, unsigned min_complete)
+{
+  return static_cast<int>(syscall(__NR_io_uring_enter,
+                                  fd,
+                                  to_submit,
+                                  min_complete,
+                                  IORING_ENTER_GETEVENTS,
+                                  nullptr,
+                                  0));
+}
+
+uint32_t*
+ring_pointer(void* ring, uint32_t offset)
+{
+  return reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(ring) + offset);
+}
+
+} // namespace
+
+IoUring::~IoUring()
+{
+  munmap(m_sqes, m_sqes_size);
+  munmap(m_ring, m_ring_size);
+  close(m_fd);
+}
+
+std::unique_ptr<IoUring>
+IoUring::create()
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  const int fd = io_uring_setup(k_queue_depth, &params);
+  if (fd < 0) {
+    LOG("Failed to set up io_uring: {}", strerror(errno));
+    return nullptr;
+  }
+  // Kernels without a single mmap for both rings (before 5.4) don't support
+  // IORING_OP_STATX anyway.
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+    LOG_RAW("Not using io_uring since the kernel is too old");
+    close(fd);
+    return nullptr;
+  }
+
+  const size_t ring_size =
+    std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+             params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+  void* ring = mmap(nullptr,
+                    ring_size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE,
+                    fd,
+                    IORING_OFF_SQ_RING);
+  if (ring == MAP_FAILED) {
+    LOG("Failed to map io_uring: {}", strerror(errno));
+    close(fd);
+    return nullptr;
+  }
+  const size_t sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr,
+                    sqes_size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE,
+                    fd,
+                    IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    LOG("Failed to map io_uring entries: {}", strerror(errno));
+    munmap(ring, ring_size);
+    close(fd);
+    return nullptr;
+  }
+
+  std::unique_ptr<IoUring> io_uring(new IoUring);
+  io_uring->m_fd = fd;
+  io_uring->m_ring = ring;
+  io_uring->m_ring_size = ring_size;
+  io_uring->m_sqes = sqes;
+  io_uring->m_sqes_size = sqes_size;
+  // Keep the number of entries in flight within both queues so that
+  // completions can't overflow.
+  io_uring->m_entries = std::min(params.sq_entries, params.cq_entries);
+  io_uring->m_sq_head = ring_pointer(ring, params.sq_off.head);
+  io_uring->m_sq_tail = ring_pointer(ring, params.sq_off.tail);
+  io_uring->m_sq_mask = ring_pointer(ring, params.sq_off.ring_mask);
+  io_uring->m_sq_array = ring_pointer(ring, params.sq_off.array);
+  io_uring->m_cq_head = ring_pointer(ring, params.cq_off.head);
+  io_uring->m_cq_tail = ring_pointer(ring, params.cq_off.tail);
+  io_uring->m_cq_mask = ring_pointer(ring, params.cq_off.ring_mask);
+  io_uring->m_cqes = static_cast<uint8_t*>(ring) + params.cq_off.cqes;
+  return io_uring;
+}
+
+IoUring*
+IoUring::instance()
+{
+  static const std::unique_ptr<IoUring> io_uring = create();
+  return io_uring.get();
+}
+
+std::optional<std::vector<int>>
+IoUring::statx(const std::vector<std::string>& paths,
+               std::vector<struct statx>& buffers)
+{
+  ASSERT(paths.size() == buffers.size());
+
+  if (m_failed) {
+    return std::nullopt;
+  }
+
+  auto* const sqes = static_cast<io_uring_sqe*>(m_sqes);
+  std::vector<int> results(paths.size());
+  size_t next = 0;
+  size_t completed = 0;
+  size_t in_flight = 0;
+
+  while (completed < paths.size()) {
+    // This process is the only producer, so only the kernel's head needs to be
+    // synchronized.
+    uint32_t sq_tail = *m_sq_tail;
+    for (; next < paths.size() && in_flight < m_entries; ++next, ++in_flight) {
+      const uint32_t index = sq_tail & *m_sq_mask;
+      io_uring_sqe& sqe = sqes[index];
+      memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_STATX;
+      sqe.fd = AT_FDCWD;
+      sqe.addr = reinterpret_cast<uintptr_t>(paths[next].c_str());
+      sqe.len = STATX_BASIC_STATS;
+      sqe.off = reinterpret_cast<uintptr_t>(&buffers[next]);
+      sqe.user_data = next;
+      m_sq_array[index] = index;
+      ++sq_tail;
+    }
+    __atomic_store_n(m_sq_tail, sq_tail, __ATOMIC_RELEASE);
+
+    if (!submit_and_wait()) {
+      LOG("io_uring_enter failed, falling back to stat: {}", strerror(errno));
+      m_failed = true;
+
+      // The kernel only consumes entries in io_uring_enter, so entries it
+      // hasn't consumed can be taken back. Consumed entries may still write to
+      // the caller's buffers, so wait for them to complete.
+      const uint32_t sq_head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+      in_flight -= *m_sq_tail - sq_head;
+      __atomic_store_n(m_sq_tail, sq_head, __ATOMIC_RELEASE);
+      while (true) {
+        in_flight -= reap_completions(results);
+        if (in_flight == 0) {
+          break;
+        }
+        if (io_uring_enter(m_fd, 0, 1) < 0) {
+          // Completions are posted to the ring without io_uring_enter too.
+          usleep(1000);
+        }
+      }
+      return std::nullopt;
+    }
+
+    const uint32_t reaped = reap_completions(results);
+    completed += reaped;
+    in_flight -= reaped;
+  }
+
+  return results;
+}
+
+bool
+IoUring::submit_and_wait()
+{
+  while (true) {
+    const uint32_t to_submit =
+      *m_sq_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    if (io_uring_enter(m_fd, to_submit, 1) >= 0) {
+      return true;
+    }
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      return false;
+    }
+  }
+}
+
+uint32_t
+IoUring::reap_completions(std::vector<int>& results)
+{
+  auto* const cqes = static_cast<io_uring_cqe*>(m_cqes);
+  uint32_t cq_head = *m_cq_head;
+  const uint32_t cq_tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+  uint32_t count = 0;
+  for (; cq_head != cq_tail; ++cq_head, ++count) {
+    const io_uring_cqe& cqe = cqes[cq_head & *m_cq_mask];
+    results[cqe.user_data] = cqe.res;
+  }
+  __atomic_store_n(m_cq_head, cq_head, __ATOMIC_RELEASE);
+  return count;
+}
+
+#else
+
+IoUring::~IoUring() = default;
+
+std::unique_ptr<IoUring>
+IoUring::create()
+{
+  return nullptr;
+}
+
+IoUring*
+IoUring::instance()
+{
+  return nullptr;
+}
+
+std::optional<std::vector<int>>
+IoUring::statx(const std::vector<std::string>& /*paths*/,
+               std::vector<struct statx>& /*buffers*/)
+{
+  ASSERT(false);
+  return std::nullopt;
+}
+
+bool
+IoUring::submit_and_wait()
+{
+  return false;
+}
+
+uint32_t
+IoUring::reap_completions(std::vector<int>& /*results*/)
+{
+  return 0;
+}
+
+#endif
+
+} // namespace util
@@ -0,0 +1,86 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <NonCopyable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct statx;
+
+namespace util {
+
+// A minimal io_uring submission/completion queue pair for submitting batches of
+// system calls with few context switches, without depending on liburing.
+class IoUring : NonCopyable
+{
+public:
+  ~IoUring();
+
+  // Return the process-wide instance, or nullptr if io_uring is not available,
+  // e.g. because of an old kernel or because it's disabled by sysctl or a
+  // seccomp filter.
+  static IoUring* instance();
+
+  // Run statx(2) (following symlinks) for each of `paths`, storing the result
+  // in the corresponding element of `buffers`, which must have the same size
+  // as `paths`. Returns the result for each path: 0 on success or a negated
+  // errno value. Returns std::nullopt if submitting to the ring fails, in which
+  // case the ring is not used again.
+  std::optional<std::vector<int>> statx(const std::vector<std::string>& paths,
+                                        std::vector<struct statx>& buffers);
+
+private:
+  int m_fd;
+  void* m_ring;
+  size_t m_ring_size;
+  void* m_sqes;
+  size_t m_sqes_size;
+  uint32_t m_entries;
+  bool m_failed = false;
+
+  // Pointers into m_ring.
+  uint32_t* m_sq_head;
+  uint32_t* m_sq_tail;
+  uint32_t* m_sq_mask;
+  uint32_t* m_sq_array;
+  uint32_t* m_cq_head;
+  uint32_t* m_cq_tail;
+  uint32_t* m_cq_mask;
+  void* m_cqes;
+
+  IoUring() = default;
+
+  static std::unique_ptr<IoUring> create();
+
+  // Submit queued entries and wait for at least one completion. Returns false
+  // on error.
+  bool submit_and_wait();
+
+  // Store the results of completed entries in `results`. Returns the number of
+  // completed entries.
+  uint32_t reap_completions(std::vector<int>& results);
+};
+
+} // namespace util
@@ -86,14 +86,24 @@ bool
 LockFile::acquire()
 {
   LOG("Acquiring {}", m_lock_file);
-  return acquire(true);
+  return acquire(std::nullopt);
 }
 
 bool
 LockFile::try_acquire()
 {
   LOG("Trying to acquire {}", m_lock_file);
-  return acquire(false);
+  return acquire(util::TimePoint::now());
+}
+
+bool
+LockFile::try_acquire_for(const util::Duration& timeout)
+{
+  LOG("Trying to acquire {} within {}.{:03} seconds",
+      m_lock_file,
+      timeout.sec(),
+      timeout.nsec_decimal_part() / 1'000'000);
+  return acquire(util::TimePoint::now() + timeout);
 }
 
 void
@@ -129,14 +139,32 @@ LockFile::acquired() const
 }
 
 bool
-LockFile::acquire(const bool blocking)
+LockFile::held_by_active_process()
+{
+#ifndef _WIN32
+  const auto lock_stat = Stat::lstat(m_lock_file);
+  if (!lock_stat) {
+    return false;
+  }
+  auto last_activity = lock_stat.mtime();
+  if (const auto last_lock_update = get_last_lock_update(); last_lock_update) {
+    last_activity = std::max(last_activity, *last_lock_update);
+  }
+  return util::TimePoint::now() - last_activity < k_staleness_limit;
+#else
+  return static_cast<bool>(Stat::stat(m_lock_file));
+#endif
+}
+
+bool
+LockFile::acquire(const std::optional<util::TimePoint> deadline)
 {
   ASSERT(!acquired());
 
 #ifndef _WIN32
-  m_acquired = do_acquire(blocking);
+  m_acquired = do_acquire(deadline);
 #else
-  m_handle = do_acquire(blocking);
+  m_handle = do_acquire(deadline);
 #endif
   if (acquired()) {
     LOG("Acquired {}", m_lock_file);
@@ -151,7 +179,7 @@ LockFile::acquire(const bool blocking)
 #ifndef _WIN32
 
 bool
-LockFile::do_acquire(const bool blocking)
+LockFile::do_acquire(const std::optional<util::TimePoint> deadline)
 {
   std::stringstream ss;
   ss << Util::get_hostname() << '-' << getpid() << '-'
@@ -235,7 +263,7 @@ LockFile::do_acquire(const bool blocking)
           m_lock_file,
           inactive_duration.sec(),
           inactive_duration.nsec() / 1'000'000);
-      if (!blocking) {
+      if (deadline && util::TimePoint::now() >= *deadline) {
         return false;
       }
     } else if (content == initial_content) {
@@ -262,7 +290,7 @@ LockFile::do_acquire(const bool blocking)
       // likely that step 5 happens before step 4.
     } else {
       LOG("Lock {} reacquired by another process", m_lock_file);
-      if (!blocking) {
+      if (deadline && util::TimePoint::now() >= *deadline) {
         return false;
       }
       initial_content = content;
@@ -277,7 +305,7 @@ LockFile::do_acquire(const bool blocking)
 #else // !_WIN32
 
 void*
-LockFile::do_acquire(const bool blocking)
+LockFile::do_acquire(const std::optional<util::TimePoint> deadline)
 {
   void* handle;
   RandomNumberGenerator sleep_ms_generator(k_min_sleep_time * 1000,
@@ -319,7 +347,7 @@ LockFile::do_acquire(const bool blocking)
     }
 
     LOG("Lock {} held by another process", m_lock_file);
-    if (!blocking) {
+    if (deadline && util::TimePoint::now() >= *deadline) {
       break;
     }
 
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <NonCopyable.hpp>
+#include <util/Duration.hpp>
 #include <util/TimePoint.hpp>
 
 #include <condition_variable>
@@ -40,12 +41,20 @@ public:
   // Acquire lock, non-blocking. Returns true if acquired, otherwise false.
   bool try_acquire();
 
+  // Acquire lock, blocking for at most `timeout`. Returns true if acquired,
+  // otherwise false.
+  bool try_acquire_for(const util::Duration& timeout);
+
   // Release lock. If not previously acquired, nothing happens.
   void release();
 
   // Return whether the lock was acquired successfully.
   bool acquired() const;
 
+  // Return whether the lock is currently held by another process that has
+  // been active recently. Unlike try_acquire, this doesn't log anything.
+  bool held_by_active_process();
+
 protected:
   LockFile(const std::string& path);
 
@@ -57,15 +66,16 @@ private:
   void* m_handle;
 #endif
 
-  bool acquire(bool blocking);
+  // Acquire lock, giving up when `deadline` has passed (never if nullopt).
+  bool acquire(std::optional<util::TimePoint> deadline);
   virtual void on_after_acquire();
   virtual void on_before_release();
 #ifndef _WIN32
-  bool do_acquire(bool blocking);
+  bool do_acquire(std::optional<util::TimePoint> deadline);
   virtual bool on_before_break();
   virtual std::optional<util::TimePoint> get_last_lock_update();
 #else
-  void* do_acquire(bool blocking);
+  void* do_acquire(std::optional<util::TimePoint> deadline);
 #endif
 };
 
@@ -0,0 +1,211 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "TaskPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace {
+
+// The pool and worker index of the current thread if it's a worker thread.
+thread_local const util::TaskPool* t_pool = nullptr;
+thread_local size_t t_worker_index = 0;
+
+// A thread that has nothing to execute while waiting for a task group
+// normally sleeps until a task in the group finishes, but also wakes up
+// regularly to help with tasks submitted after it went to sleep.
+const auto k_help_interval = std::chrono::milliseconds(1);
+
+} // namespace
+
+namespace util {
+
+TaskPool::TaskPool(size_t max_threads)
+  : m_max_threads(
+    max_threads > 0
+      ? max_threads
+      : std::max(std::thread::hardware_concurrency(), 1U))
+{
+  m_workers.reserve(m_max_threads);
+  for (size_t i = 0; i < m_max_threads; ++i) {
+    m_workers.push_back(std::make_unique<Worker>());
+  }
+}
+
+TaskPool::~TaskPool()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_shutting_down = true;
+  }
+  m_task_queued_or_shutting_down_condition.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+void
+TaskPool::submit(Task task)
+{
+  const size_t index =
+    t_pool == this ? t_worker_index : m_next_worker++ % m_max_threads;
+  {
+    auto& worker = *m_workers[index];
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  ++m_queued_tasks;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_idle_threads > 0) {
+    m_task_queued_or_shutting_down_condition.notify_one();
+  } else if (m_threads.size() < m_max_threads) {
+    m_threads.emplace_back(
+      &TaskPool::worker_thread_main, this, m_threads.size());
+  }
+}
+
+bool
+TaskPool::run_one()
+{
+  Task task;
+
+  const bool is_worker = t_pool == this;
+  if (is_worker) {
+    auto& worker = *m_workers[t_worker_index];
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    if (!worker.tasks.empty()) {
+      task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+    }
+  }
+
+  const size_t start = is_worker ? t_worker_index + 1 : m_next_worker.load();
+  for (size_t i = 0; !task && i < m_max_threads; ++i) {
+    auto& victim = *m_workers[(start + i) % m_max_threads];
+    std::unique_lock<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+    }
+  }
+
+  if (!task) {
+    return false;
+  }
+  --m_queued_tasks;
+  task();
+  return true;
+}
+
+void
+TaskPool::worker_thread_main(const size_t index)
+{
+  t_pool = this;
+  t_worker_index = index;
+
+  while (true) {
+    if (run_one()) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_queued_tasks > 0) {
+      continue;
+    }
+    if (m_shutting_down) {
+      return;
+    }
+    ++m_idle_threads;
+    m_task_queued_or_shutting_down_condition.wait(
+      lock, [this] { return m_queued_tasks > 0 || m_shutting_down; });
+    --m_idle_threads;
+  }
+}
+
+TaskGroup::TaskGroup(TaskPool& pool, const size_t max_unfinished)
+  : m_pool(pool),
+    m_max_unfinished(std::max(max_unfinished, size_t{1}))
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+  try {
+    wait();
+  } catch (...) {
+    // Ignore since the caller didn't ask for the result.
+  }
+}
+
+void
+TaskGroup::run(std::function<void()> function)
+{
+  help_until([this] { return m_unfinished_tasks < m_max_unfinished; });
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ++m_unfinished_tasks;
+  }
+
+  m_pool.submit([this, function = std::move(function)] {
+    std::exception_ptr exception;
+    try {
+      function();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    // Notify while holding the lock since the group may be destroyed as soon
+    // as the lock is released.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (exception && !m_exception) {
+      m_exception = exception;
+    }
+    --m_unfinished_tasks;
+    m_task_finished_condition.notify_all();
+  });
+}
+
+void
+TaskGroup::wait()
+{
+  help_until([this] { return m_unfinished_tasks == 0; });
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_exception) {
+    std::rethrow_exception(std::exchange(m_exception, nullptr));
+  }
+}
+
+template<typename Predicate>
+void
+TaskGroup::help_until(Predicate predicate)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!predicate()) {
+    lock.unlock();
+    const bool executed_task = m_pool.run_one();
+    lock.lock();
+    if (!executed_task) {
+      m_task_finished_condition.wait_for(lock, k_help_interval, predicate);
+    }
+  }
+}
+
+} // namespace util
@@ -0,0 +1,129 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <NonCopyable.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// A pool of worker threads that execute tasks submitted via TaskGroup.
+//
+// Each worker has its own task deque. Tasks submitted from a worker are put
+// in the worker's deque and executed in LIFO order by it, while idle workers
+// steal the oldest tasks from other deques. Worker threads are started on
+// demand when tasks are submitted and no worker is idle, so a pool that is
+// created but never (or only lightly) used is cheap.
+class TaskPool : NonCopyable
+{
+public:
+  // Create a pool with at most `max_threads` worker threads (the number of
+  // hardware threads if 0).
+  explicit TaskPool(size_t max_threads = 0);
+
+  // Wait for all submitted tasks to finish and stop the worker threads.
+  ~TaskPool();
+
+  size_t max_threads() const;
+
+private:
+  friend class TaskGroup;
+
+  using Task = std::function<void()>;
+
+  struct Worker
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  const size_t m_max_threads;
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::atomic<size_t> m_queued_tasks{0};
+  std::atomic<size_t> m_next_worker{0};
+
+  std::mutex m_mutex;
+  std::condition_variable m_task_queued_or_shutting_down_condition;
+  std::vector<std::thread> m_threads;
+  size_t m_idle_threads = 0;
+  bool m_shutting_down = false;
+
+  void submit(Task task);
+
+  // Execute one queued task, preferably from the calling worker's own deque.
+  // Returns false if there were no queued tasks.
+  bool run_one();
+
+  void worker_thread_main(size_t index);
+};
+
+// A group of tasks executed by a TaskPool that can be waited for as a unit.
+//
+// Threads that wait for the group, or for room to submit more tasks, execute
+// queued tasks in the meantime instead of blocking.
+class TaskGroup : NonCopyable
+{
+public:
+  // At most `max_unfinished` tasks in the group may be queued or executing at
+  // the same time. This bounds the memory used when the submitting thread
+  // reads ahead, for instance when each task owns a file's data.
+  explicit TaskGroup(
+    TaskPool& pool,
+    size_t max_unfinished = std::numeric_limits<size_t>::max());
+
+  // Wait for the tasks of the group to finish, ignoring exceptions.
+  ~TaskGroup();
+
+  // Submit `function` for execution, first waiting until there is room for it
+  // if needed.
+  void run(std::function<void()> function);
+
+  // Wait for all tasks of the group to finish. If a task threw an exception,
+  // the first one is rethrown.
+  void wait();
+
+private:
+  TaskPool& m_pool;
+  const size_t m_max_unfinished;
+  std::mutex m_mutex;
+  std::condition_variable m_task_finished_condition;
+  size_t m_unfinished_tasks = 0;
+  std::exception_ptr m_exception;
+
+  template<typename Predicate> void help_until(Predicate predicate);
+};
+
+inline size_t
+TaskPool::max_threads() const
+{
+  return m_max_threads;
+}
+
+} // namespace util
@@ -27,6 +27,23 @@
 
 namespace util {
 
+std::string
+escape_json(const std::string_view string)
+{
+  std::string result;
+  for (const char c : string) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      result += FMT("\\u{:04x}", static_cast<int>(c));
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
 nonstd::expected<double, std::string>
 parse_double(const std::string& value)
 {
@@ -37,6 +37,9 @@ namespace util {
 // Return true if `suffix` is a suffix of `string`.
 bool ends_with(std::string_view string, std::string_view suffix);
 
+// Escape `string` for use in a JSON string literal.
+std::string escape_json(std::string_view string);
+
 // Join stringified elements of `container` delimited by `delimiter` into a
 // string. There must exist an `std::string to_string(T::value_type)` function.
 template<typename T>
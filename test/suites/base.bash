@@ -462,6 +462,37 @@ fi
 
     expect_stat files_in_cache 1
 
+    # -------------------------------------------------------------------------
+    if ! $HOST_OS_WINDOWS; then
+        TEST "CCACHE_ADMISSIONPOLICY=doorkeeper"
+
+        export CCACHE_ADMISSIONPOLICY=doorkeeper
+
+        $CCACHE_COMPILE -c test1.c
+        expect_stat cache_miss 1
+        expect_stat admission_rejected 1
+        expect_stat files_in_cache 0
+        expect_exists test1.o
+
+        $CCACHE_COMPILE -c test1.c
+        expect_stat cache_miss 2
+        expect_stat admission_rejected 1
+        expect_stat files_in_cache 1
+
+        $CCACHE_COMPILE -c test1.c
+        expect_stat preprocessed_cache_hit 1
+        expect_stat cache_miss 2
+
+        $COMPILER -c -o reference_test1.o test1.c
+        expect_equal_object_files reference_test1.o test1.o
+
+        generate_code 2 test2.c
+        CCACHE_RECACHE=1 $CCACHE_COMPILE -c test2.c
+        expect_stat admission_rejected 1
+        expect_stat recache 1
+        expect_stat files_in_cache 2
+    fi
+
     # -------------------------------------------------------------------------
     TEST "Directory is hashed if using -g"
 
@@ -1673,6 +1704,121 @@ fi
         fi
     done
 
+    # -------------------------------------------------------------------------
+if ! $HOST_OS_WINDOWS; then
+    TEST "CCACHE_LEASETIMEOUT"
+
+    $CCACHE_COMPILE -c test1.c
+    expect_stat cache_miss 1
+    result_key=$(sed -n 's/.*Result key: //p' $CCACHE_LOGFILE | tail -n 1)
+
+    # A fresh lease held by another process makes ccache wait and then compile
+    # on its own when the wait times out.
+    $CCACHE -C >/dev/null
+    mkdir -p $CCACHE_DIR/lock
+    ln -s foo $CCACHE_DIR/lock/$result_key.lock
+    touch $CCACHE_DIR/lock/$result_key.alive
+    CCACHE_LEASETIMEOUT=1 $CCACHE_COMPILE -c test1.c
+    expect_stat local_lease_wait 1
+    expect_stat local_lease_timeout 1
+    expect_stat cache_miss 2
+
+    # Without contention the lease is taken immediately.
+    rm $CCACHE_DIR/lock/$result_key.lock $CCACHE_DIR/lock/$result_key.alive
+    $CCACHE -C >/dev/null
+    CCACHE_LEASETIMEOUT=1 $CCACHE_COMPILE -c test1.c
+    expect_stat local_lease_wait 1
+    expect_stat local_lease_timeout 1
+    expect_stat cache_miss 3
+    expect_missing $CCACHE_DIR/lock/$result_key.lock
+
+    CCACHE_LEASETIMEOUT=1 $CCACHE_COMPILE -c test1.c
+    expect_stat preprocessed_cache_hit 1
+    expect_stat cache_miss 3
+
+    # -------------------------------------------------------------------------
+    TEST "CCACHE_MAXCOMPILES"
+
+    # A miss waits for a busy compile slot to be released.
+    mkdir -p $CCACHE_DIR/lock
+    ln -s foo $CCACHE_DIR/lock/compile_slot_0.lock
+    touch $CCACHE_DIR/lock/compile_slot_0.alive
+    (sleep 1; rm $CCACHE_DIR/lock/compile_slot_0.*) &
+    CCACHE_LOGFILE=slot.log CCACHE_MAXCOMPILES=1 $CCACHE_COMPILE -c test1.c
+    wait
+    expect_stat cache_miss 1
+    expect_stat compile_slot_wait 1
+
+    # The busy slot is only tried once before waiting and once when free.
+    attempts=$(grep -c "Trying to acquire .*compile_slot_0" slot.log)
+    if [ "$attempts" -ne 2 ]; then
+        test_failed "Expected 2 compile slot attempts, got $attempts"
+    fi
+    expect_not_contains slot.log "Result: compile_slot_wait_ms"
+    expect_missing $CCACHE_DIR/lock/compile_slot_0.lock
+
+    # Hits don't need a slot.
+    ln -s foo $CCACHE_DIR/lock/compile_slot_0.lock
+    touch $CCACHE_DIR/lock/compile_slot_0.alive
+    CCACHE_MAXCOMPILES=1 $CCACHE_COMPILE -c test1.c
+    expect_stat preprocessed_cache_hit 1
+    expect_stat compile_slot_wait 1
+    rm $CCACHE_DIR/lock/compile_slot_0.*
+
+    # -------------------------------------------------------------------------
+    TEST "Compiler resource usage"
+
+    $CCACHE_COMPILE -c test1.c
+    expect_stat cache_miss 1
+    expect_stat compiler_peak_rss_below_256m 1
+    expect_contains $CCACHE_LOGFILE "s user time"
+
+    $CCACHE_COMPILE -c test1.c
+    expect_stat preprocessed_cache_hit 1
+    expect_stat compiler_peak_rss_below_256m 1
+
+    $CCACHE -sv >stats.txt
+    expect_contains stats.txt "Compiler resource usage:"
+fi
+
+    # -------------------------------------------------------------------------
+    TEST "--analyze"
+
+    $CCACHE_COMPILE -c test1.c
+    CCACHE_NAMESPACE=ns $CCACHE_COMPILE -DUNUSED -c test1.c
+    expect_stat cache_miss 2
+
+    $CCACHE --analyze >analysis.txt
+    expect_contains analysis.txt "Entry types:"
+    expect_contains analysis.txt "Namespaces:"
+
+    $CCACHE --analyze --format json >analysis.json
+    expect_contains analysis.json '"result": {"count": 2,'
+    expect_contains analysis.json '"duplicated": {"count": 1,'
+    expect_contains analysis.json '"never_hit": {"count": 2,'
+    expect_contains analysis.json '"ns": {"count": 1,'
+
+    if $CCACHE --analyze --format xml >/dev/null 2>&1; then
+        test_failed "Unknown format not rejected"
+    fi
+
+    # -------------------------------------------------------------------------
+    TEST "--simulate-size"
+
+    export CCACHE_ACCESSTRACEFILE=$PWD/access.trace
+
+    $CCACHE_COMPILE -c test1.c
+    expect_stat cache_miss 1
+    $CCACHE_COMPILE -c test1.c
+    expect_stat preprocessed_cache_hit 1
+
+    $CCACHE --simulate-size 1k,1G >simulation.txt
+    expect_contains simulation.txt "Trace events:"
+    expect_contains simulation.txt "50.0 %"
+    if ! grep -q "^1.0 GB  *lru  *50.0 %" simulation.txt; then
+        test_failed "Unexpected --simulate-size output"
+    fi
+
     # -------------------------------------------------------------------------
     TEST "--hash-file"
 
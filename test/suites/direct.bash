@@ -114,6 +114,112 @@ SUITE_direct() {
     expect_stat preprocessed_cache_hit 0
     expect_stat cache_miss 2
 
+    # -------------------------------------------------------------------------
+    TEST "Include files from manifest are hashed during preprocessing"
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+
+    echo "int test3_2;" >>test3.h
+    backdate test3.h
+    rm -f "$CCACHE_LOGFILE"
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 0
+    expect_stat cache_miss 2
+    expect_contains "$CCACHE_LOGFILE" "Prefetched 4 of 4 include files"
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat cache_miss 2
+
+    CCACHE_NOINODECACHE=1 $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 2
+    expect_stat cache_miss 2
+
+    # -------------------------------------------------------------------------
+    TEST "Digest map"
+
+    echo '#include "test.h"' >test.c
+    echo 'int a;' >test.h
+    backdate test.h
+    backdate test.c
+    write_digest_map() {
+        python3 - >digest_map <<EOF
+import os
+for path in ["test.c", "test.h"]:
+    st = os.stat(path)
+    print(f"{40 * '0'} {st.st_size} {st.st_mtime_ns} {st.st_ctime_ns}"
+          f" {st.st_dev} {st.st_ino} {os.getcwd()}/{path}")
+EOF
+    }
+    write_digest_map
+    export CCACHE_DIGESTMAP=$PWD/digest_map
+
+    CCACHE_SLOPPINESS=time_macros $CCACHE $COMPILER -c test.c
+    expect_stat direct_cache_miss 1
+    expect_stat digest_map_hit 2
+
+    # The file isn't read if its stat data matches the map.
+    echo 'int b;' >test.h
+    backdate test.h
+    write_digest_map
+    CCACHE_SLOPPINESS=time_macros $CCACHE $COMPILER -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat digest_map_hit 4
+
+    # The map isn't used without time_macros sloppiness.
+    $CCACHE $COMPILER -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat direct_cache_miss 2
+    expect_stat digest_map_hit 4
+
+    # Stale entries are ignored, also for a rewrite with the same size and
+    # mtime.
+    mtime=$(python3 -c 'import os; print(os.stat("test.h").st_mtime_ns)')
+    echo 'int c;' >test.h
+    python3 -c "import os; os.utime('test.h', ns=($mtime, $mtime))"
+    CCACHE_SLOPPINESS=time_macros $CCACHE $COMPILER -c test.c
+    expect_stat direct_cache_miss 3
+    expect_stat digest_map_hit 5
+
+    # -------------------------------------------------------------------------
+    if command -v git >/dev/null; then
+        TEST "Git index"
+
+        git init -q .
+        echo '#include "test.h"' >test.c
+        echo 'int a;' >test.h
+        backdate test.c test.h
+        git add test.c test.h
+        export CCACHE_SLOPPINESS=time_macros
+
+        CCACHE_GITINDEX=1 $CCACHE $COMPILER -c test.c
+        expect_stat direct_cache_miss 1
+
+        CCACHE_GITINDEX=1 $CCACHE $COMPILER -c test.c
+        expect_stat direct_cache_hit 1
+
+        # The digests of tracked files are based on the object IDs, so they
+        # differ from digests computed from the files.
+        $CCACHE $COMPILER -c test.c
+        expect_stat direct_cache_hit 1
+        expect_stat direct_cache_miss 2
+
+        # Modified files are read.
+        echo 'int bb;' >test.h
+        backdate test.h
+        CCACHE_GITINDEX=1 $CCACHE $COMPILER -c test.c
+        expect_stat direct_cache_miss 3
+
+        git add test.h
+        CCACHE_GITINDEX=1 $CCACHE $COMPILER -c test.c
+        expect_stat direct_cache_miss 4
+        expect_stat preprocessed_cache_hit 2
+
+        CCACHE_GITINDEX=1 $CCACHE $COMPILER -c test.c
+        expect_stat direct_cache_hit 2
+    fi
+
     # -------------------------------------------------------------------------
     TEST "Removed but previously compiled header file"
 
@@ -1224,6 +1330,65 @@ EOF
         test_failed "$manifest contained ignored header: $data"
     fi
 
+    # -------------------------------------------------------------------------
+    TEST "CCACHE_IMMUTABLEROOTS"
+
+    mkdir subdir
+    echo '#define VALUE 1' >subdir/immutable.h
+    backdate subdir/immutable.h
+    cat <<EOF >immutable.c
+#include "subdir/immutable.h"
+int foo = VALUE;
+EOF
+    export CCACHE_IMMUTABLEROOTS="subdir"
+
+    $CCACHE_COMPILE -c immutable.c
+    expect_stat direct_cache_hit 0
+    expect_stat cache_miss 1
+
+    $CCACHE_COMPILE -c immutable.c
+    expect_stat direct_cache_hit 1
+    expect_stat cache_miss 1
+
+    # Modifying a file in place is not detected since the root is declared
+    # immutable.
+    echo '#define VALUE 2' >subdir/immutable.h
+    backdate subdir/immutable.h
+    $CCACHE_COMPILE -c immutable.c
+    expect_stat direct_cache_hit 2
+    expect_stat cache_miss 1
+
+    # Adding an entry to the root changes its fingerprint.
+    touch subdir/new.h
+    $CCACHE_COMPILE -c immutable.c
+    expect_stat direct_cache_hit 2
+    expect_stat cache_miss 2
+
+    $CCACHE_COMPILE -c immutable.c
+    expect_stat direct_cache_hit 3
+    expect_stat cache_miss 2
+
+    # -------------------------------------------------------------------------
+    TEST "CCACHE_IMMUTABLEROOTS with CCACHE_IGNOREHEADERS"
+
+    mkdir subdir
+    echo '#define VALUE 1' >subdir/immutable.h
+    echo '// We don'"'"'t want this header in the manifest.' >subdir/ignore.h
+    backdate subdir/immutable.h subdir/ignore.h
+    cat <<EOF >immutable.c
+#include "subdir/immutable.h"
+#include "subdir/ignore.h"
+int foo = VALUE;
+EOF
+
+    CCACHE_IMMUTABLEROOTS="subdir" CCACHE_IGNOREHEADERS="subdir/ignore.h" \
+        $CCACHE_COMPILE -c immutable.c
+    expect_stat cache_miss 1
+    manifest=`find $CCACHE_DIR -name '*M'`
+    $CCACHE --inspect $manifest >manifest.dump
+    expect_contains manifest.dump subdir/immutable.h
+    expect_not_contains manifest.dump subdir/ignore.h
+
     # -------------------------------------------------------------------------
     TEST "CCACHE_IGNOREOPTIONS"
 
@@ -1266,4 +1431,32 @@ EOF
     expect_stat files_in_cache 2
 
     expect_equal_content $manifest_file saved.manifest
+
+    # -------------------------------------------------------------------------
+    TEST "Many include files with and without io_uring"
+
+    for i in $(seq 10); do
+        echo "int header_$i;" >header_$i.h
+        echo "#include \"header_$i.h\"" >>many.c
+    done
+    backdate header_*.h
+
+    $CCACHE_COMPILE -c many.c
+    expect_stat direct_cache_hit 0
+    expect_stat cache_miss 1
+
+    CCACHE_IOURING=1 $CCACHE_COMPILE -c many.c
+    expect_stat direct_cache_hit 1
+    expect_stat cache_miss 1
+
+    $CCACHE_COMPILE -c many.c
+    expect_stat direct_cache_hit 2
+    expect_stat cache_miss 1
+
+    echo "int changed;" >>header_7.h
+    backdate header_7.h
+
+    CCACHE_IOURING=1 $CCACHE_COMPILE -c many.c
+    expect_stat direct_cache_hit 2
+    expect_stat cache_miss 2
 }
@@ -8,6 +8,21 @@ SUITE_remote_file_SETUP() {
     generate_code 1 test.c
 }
 
+# Wait for a background push of fleet statistics to show up as $1 in the
+# fleet statistics read by a host without pending statistics.
+wait_for_fleet_stats() {
+    local i
+    for i in $(seq 50); do
+        CCACHE_DIR=$PWD/empty_cache $CCACHE --fleet-stats \
+            | tr -s " " >fleet_stats.txt
+        if grep -q "$1" fleet_stats.txt; then
+            return
+        fi
+        sleep 0.1
+    done
+    expect_contains fleet_stats.txt "$1"
+}
+
 SUITE_remote_file() {
     # -------------------------------------------------------------------------
     TEST "Base case"
@@ -136,6 +151,85 @@ SUITE_remote_file() {
     expect_file_count 1 '*' remote # CACHEDIR.TAG
     expect_file_count 3 '*' remote_2 # CACHEDIR.TAG + result + manifest
 
+    # -------------------------------------------------------------------------
+    TEST "Backfill"
+
+    # Populate only the second remote storage.
+    CCACHE_REMOTE_STORAGE="file://$PWD/remote_2" $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+    expect_file_count 3 '*' remote_2 # CACHEDIR.TAG + result + manifest
+
+    # A hit in the second remote storage is not written to the first one
+    # without the backfill attribute.
+    $CCACHE -C >/dev/null
+    CCACHE_REMOTE_STORAGE+=" file://$PWD/remote_2"
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat remote_storage_hit 2 # result + manifest
+    expect_missing remote
+
+    # Read-only remote storages are not backfilled.
+    $CCACHE -C >/dev/null
+    CCACHE_REMOTE_STORAGE="file://$PWD/remote|backfill|read-only"
+    CCACHE_REMOTE_STORAGE+=" file://$PWD/remote_2"
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 2
+    expect_stat remote_storage_hit 4
+    expect_missing remote
+
+    $CCACHE -C >/dev/null
+    CCACHE_REMOTE_STORAGE="file://$PWD/remote|backfill"
+    CCACHE_REMOTE_STORAGE+=" file://$PWD/remote_2"
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 3
+    expect_stat remote_storage_hit 6
+    expect_file_count 3 '*' remote # CACHEDIR.TAG + result + manifest
+
+    # The next hit is served by the first remote storage.
+    $CCACHE -C >/dev/null
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 4
+    expect_stat remote_storage_hit 8
+    expect_stat remote_storage_miss 8 # unchanged
+
+    # -------------------------------------------------------------------------
+    TEST "Fleet statistics"
+
+    CCACHE_REMOTE_STORAGE+="|fleet-stats"
+
+    # The first compilation pushes its statistics in the background since
+    # nothing has been pushed before.
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+    wait_for_fleet_stats "Misses: 1 / 1"
+    expect_file_count 4 '*' remote # CACHEDIR.TAG + result + manifest + stats
+
+    # Later compilations and --show-stats don't push within the interval.
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 1
+    $CCACHE -s >/dev/null
+    CCACHE_DIR=$PWD/empty_cache $CCACHE --fleet-stats \
+        | tr -s " " >fleet_stats.txt
+    expect_contains fleet_stats.txt "Hits: 0 / 1"
+
+    # --fleet-stats pushes regardless of the interval.
+    $CCACHE --fleet-stats | tr -s " " >fleet_stats.txt
+    expect_contains fleet_stats.txt "Hits: 1 / 2"
+
+    # Another host pushing to the same remote storage from a compilation and
+    # when cleaning up.
+    CCACHE_DIR=$PWD/other_cache $CCACHE_COMPILE -c test.c
+    wait_for_fleet_stats "Hits: 2 / 3"
+    CCACHE_DIR=$PWD/other_cache $CCACHE_COMPILE -c test.c
+    CCACHE_DIR=$PWD/other_cache \
+        CCACHE_REMOTE_STORAGE="$CCACHE_REMOTE_STORAGE|fleet-stats-interval=0" \
+        $CCACHE -c >/dev/null
+
+    $CCACHE --fleet-stats | tr -s " " >fleet_stats.txt
+    expect_contains fleet_stats.txt "Hits: 3 / 4"
+    expect_contains fleet_stats.txt "Misses: 1 / 4"
+    expect_not_contains fleet_stats.txt "Cache size"
+
     # -------------------------------------------------------------------------
     TEST "Read-only"
 
@@ -263,7 +357,7 @@ SUITE_remote_file() {
     expect_stat direct_cache_miss 0
     expect_stat cache_miss 0
     expect_stat recache 2
-    expect_stat files_in_cache 2
+    expect_stat files_in_cache 2 # result + manifest
     expect_stat local_storage_hit 0
     expect_stat local_storage_miss 2 # Try to read manifest for updating
     expect_stat remote_storage_hit 1 # Read manifest for updating
@@ -419,4 +513,156 @@ SUITE_remote_file() {
     expect_stat local_storage_miss 5
     expect_stat remote_storage_hit 2
     expect_stat remote_storage_miss 2
+
+    # -------------------------------------------------------------------------
+    TEST "Manifest merging in remote storage"
+
+    # The compiler copies entries stored by another host into remote storage
+    # when INJECT is set, i.e. after this host has read the manifest.
+    cat >compiler.sh <<EOF
+#!/bin/sh
+if [ -n "\$INJECT" ]; then cp -R "\$INJECT"/. remote; fi
+exec $COMPILER "\$@"
+EOF
+    chmod +x compiler.sh
+    backdate compiler.sh
+
+    echo '#include "test.h"' >test.c
+
+    for attribute in "" "|merge-manifests"; do
+        rm -rf remote remote_other
+        $CCACHE -Cz >/dev/null
+
+        # Another host stores an "int x;" result.
+        echo 'int x;' >test.h
+        backdate test.h
+        CCACHE_REMOTE_STORAGE="file://$PWD/remote_other" \
+            $CCACHE ./compiler.sh -c test.c
+        expect_stat cache_miss 1
+
+        # This host stores an "int y;" result concurrently.
+        $CCACHE -C >/dev/null
+        echo 'int y;' >test.h
+        backdate test.h
+        CCACHE_REMOTE_STORAGE+="$attribute" INJECT=remote_other \
+            $CCACHE ./compiler.sh -c test.c
+        expect_stat cache_miss 2
+
+        $CCACHE -C >/dev/null
+        $CCACHE ./compiler.sh -c test.c
+        expect_stat direct_cache_hit 1
+
+        $CCACHE -C >/dev/null
+        echo 'int x;' >test.h
+        backdate test.h
+        $CCACHE ./compiler.sh -c test.c
+        if [ -z "$attribute" ]; then
+            # The "int x;" result was lost from the manifest.
+            expect_stat direct_cache_hit 1
+            expect_stat preprocessed_cache_hit 1
+        else
+            expect_stat direct_cache_hit 2
+            expect_stat preprocessed_cache_hit 0
+        fi
+        expect_file_count 0 '*.lock' remote
+    done
+
+    # -------------------------------------------------------------------------
+    TEST "Inline results"
+
+    export CCACHE_REMOTE_INLINE_MAX_SIZE=100k
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+    expect_stat remote_storage_miss 2 # result + manifest
+    expect_file_count 3 '*' remote # CACHEDIR.TAG + result + manifest
+
+    # Get manifest and result from remote storage in one round trip.
+    $CCACHE -C >/dev/null
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat cache_miss 1
+    expect_stat remote_storage_hit 1 # manifest with inline result
+    expect_stat remote_storage_miss 2
+    expect_stat files_in_cache 2 # result + manifest stored locally
+
+    # The local manifest doesn't contain the inline result.
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 2
+    expect_stat local_storage_hit 2 # result + manifest
+    if $CCACHE --inspect $(find $CCACHE_DIR -name '*M') | grep -q "Inline results"; then
+        test_failed "Unexpected inline result in local manifest"
+    fi
+
+    # Results are not inlined when disabled.
+    $CCACHE -C >/dev/null
+    rm -rf remote
+    CCACHE_REMOTE_INLINE_MAX_SIZE=0 $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 2
+    $CCACHE -C >/dev/null
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 3
+    expect_stat remote_storage_hit 3 # result + manifest
+
+    # -------------------------------------------------------------------------
+    TEST "Lease"
+
+    CCACHE_REMOTE_STORAGE+="|layout=flat|lease"
+    export CCACHE_LEASETIMEOUT=1
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+    expect_stat remote_lease_win 1
+    expect_stat remote_lease_wait 0
+    expect_file_count 0 '*.lease' remote
+    result_key=$(sed -n 's/.*Result key: //p' $CCACHE_LOGFILE | tail -n 1)
+
+    # A lease held by another host makes ccache wait and then compile on its
+    # own when the wait times out.
+    $CCACHE -C >/dev/null
+    rm -rf remote
+    mkdir remote
+    printf 99999999999999 >remote/$result_key.lease
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 2
+    expect_stat remote_lease_win 1
+    expect_stat remote_lease_wait 1
+    expect_stat remote_lease_timeout 1
+    expect_exists remote/$result_key.lease
+
+    # An expired lease is broken.
+    $CCACHE -C >/dev/null
+    rm -rf remote
+    mkdir remote
+    printf 1 >remote/$result_key.lease
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 3
+    expect_stat remote_lease_win 2
+    expect_stat remote_lease_wait 1
+    expect_stat remote_lease_timeout 1
+    expect_file_count 0 '*.lease' remote
+
+    # The lease is renewed while the compiler runs for longer than the lease
+    # timeout.
+    cat >compiler.sh <<EOF
+#!/bin/sh
+case " \$* " in
+    *" -E "*) ;;
+    *)
+        sleep 2
+        python3 -c "import glob, sys, time; sys.exit(int(open(glob.glob(sys.argv[1])[0]).read().split()[0]) < time.time() * 1000)" \
+            "$PWD/remote/*.lease" || exit 1
+        ;;
+esac
+exec $COMPILER "\$@"
+EOF
+    chmod +x compiler.sh
+    backdate compiler.sh
+    $CCACHE -C >/dev/null
+    rm -rf remote
+    $CCACHE ./compiler.sh -c test.c
+    expect_stat cache_miss 4
+    expect_stat remote_lease_win 3
+    expect_stat compile_failed 0
+    expect_file_count 0 '*.lease' remote
 }
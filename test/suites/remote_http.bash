@@ -204,4 +204,84 @@ SUITE_remote_http() {
         expect_stat files_in_cache 2 # fetched from remote
         expect_file_count 2 '*' remote # result + manifest
     fi
+
+    # -------------------------------------------------------------------------
+    TEST "Revalidation of manifest"
+
+    start_http_server 12780 remote
+    export CCACHE_REMOTE_STORAGE="http://localhost:12780"
+
+    echo '#include "test.h"' >test2.c
+    echo 'int a;' >test.h
+    $CCACHE_COMPILE -c test2.c
+    expect_stat direct_cache_hit 0
+    expect_stat cache_miss 1
+
+    $CCACHE -C >/dev/null
+    $CCACHE_COMPILE -c test2.c
+    expect_stat direct_cache_hit 1
+    expect_stat cache_miss 1
+
+    echo 'int b;' >test.h
+    rm -f "$CCACHE_LOGFILE"
+    $CCACHE_COMPILE -c test2.c
+    expect_stat direct_cache_hit 1
+    expect_stat cache_miss 2
+    expect_contains "$CCACHE_LOGFILE" "is unchanged"
+
+    echo 'int a;' >test.h
+    $CCACHE_COMPILE -c test2.c
+    expect_stat direct_cache_hit 2
+    expect_stat cache_miss 2
+
+    # -------------------------------------------------------------------------
+    TEST "Stale manifest version tag"
+
+    start_http_server 12781 remote
+    export CCACHE_REMOTE_STORAGE="http://localhost:12781"
+
+    echo '#include "test.h"' >test2.c
+    echo 'int a;' >test.h
+    $CCACHE_COMPILE -c test2.c
+    expect_stat cache_miss 1
+
+    # The manifest fetched from remote storage gets a version tag, which is not
+    # counted as a file in the cache.
+    $CCACHE -C >/dev/null
+    $CCACHE_COMPILE -c test2.c
+    expect_stat direct_cache_hit 1
+    expect_stat files_in_cache 2 # result + manifest
+    expect_file_count 1 '*V' $CCACHE_DIR
+
+    # The local manifest is evicted but its version tag is left behind, and a
+    # new manifest is then created without remote storage.
+    find $CCACHE_DIR -name '*M' -delete
+    echo 'int b;' >test.h
+    CCACHE_REMOTE_STORAGE= $CCACHE_COMPILE -c test2.c
+    expect_stat cache_miss 2
+    expect_file_count 1 '*V' $CCACHE_DIR
+
+    # The remote manifest must not be considered to be the local one.
+    echo 'int a;' >test.h
+    rm -f "$CCACHE_LOGFILE"
+    $CCACHE_COMPILE -c test2.c
+    expect_stat direct_cache_hit 2
+    expect_stat cache_miss 2
+    expect_contains "$CCACHE_LOGFILE" "Ignoring remote version tag"
+    expect_not_contains "$CCACHE_LOGFILE" "is unchanged"
+
+    # A version tag recorded for other manifest content is ignored.
+    for manifest in $(find $CCACHE_DIR -name '*M'); do
+        printf '0000000000000000 http://localhost:12781 "1-1"' \
+            >${manifest%M}V
+    done
+    echo 'int c;' >test.h
+    rm -f "$CCACHE_LOGFILE"
+    $CCACHE_COMPILE -c test2.c
+    expect_contains "$CCACHE_LOGFILE" "Ignoring remote version tag"
+
+    # Cleanup removes version tags whose manifest is gone.
+    find $CCACHE_DIR -name '*M' -delete
+    $CCACHE -c >/dev/null
+    expect_file_count 0 '*V' $CCACHE_DIR
 }
@@ -0,0 +1,202 @@
+start_cache_server() {
+    local port="$1"
+    local cache_dir="$2"
+    shift 2
+
+    "${CACHE_SERVER}" --port "${port}" "$@" "${cache_dir}" \
+        &>cache-server.log &
+    "${HTTP_CLIENT}" "http://localhost:${port}" &>http-client.log \
+        || test_failed_internal "Cannot connect to server"
+}
+
+get_metric() {
+    local port="$1"
+    local name="$2"
+
+    python3 -c "import urllib.request; print(urllib.request.urlopen('http://localhost:${port}/_metrics').read().decode())" \
+        | awk -v name="ccache_server_${name}" '$1 == name { print $2 }'
+}
+
+SUITE_remote_server_PROBE() {
+    if [ ! -x "${CACHE_SERVER}" ]; then
+        echo "${CACHE_SERVER} not found"
+    elif ! "${HTTP_CLIENT}" --help >/dev/null 2>&1; then
+        echo "cannot execute ${HTTP_CLIENT} - Python 3 might be missing"
+    fi
+}
+
+SUITE_remote_server_SETUP() {
+    unset CCACHE_NODIRECT
+
+    generate_code 1 test.c
+}
+
+SUITE_remote_server() {
+    # -------------------------------------------------------------------------
+    TEST "Subdirs and flat layouts"
+
+    start_cache_server 12790 remote
+    export CCACHE_REMOTE_STORAGE="http://localhost:12790|layout=subdirs"
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 0
+    expect_stat cache_miss 1
+    expect_file_count 2 '*' remote # result + manifest
+
+    $CCACHE -C >/dev/null
+    export CCACHE_REMOTE_STORAGE="http://localhost:12790/prefix|layout=flat"
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat cache_miss 1
+    expect_stat remote_storage_hit 2
+    expect_file_count 2 '*' remote
+
+    if [ "$(get_metric 12790 hits_total)" != 2 ]; then
+        test_failed "Expected 2 hits in metrics"
+    fi
+
+    # -------------------------------------------------------------------------
+    TEST "Entries are kept when restarting"
+
+    start_cache_server 12791 remote
+    export CCACHE_REMOTE_STORAGE="http://localhost:12791"
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+
+    kill %1
+    wait
+    start_cache_server 12792 remote
+    export CCACHE_REMOTE_STORAGE="http://localhost:12792"
+    $CCACHE -C >/dev/null
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat remote_storage_hit 2
+
+    # -------------------------------------------------------------------------
+    TEST "Least recently used entries are evicted"
+
+    start_cache_server 12793 remote --max-size 0.1k
+    export CCACHE_REMOTE_STORAGE="http://localhost:12793"
+
+    # The result is evicted when the manifest is stored.
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+    expect_file_count 1 '*' remote
+
+    if [ "$(get_metric 12793 evictions_total)" != 1 ]; then
+        test_failed "Expected 1 eviction in metrics"
+    fi
+
+    # -------------------------------------------------------------------------
+    if ! $HOST_OS_WINDOWS; then
+        TEST "Unix socket"
+
+        "${CACHE_SERVER}" --socket "$PWD/server.sock" remote \
+            &>cache-server.log &
+        "${HTTP_CLIENT}" --unix-socket "$PWD/server.sock" http://localhost \
+            &>http-client.log \
+            || test_failed_internal "Cannot connect to server"
+        export CCACHE_REMOTE_STORAGE="http+unix:$PWD/server.sock"
+
+        $CCACHE_COMPILE -c test.c
+        expect_stat cache_miss 1
+        expect_file_count 2 '*' remote
+
+        $CCACHE -C >/dev/null
+        export CCACHE_REMOTE_STORAGE="http+unix://localhost$PWD/server.sock"
+
+        $CCACHE_COMPILE -c test.c
+        expect_stat direct_cache_hit 1
+        expect_stat remote_storage_hit 2
+        expect_stat remote_storage_error 0
+    fi
+
+    # -------------------------------------------------------------------------
+    TEST "Compile leases"
+
+    start_cache_server 12794 remote
+    export CCACHE_REMOTE_STORAGE="http://localhost:12794|lease"
+    export CCACHE_LEASETIMEOUT=1
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+    expect_stat remote_lease_win 1
+    expect_file_count 0 '*.lease' remote
+    result_key=$(sed -n 's/.*Result key: //p' $CCACHE_LOGFILE | tail -n 1)
+    lease_file=remote/${result_key:0:2}/${result_key:2}.lease
+
+    # An expired lease is broken. A lease held by another host is left alone
+    # after waiting for it.
+    kill %1
+    wait
+    rm -rf remote
+    mkdir -p $(dirname $lease_file)
+    printf "1 other" >$lease_file
+    start_cache_server 12796 remote
+    export CCACHE_REMOTE_STORAGE="http://localhost:12796|lease"
+    $CCACHE -C >/dev/null
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 2
+    expect_stat remote_lease_win 2
+    expect_file_count 0 '*.lease' remote
+
+    kill %1
+    wait
+    rm -rf remote
+    mkdir -p $(dirname $lease_file)
+    printf "99999999999999 other" >$lease_file
+    start_cache_server 12797 remote
+    export CCACHE_REMOTE_STORAGE="http://localhost:12797|lease"
+    $CCACHE -C >/dev/null
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 3
+    expect_stat remote_lease_win 2
+    expect_stat remote_lease_timeout 1
+    expect_content $lease_file "99999999999999 other"
+
+    # -------------------------------------------------------------------------
+    TEST "Manifest merging"
+
+    start_cache_server 12795 remote
+    export CCACHE_REMOTE_STORAGE="http://localhost:12795|merge-manifests"
+
+    # The compiler uploads entries stored by another host when INJECT is set,
+    # i.e. after this host has read the manifest.
+    cat >compiler.sh <<EOF
+#!/bin/sh
+if [ -n "\$INJECT" ]; then
+    for f in "\$INJECT"/??/*; do
+        python3 -c "import sys, urllib.request as r; r.urlopen(r.Request(sys.argv[1], open(sys.argv[2], 'rb').read(), method='PUT'))" \
+            "http://localhost:12795/\${f#\$INJECT/}" "\$f"
+    done
+fi
+exec $COMPILER "\$@"
+EOF
+    chmod +x compiler.sh
+    backdate compiler.sh
+
+    echo '#include "test.h"' >test.c
+    echo 'int x;' >test.h
+    backdate test.h
+    CCACHE_REMOTE_STORAGE="file://$PWD/remote_other" \
+        $CCACHE ./compiler.sh -c test.c
+    expect_stat cache_miss 1
+
+    $CCACHE -C >/dev/null
+    echo 'int y;' >test.h
+    backdate test.h
+    INJECT=remote_other $CCACHE ./compiler.sh -c test.c
+    expect_stat cache_miss 2
+
+    $CCACHE -C >/dev/null
+    echo 'int x;' >test.h
+    backdate test.h
+    $CCACHE ./compiler.sh -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat preprocessed_cache_hit 0
+}
@@ -0,0 +1,107 @@
+SUITE_syscall_budget_PROBE() {
+    if ! $HOST_OS_LINUX; then
+        echo "LD_PRELOAD syscall counting only supported on Linux"
+        return
+    fi
+    if ! $REAL_COMPILER_BIN -shared -fPIC -o "$SYSCALL_COUNTER" \
+            "$SYSCALL_COUNTER_SOURCE" -ldl >/dev/null 2>&1; then
+        echo "failed to build $SYSCALL_COUNTER_SOURCE"
+        return
+    fi
+    SYSCALL_COUNTER_OUTPUT=counts LD_PRELOAD="$SYSCALL_COUNTER" \
+        $CCACHE --version >/dev/null 2>&1
+    if [ ! -s counts ]; then
+        echo "LD_PRELOAD of $SYSCALL_COUNTER does not work for $CCACHE"
+    fi
+}
+
+SUITE_syscall_budget_SETUP() {
+    unset CCACHE_NODIRECT
+    # Logging would dominate the counts.
+    unset CCACHE_LOGFILE
+
+    generate_code 1 test.c
+    generate_code 2 other.c
+}
+
+count_syscalls() {
+    SYSCALL_COUNTER_OUTPUT=syscall_counts LD_PRELOAD="$SYSCALL_COUNTER" "$@"
+}
+
+# Usage: expect_syscall_budget <category> <max> [<category> <max>]...
+#
+# Verifies the counts recorded by the last count_syscalls invocation. When
+# changing the hot paths of ccache, update the budgets so that the change in
+# syscall counts is visible in the diff.
+expect_syscall_budget() {
+    local counts="$(paste -sd ' ' syscall_counts)"
+
+    while [ $# -gt 0 ]; do
+        local category=$1
+        local budget=$2
+        local actual=$(awk -v c=$category '$1 == c { print $2 }' syscall_counts)
+        if [ -z "$actual" ] || [ $actual -gt $budget ]; then
+            test_failed_internal "Expected at most $budget $category calls, actual $actual ($counts)"
+        fi
+        shift 2
+    done
+}
+
+SUITE_syscall_budget() {
+    # -------------------------------------------------------------------------
+    TEST "Direct mode hit"
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+
+    count_syscalls $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 1
+    expect_syscall_budget stat 24 open 5 read 2 write 1 rename 0 unlink 2
+
+    # -------------------------------------------------------------------------
+    TEST "Preprocessor mode hit"
+
+    export CCACHE_NODIRECT=1
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+
+    count_syscalls $CCACHE_COMPILE -c test.c
+    expect_stat preprocessed_cache_hit 1
+    expect_syscall_budget stat 36 open 6 read 3 write 1 rename 0 unlink 4
+
+    # -------------------------------------------------------------------------
+    TEST "Depend mode hit"
+
+    export CCACHE_DEPEND=1
+
+    $CCACHE_COMPILE -MD -c test.c
+    expect_stat cache_miss 1
+
+    count_syscalls $CCACHE_COMPILE -MD -c test.c
+    expect_stat direct_cache_hit 1
+    expect_syscall_budget stat 24 open 6 read 2 write 2 rename 0 unlink 2
+
+    # -------------------------------------------------------------------------
+    TEST "Direct mode miss with store"
+
+    # Let the first compilation set up the cache directory.
+    $CCACHE_COMPILE -c other.c
+    expect_stat cache_miss 1
+
+    count_syscalls $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 2
+    expect_syscall_budget stat 67 open 16 read 7 write 4 rename 1 unlink 8
+
+    # -------------------------------------------------------------------------
+    TEST "Preprocessor mode miss with store"
+
+    export CCACHE_NODIRECT=1
+
+    $CCACHE_COMPILE -c other.c
+    expect_stat cache_miss 1
+
+    count_syscalls $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 2
+    expect_syscall_budget stat 50 open 10 read 6 write 3 rename 1 unlink 6
+}
@@ -0,0 +1,154 @@
+// This is an LD_PRELOAD library that counts calls to file system related libc
+// functions made by a process, used to test syscall budgets of ccache. The
+// counts are written to the file named by the SYSCALL_COUNTER_OUTPUT
+// environment variable when the process exits. Child processes are not
+// counted.
+//
+// Build: cc -shared -fPIC -o syscall-counter.so syscall-counter.c -ldl
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <linux/fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// <sys/stat.h> and <fcntl.h> are not included since their declarations of the
+// wrapped functions may be macros or have attributes that conflict with the
+// definitions below. The open flags come from <linux/fcntl.h> instead.
+
+enum category { STAT, OPEN, READ, WRITE, RENAME, UNLINK, NUM_CATEGORIES };
+
+static const char* const category_names[NUM_CATEGORIES] = {
+  "stat", "open", "read", "write", "rename", "unlink"};
+
+static unsigned long counts[NUM_CATEGORIES];
+static char* output_path;
+
+static void*
+real(const char* name)
+{
+  return dlsym(RTLD_NEXT, name);
+}
+
+#define FORWARD(category, ret, name, params, args)                             \
+  ret name params                                                              \
+  {                                                                            \
+    static ret(*fn) params;                                                    \
+    if (!fn) {                                                                 \
+      fn = (ret(*) params)real(#name);                                         \
+    }                                                                          \
+    ++counts[category];                                                        \
+    return fn args;                                                            \
+  }
+
+FORWARD(STAT, int, stat, (const char* p, void* b), (p, b))
+FORWARD(STAT, int, stat64, (const char* p, void* b), (p, b))
+FORWARD(STAT, int, lstat, (const char* p, void* b), (p, b))
+FORWARD(STAT, int, lstat64, (const char* p, void* b), (p, b))
+FORWARD(STAT, int, fstat, (int fd, void* b), (fd, b))
+FORWARD(STAT, int, fstat64, (int fd, void* b), (fd, b))
+FORWARD(STAT,
+        int,
+        fstatat,
+        (int d, const char* p, void* b, int f),
+        (d, p, b, f))
+FORWARD(STAT,
+        int,
+        fstatat64,
+        (int d, const char* p, void* b, int f),
+        (d, p, b, f))
+FORWARD(STAT,
+        int,
+        statx,
+        (int d, const char* p, int f, unsigned m, void* b),
+        (d, p, f, m, b))
+// Before glibc 2.33, the stat family was implemented by these functions.
+FORWARD(STAT, int, __xstat, (int v, const char* p, void* b), (v, p, b))
+FORWARD(STAT, int, __xstat64, (int v, const char* p, void* b), (v, p, b))
+FORWARD(STAT, int, __lxstat, (int v, const char* p, void* b), (v, p, b))
+FORWARD(STAT, int, __lxstat64, (int v, const char* p, void* b), (v, p, b))
+FORWARD(STAT, int, __fxstat, (int v, int fd, void* b), (v, fd, b))
+FORWARD(STAT, int, __fxstat64, (int v, int fd, void* b), (v, fd, b))
+
+FORWARD(READ, ssize_t, read, (int fd, void* b, size_t n), (fd, b, n))
+FORWARD(READ,
+        ssize_t,
+        pread,
+        (int fd, void* b, size_t n, off_t o),
+        (fd, b, n, o))
+FORWARD(WRITE, ssize_t, write, (int fd, const void* b, size_t n), (fd, b, n))
+FORWARD(WRITE,
+        ssize_t,
+        pwrite,
+        (int fd, const void* b, size_t n, off_t o),
+        (fd, b, n, o))
+FORWARD(RENAME, int, rename, (const char* o, const char* n), (o, n))
+FORWARD(RENAME,
+        int,
+        renameat,
+        (int od, const char* o, int nd, const char* n),
+        (od, o, nd, n))
+FORWARD(UNLINK, int, unlink, (const char* p), (p))
+FORWARD(UNLINK, int, unlinkat, (int d, const char* p, int f), (d, p, f))
+
+#define FORWARD_OPEN(name, params, args)                                       \
+  int name params                                                              \
+  {                                                                            \
+    static int(*fn) params;                                                    \
+    if (!fn) {                                                                 \
+      fn = (int(*) params)real(#name);                                         \
+    }                                                                          \
+    unsigned mode = 0;                                                         \
+    if (flags & (O_CREAT | O_TMPFILE)) {                                       \
+      va_list ap;                                                              \
+      va_start(ap, flags);                                                     \
+      mode = va_arg(ap, unsigned);                                             \
+      va_end(ap);                                                              \
+    }                                                                          \
+    ++counts[OPEN];                                                            \
+    return fn args;                                                            \
+  }
+
+FORWARD_OPEN(open, (const char* p, int flags, ...), (p, flags, mode))
+FORWARD_OPEN(open64, (const char* p, int flags, ...), (p, flags, mode))
+FORWARD_OPEN(openat,
+             (int d, const char* p, int flags, ...),
+             (d, p, flags, mode))
+FORWARD_OPEN(openat64,
+             (int d, const char* p, int flags, ...),
+             (d, p, flags, mode))
+
+__attribute__((constructor)) static void
+init(void)
+{
+  const char* path = getenv("SYSCALL_COUNTER_OUTPUT");
+  if (path) {
+    output_path = strdup(path);
+  }
+  // Don't count child processes like the compiler.
+  unsetenv("LD_PRELOAD");
+  unsetenv("SYSCALL_COUNTER_OUTPUT");
+}
+
+__attribute__((destructor)) static void
+fini(void)
+{
+  if (!output_path) {
+    return;
+  }
+  // Copy the counts first so that writing the output doesn't affect them.
+  unsigned long result[NUM_CATEGORIES];
+  memcpy(result, counts, sizeof(result));
+  FILE* f = fopen(output_path, "w");
+  if (!f) {
+    return;
+  }
+  for (int i = 0; i < NUM_CATEGORIES; ++i) {
+    fprintf(f, "%s %lu\n", category_names[i], result[i]);
+  }
+  fclose(f);
+}
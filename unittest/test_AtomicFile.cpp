@@ -20,6 +20,7 @@
 #include "TestUtil.hpp"
 
 #include <Stat.hpp>
+#include <Util.hpp>
 #include <util/file.hpp>
 
 #include "third_party/doctest.h"
@@ -51,4 +52,34 @@ TEST_CASE("Not committing")
   CHECK(!Stat::stat("test"));
 }
 
+TEST_CASE("Replacing existing file")
+{
+  TestContext test_context;
+
+  REQUIRE(util::write_file("test", "old"));
+  AtomicFile atomic_file("test", AtomicFile::Mode::binary);
+  atomic_file.write("new");
+  atomic_file.commit();
+  CHECK(*util::read_file<std::string>("test") == "new");
+
+  size_t file_count = 0;
+  Util::traverse(".", [&](const std::string&, bool is_dir) {
+    file_count += is_dir ? 0 : 1;
+  });
+  CHECK(file_count == 1);
+}
+
+TEST_CASE("Large write")
+{
+  TestContext test_context;
+
+  const std::string data(1024 * 1024, 'x');
+  AtomicFile atomic_file("dir/test", AtomicFile::Mode::binary);
+  atomic_file.write("a");
+  atomic_file.write(data);
+  atomic_file.write("b");
+  atomic_file.commit();
+  CHECK(*util::read_file<std::string>("dir/test") == "a" + data + "b");
+}
+
 TEST_SUITE_END();
@@ -59,6 +59,7 @@ TEST_CASE("Config: default values")
   CHECK(config.hash_dir());
   CHECK(config.ignore_headers_in_manifest().empty());
   CHECK(config.ignore_options().empty());
+  CHECK_FALSE(config.io_uring());
   CHECK_FALSE(config.keep_comments_cpp());
   CHECK(config.limit_multiple() == Approx(0.8));
   CHECK(config.log_file().empty());
@@ -377,12 +378,15 @@ TEST_CASE("Config::visit_items")
   util::write_file(
     "test.conf",
     "absolute_paths_in_stderr = true\n"
+    "access_trace_file = /tmp/access.trace\n"
 #ifndef _WIN32
+    "admission_policy = doorkeeper\n"
     "base_dir = /bd\n"
 #else
     "base_dir = C:/bd\n"
 #endif
     "cache_dir = cd\n"
+    "compile_lease_timeout = 30\n"
     "compiler = c\n"
     "compiler_check = cc\n"
     "compiler_type = clang\n"
@@ -392,18 +396,23 @@ TEST_CASE("Config::visit_items")
     "debug = false\n"
     "debug_dir = /dd\n"
     "depend_mode = true\n"
+    "digest_map = /dm\n"
     "direct_mode = false\n"
     "disable = true\n"
     "extra_files_to_hash = efth\n"
     "file_clone = true\n"
+    "git_index = true\n"
     "hard_link = true\n"
     "hash_dir = false\n"
     "ignore_headers_in_manifest = ihim\n"
     "ignore_options = -a=* -b\n"
+    "immutable_include_roots = iir\n"
     "inode_cache = false\n"
+    "io_uring = true\n"
     "keep_comments_cpp = true\n"
     "limit_multiple = 0.0\n"
     "log_file = lf\n"
+    "max_concurrent_compiles = 8\n"
     "max_files = 4711\n"
     "max_size = 98.7M\n"
     "namespace = ns\n"
@@ -414,6 +423,7 @@ TEST_CASE("Config::visit_items")
     "read_only = true\n"
     "read_only_direct = true\n"
     "recache = true\n"
+    "remote_inline_max_size = 4.0M\n"
     "remote_only = true\n"
     "remote_storage = rs\n"
     "reshare = true\n"
@@ -424,6 +434,7 @@ TEST_CASE("Config::visit_items")
     "stats = false\n"
     "stats_log = sl\n"
     "temporary_dir = td\n"
+    "trace_file = /tmp/trace.ring\n"
     "umask = 022\n");
 
   Config config;
@@ -438,12 +449,15 @@ TEST_CASE("Config::visit_items")
 
   std::vector<std::string> expected = {
     "(test.conf) absolute_paths_in_stderr = true",
+    "(test.conf) access_trace_file = /tmp/access.trace",
 #ifndef _WIN32
+    "(test.conf) admission_policy = doorkeeper",
     "(test.conf) base_dir = /bd",
 #else
     "(test.conf) base_dir = C:/bd",
 #endif
     "(test.conf) cache_dir = cd",
+    "(test.conf) compile_lease_timeout = 30",
     "(test.conf) compiler = c",
     "(test.conf) compiler_check = cc",
     "(test.conf) compiler_type = clang",
@@ -453,18 +467,23 @@ TEST_CASE("Config::visit_items")
     "(test.conf) debug = false",
     "(test.conf) debug_dir = /dd",
     "(test.conf) depend_mode = true",
+    "(test.conf) digest_map = /dm",
     "(test.conf) direct_mode = false",
     "(test.conf) disable = true",
     "(test.conf) extra_files_to_hash = efth",
     "(test.conf) file_clone = true",
+    "(test.conf) git_index = true",
     "(test.conf) hard_link = true",
     "(test.conf) hash_dir = false",
     "(test.conf) ignore_headers_in_manifest = ihim",
     "(test.conf) ignore_options = -a=* -b",
+    "(test.conf) immutable_include_roots = iir",
     "(test.conf) inode_cache = false",
+    "(test.conf) io_uring = true",
     "(test.conf) keep_comments_cpp = true",
     "(test.conf) limit_multiple = 0.0",
     "(test.conf) log_file = lf",
+    "(test.conf) max_concurrent_compiles = 8",
     "(test.conf) max_files = 4711",
     "(test.conf) max_size = 98.7M",
     "(test.conf) namespace = ns",
@@ -475,6 +494,7 @@ TEST_CASE("Config::visit_items")
     "(test.conf) read_only = true",
     "(test.conf) read_only_direct = true",
     "(test.conf) recache = true",
+    "(test.conf) remote_inline_max_size = 4.0M",
     "(test.conf) remote_only = true",
     "(test.conf) remote_storage = rs",
     "(test.conf) reshare = true",
@@ -486,6 +506,7 @@ TEST_CASE("Config::visit_items")
     "(test.conf) stats = false",
     "(test.conf) stats_log = sl",
     "(test.conf) temporary_dir = td",
+    "(test.conf) trace_file = /tmp/trace.ring",
     "(test.conf) umask = 022",
   };
 
@@ -0,0 +1,128 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "../src/DigestMap.hpp"
+#include "../src/Stat.hpp"
+#include "../src/Util.hpp"
+#include "../src/fmtmacros.hpp"
+#include "TestUtil.hpp"
+
+#include <util/file.hpp>
+
+#include "third_party/doctest.h"
+
+using TestUtil::TestContext;
+
+namespace {
+
+const char k_digest_a[] = "000102030405060708090a0b0c0d0e0f10111213";
+const char k_digest_b[] = "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF";
+
+} // namespace
+
+TEST_SUITE_BEGIN("DigestMap");
+
+TEST_CASE("DigestMap::find")
+{
+  TestContext test_context;
+
+  util::write_file("map",
+                   FMT("{0} 1 2 3 4 5 /a\n"
+                       "{1} 3 -4 5 6 7 /b c\n"
+                       "x 5 6 7 8 9 /c\n"
+                       "{0} 7 8 9 10 11 /d\n"
+                       "{0} 7 8 9 10 /short\n"
+                       "{1} 9 10 11 12 13 /e",
+                       k_digest_a,
+                       k_digest_b));
+  DigestMap map("map");
+
+  const auto a = map.find("/a");
+  REQUIRE(a);
+  CHECK(Util::format_base16(a->digest.bytes(), a->digest.size())
+        == k_digest_a);
+  CHECK(a->size == 1);
+  CHECK(a->mtime == 2);
+  CHECK(a->ctime == 3);
+  CHECK(a->device == 4);
+  CHECK(a->inode == 5);
+
+  const auto b = map.find("/b c");
+  REQUIRE(b);
+  CHECK(Util::format_base16(b->digest.bytes(), b->digest.size())
+        == "ffffffffffffffffffffffffffffffffffffffff");
+  CHECK(b->mtime == -4);
+
+  CHECK(!map.find("/c"));
+  CHECK(map.find("/d"));
+  CHECK(map.find("/e"));
+  CHECK(!map.find("/"));
+  CHECK(!map.find("/b"));
+  CHECK(!map.find("/f"));
+  CHECK(!map.find("/short"));
+}
+
+TEST_CASE("DigestMap::get")
+{
+  TestContext test_context;
+
+  const auto cwd = Util::get_actual_cwd();
+  util::write_file("a", "a");
+  util::write_file("b", "bb");
+  util::write_file("c", "c");
+  const auto entry = [&](const std::string& path, const Stat& stat) {
+    return FMT("{} 1 {} {} {} {} {}/{}\n",
+               k_digest_a,
+               stat.mtime().nsec(),
+               stat.ctime().nsec(),
+               stat.device(),
+               stat.inode(),
+               cwd,
+               path);
+  };
+  util::write_file("map",
+                   entry("a", Stat::stat("a")) + entry("b", Stat::stat("b"))
+                     + entry("c", Stat::stat("c")));
+
+  // Replace c with a file with the same size and mtime but another inode.
+  const auto c = Stat::stat("c");
+  util::write_file("c.new", "d");
+  util::set_timestamps("c.new", c.mtime());
+  REQUIRE(rename("c.new", "c") == 0);
+
+  DigestMap map("map");
+
+  CHECK(map.get(FMT("{}/a", cwd)));
+  CHECK(!map.get(FMT("{}/b", cwd)));
+  CHECK(!map.get(FMT("{}/c", cwd)));
+  CHECK(!map.get(FMT("{}/d", cwd)));
+  CHECK(map.hits() == 1);
+  CHECK(map.misses() == 3);
+}
+
+TEST_CASE("Missing DigestMap")
+{
+  TestContext test_context;
+
+  DigestMap map("missing");
+  CHECK(!map.find("/a"));
+  CHECK(!map.get("/a"));
+  CHECK(map.misses() == 1);
+}
+
+TEST_SUITE_END();
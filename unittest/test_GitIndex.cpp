@@ -0,0 +1,198 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "../src/GitIndex.hpp"
+#include "../src/Hash.hpp"
+#include "../src/Stat.hpp"
+#include "../src/Util.hpp"
+#include "../src/fmtmacros.hpp"
+#include "TestUtil.hpp"
+
+#include <util/TimePoint.hpp>
+#include <util/file.hpp>
+
+#include "third_party/doctest.h"
+
+#include <string>
+#include <vector>
+
+using TestUtil::TestContext;
+
+namespace {
+
+void
+append_int(std::string& data, uint32_t value, size_t size = 4)
+{
+  for (size_t i = size; i > 0; --i) {
+    data += static_cast<char>((value >> (8 * (i - 1))) & 0xff);
+  }
+}
+
+// Write a git index with SHA-1 object IDs for `names` (sorted), taking stat
+// data from the files in the work tree. The size of `modified_name` is recorded
+// incorrectly to make it look modified.
+void
+write_index(const std::string& work_tree,
+            const std::vector<std::string>& names,
+            uint32_t version,
+            const std::string& modified_name = {})
+{
+  std::string data = "DIRC";
+  append_int(data, version);
+  append_int(data, names.size());
+  std::string previous_name;
+  for (const auto& name : names) {
+    const size_t entry_start = data.size();
+    const auto stat = Stat::stat(FMT("{}/{}", work_tree, name));
+    append_int(data, stat.ctime().sec());
+    append_int(data, stat.ctime().nsec_decimal_part());
+    append_int(data, stat.mtime().sec());
+    append_int(data, stat.mtime().nsec_decimal_part());
+    append_int(data, stat.device());
+    append_int(data, stat.inode());
+    append_int(data, 0100644);
+    append_int(data, 0);
+    append_int(data, 0);
+    append_int(data, stat.size() + (name == modified_name ? 1 : 0));
+    data += std::string(20, name[0]); // Object ID
+    append_int(data, name.length(), 2);
+    if (version == 4) {
+      size_t common = 0;
+      while (common < previous_name.length() && common < name.length()
+             && previous_name[common] == name[common]) {
+        ++common;
+      }
+      data += static_cast<char>(previous_name.length() - common);
+      data += name.substr(common);
+      data += '\0';
+    } else {
+      data += name;
+      do {
+        data += '\0';
+      } while ((data.size() - entry_start) % 8 != 0);
+    }
+    previous_name = name;
+  }
+  data += std::string(20, '\0'); // Checksum
+  util::write_file(FMT("{}/.git/index", work_tree), data);
+}
+
+std::string
+oid_digest(char c)
+{
+  Hash hash;
+  hash.hash_delimiter("git_blob");
+  hash.hash(std::string(20, c));
+  return hash.digest().to_string();
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("GitIndex");
+
+TEST_CASE("GitIndex::get")
+{
+  TestContext test_context;
+
+  const auto work_tree = FMT("{}/repo", Util::get_actual_cwd());
+  const auto index_path = FMT("{}/.git/index", work_tree);
+  Util::ensure_dir_exists(FMT("{}/.git", work_tree));
+  Util::ensure_dir_exists(FMT("{}/include/sub", work_tree));
+  util::write_file(FMT("{}/a.h", work_tree), "a");
+  util::write_file(FMT("{}/include/b.h", work_tree), "b");
+  util::write_file(FMT("{}/include/sub/c.h", work_tree), "c");
+  util::write_file(FMT("{}/untracked.h", work_tree), "u");
+  const std::vector<std::string> names{
+    "a.h", "include/b.h", "include/sub/c.h"};
+
+  SUBCASE("Unmodified files")
+  {
+    for (uint32_t version = 2; version <= 4; ++version) {
+      CAPTURE(version);
+      write_index(work_tree, names, version, "include/sub/c.h");
+      util::set_timestamps(index_path,
+                           util::TimePoint::now() + util::Duration(10));
+
+      GitIndex index(FMT("{}/include", work_tree));
+
+      const auto a = index.get(FMT("{}/a.h", work_tree));
+      REQUIRE(a);
+      CHECK(a->to_string() == oid_digest('a'));
+      const auto b = index.get(FMT("{}/include/sub/../b.h", work_tree));
+      REQUIRE(b);
+      CHECK(b->to_string() == oid_digest('i'));
+
+      CHECK(index.contains(FMT("{}/include/sub/c.h", work_tree)));
+      CHECK(!index.get(FMT("{}/include/sub/c.h", work_tree)));
+      CHECK(!index.contains(FMT("{}/untracked.h", work_tree)));
+      CHECK(!index.get(FMT("{}/untracked.h", work_tree)));
+      CHECK(!index.get(FMT("{}/../a.h", work_tree)));
+    }
+  }
+
+  SUBCASE("Names sharing prefixes")
+  {
+    // Sorted in memcmp order: '-' < '.' < '/' < 'b'.
+    const std::vector<std::string> prefix_names{
+      "a-b.h", "a.h", "a/b.h", "ab.h"};
+    util::write_file(FMT("{}/a-b.h", work_tree), "a-b");
+    util::write_file(FMT("{}/ab.h", work_tree), "ab");
+    Util::ensure_dir_exists(FMT("{}/a", work_tree));
+    util::write_file(FMT("{}/a/b.h", work_tree), "a/b");
+    for (uint32_t version = 2; version <= 4; ++version) {
+      CAPTURE(version);
+      write_index(work_tree, prefix_names, version);
+      util::set_timestamps(index_path,
+                           util::TimePoint::now() + util::Duration(10));
+
+      GitIndex index(work_tree);
+      for (const auto& name : prefix_names) {
+        CAPTURE(name);
+        CHECK(index.contains(FMT("{}/{}", work_tree, name)));
+      }
+      CHECK(!index.contains(FMT("{}/a.", work_tree)));
+      CHECK(!index.contains(FMT("{}/a.c", work_tree)));
+      CHECK(!index.contains(FMT("{}/b.h", work_tree)));
+    }
+  }
+
+  SUBCASE("Racily clean entries")
+  {
+    write_index(work_tree, names, 2);
+    util::set_timestamps(index_path,
+                         Stat::stat(FMT("{}/a.h", work_tree)).mtime());
+    GitIndex index(work_tree);
+    CHECK(!index.contains(FMT("{}/a.h", work_tree)));
+    CHECK(!index.get(FMT("{}/a.h", work_tree)));
+  }
+}
+
+TEST_CASE("GitIndex with invalid index")
+{
+  TestContext test_context;
+
+  const auto work_tree = Util::get_actual_cwd();
+  Util::ensure_dir_exists(".git");
+  util::write_file("a.h", "a");
+  util::write_file(".git/index", std::string("DIRC\0\0\0\x05", 8));
+
+  GitIndex index(work_tree);
+  CHECK(!index.get(FMT("{}/a.h", work_tree)));
+}
+
+TEST_SUITE_END();
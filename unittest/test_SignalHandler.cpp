@@ -1,4 +1,4 @@
-// Copyright (C) 2019-2021 Joel Rosdahl and other contributors
+// Copyright (C) 2022 Joel Rosdahl and other contributors
 //
 // See doc/AUTHORS.adoc for a complete list of contributors.
 //
@@ -16,34 +16,31 @@
 // this program; if not, write to the Free Software Foundation, Inc., 51
 // Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 
-#pragma once
+#include "../src/SignalHandler.hpp"
 
-#include <condition_variable>
-#include <functional>
-#include <limits>
-#include <mutex>
-#include <queue>
-#include <thread>
+#include "third_party/doctest.h"
 
-class ThreadPool
+#ifndef _WIN32
+
+TEST_SUITE_BEGIN("SignalHandler");
+
+TEST_CASE("SignalHandlerBlocker restores the previous signal mask")
 {
-public:
-  explicit ThreadPool(
-    size_t number_of_threads,
-    size_t task_queue_max_size = std::numeric_limits<size_t>::max());
-  ~ThreadPool();
-
-  void enqueue(std::function<void()> function);
-  void shut_down();
-
-private:
-  std::vector<std::thread> m_worker_threads;
-  std::queue<std::function<void()>> m_task_queue;
-  size_t m_task_queue_max_size;
-  bool m_shutting_down = false;
-  std::mutex m_mutex;
-  std::condition_variable m_task_enqueued_or_shutting_down_condition;
-  std::condition_variable m_task_popped_condition;
-
-  void worker_thread_main();
-};
+  sigset_t usr1;
+  sigemptyset(&usr1);
+  sigaddset(&usr1, SIGUSR1);
+  sigset_t original_mask;
+  REQUIRE(sigprocmask(SIG_BLOCK, &usr1, &original_mask) == 0);
+
+  {
+    SignalHandlerBlocker signal_handler_blocker;
+  }
+
+  sigset_t mask;
+  REQUIRE(sigprocmask(SIG_SETMASK, &original_mask, &mask) == 0);
+  CHECK(sigismember(&mask, SIGUSR1) == 1);
+}
+
+TEST_SUITE_END();
+
+#endif // !_WIN32
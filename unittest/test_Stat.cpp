@@ -23,6 +23,7 @@
 
 #include <core/exceptions.hpp>
 #include <core/wincompat.hpp>
+#include <fmtmacros.hpp>
 #include <util/file.hpp>
 
 #include "third_party/doctest.h"
@@ -314,6 +315,39 @@ TEST_CASE("Directory")
 #endif
 }
 
+TEST_CASE("Batch")
+{
+  TestContext test_context;
+
+  // More paths than fit in one io_uring submission.
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < 100; ++i) {
+    paths.push_back(FMT("file{}", i));
+    util::write_file(paths.back(), std::string(i, 'x'));
+  }
+  paths.emplace_back("missing");
+  REQUIRE(mkdir("directory", 0755) == 0);
+  paths.emplace_back("directory");
+
+  const auto stats = Stat::stat_batch(paths);
+
+  REQUIRE(stats.size() == paths.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    const auto expected = Stat::stat(paths[i]);
+    CHECK(stats[i].error_number() == expected.error_number());
+    CHECK(stats[i].device() == expected.device());
+    CHECK(stats[i].inode() == expected.inode());
+    CHECK(stats[i].mode() == expected.mode());
+    CHECK(stats[i].size() == expected.size());
+    CHECK(stats[i].mtime() == expected.mtime());
+    CHECK(stats[i].ctime() == expected.ctime());
+    CHECK(stats[i].size_on_disk() == expected.size_on_disk());
+  }
+  CHECK(stats[10].size() == 10);
+  CHECK(!stats[100]);
+  CHECK(stats[101].is_directory());
+}
+
 TEST_CASE("Symlinks" * doctest::skip(!symlinks_supported()))
 {
   TestContext test_context;
@@ -0,0 +1,87 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "../src/TraceRing.hpp"
+#include "TestUtil.hpp"
+
+#include <core/exceptions.hpp>
+#include <util/file.hpp>
+#include <util/string.hpp>
+
+#include "third_party/doctest.h"
+
+using TestUtil::TestContext;
+
+TEST_SUITE_BEGIN("TraceRing");
+
+#ifndef _WIN32
+
+TEST_CASE("Record and read events")
+{
+  TestContext test_context;
+
+  {
+    TraceRing trace_ring("test.ring");
+    TraceRingScope scope("storage", "get");
+  }
+  TraceRing::record_event('B', "ignored", "no active ring");
+
+  {
+    TraceRing trace_ring("test.ring");
+    TraceRing::record_event('B', "a_very_long_category_name", "x");
+  }
+
+  const auto events = TraceRing::read_events("test.ring");
+  REQUIRE(events.size() == 7);
+  CHECK(events[0].phase == 'B');
+  CHECK(events[0].category == "program");
+  CHECK(events[1].phase == 'B');
+  CHECK(events[1].category == "storage");
+  CHECK(events[1].name == "get");
+  CHECK(events[2].phase == 'E');
+  CHECK(events[2].name == "get");
+  CHECK(events[3].phase == 'E');
+  CHECK(events[3].category == "program");
+  CHECK(events[5].category == "a_very_long_catego");
+  for (size_t i = 1; i < events.size(); ++i) {
+    CHECK(events[i - 1].timestamp <= events[i].timestamp);
+  }
+
+  const auto json = TraceRing::format_chrome_trace(events);
+  CHECK(util::starts_with(json, "{\"traceEvents\":[\n"));
+  CHECK(json.find("\"name\":\"get\",\"cat\":\"storage\",\"ph\":\"B\"")
+        != std::string::npos);
+}
+
+TEST_CASE("Reading a missing or invalid trace ring")
+{
+  TestContext test_context;
+
+  CHECK_THROWS_AS(TraceRing::read_events("missing.ring"), core::Error);
+
+  util::write_file("invalid.ring", "foo");
+  CHECK_THROWS_AS(TraceRing::read_events("invalid.ring"), core::Error);
+
+  // An invalid file is left alone.
+  TraceRing trace_ring("invalid.ring");
+  CHECK(*util::read_file<std::string>("invalid.ring") == "foo");
+}
+
+#endif // !_WIN32
+
+TEST_SUITE_END();
@@ -20,15 +20,8 @@
 
 #include "third_party/doctest.h"
 
-bool compopt_verify_sortedness_and_flags();
-
 TEST_SUITE_BEGIN("compopt");
 
-TEST_CASE("option_table_should_be_sorted")
-{
-  CHECK(compopt_verify_sortedness_and_flags());
-}
-
 TEST_CASE("affects_cpp_output")
 {
   CHECK(compopt_affects_cpp_output("-I"));
@@ -82,6 +75,11 @@ TEST_CASE("prefix_affects_cpp_output")
   CHECK(compopt_prefix_affects_cpp_output("-iframework"));
   CHECK(compopt_prefix_affects_cpp_output("-iframework42"));
   CHECK(!compopt_prefix_affects_cpp_output("-iframewor"));
+  CHECK(compopt_prefix_affects_cpp_output("-DNAME=value"));
+  CHECK(compopt_prefix_affects_cpp_output("-includefoo.h"));
+  CHECK(compopt_prefix_affects_cpp_output("-include-pchfoo.h"));
+  CHECK(!compopt_prefix_affects_cpp_output(""));
+  CHECK(!compopt_prefix_affects_cpp_output("-MFfoo"));
 }
 
 TEST_CASE("prefix_affects_compiler_output")
@@ -0,0 +1,102 @@
+// Copyright (C) 2021-2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "TestUtil.hpp"
+
+#include <core/AccessTrace.hpp>
+#include <core/CacheSimulator.hpp>
+
+#include <third_party/doctest.h>
+
+using core::AccessTrace;
+using core::CacheEntryType;
+using core::CacheSimulator;
+using TestUtil::TestContext;
+
+namespace {
+
+AccessTrace::Event
+event(uint64_t key, AccessTrace::Kind kind, uint32_t size = 0)
+{
+  return {0, CacheEntryType::result, kind, key, size, 10};
+}
+
+// Access keys 1, 2, 1, 3, 1 in a cache that only has room for two entries,
+// storing entries on simulated misses.
+CacheSimulator::Result
+run(CacheSimulator::Policy policy)
+{
+  CacheSimulator simulator(policy, 200, 0.8);
+  for (uint64_t key : {1, 2, 1, 3, 1}) {
+    const auto before = simulator.result().hits;
+    simulator.process(event(key, AccessTrace::Kind::miss), 0.0);
+    if (simulator.result().hits == before) {
+      simulator.process(event(key, AccessTrace::Kind::store, 100), 0.0);
+    }
+  }
+  return simulator.result();
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("core::CacheSimulator");
+
+TEST_CASE("LRU keeps recently hit entries")
+{
+  const auto result = run(CacheSimulator::Policy::lru);
+  CHECK(result.lookups == 5);
+  CHECK(result.hits == 2);
+  CHECK(result.saved_cost == 20.0);
+}
+
+TEST_CASE("FIFO evicts in insertion order")
+{
+  const auto result = run(CacheSimulator::Policy::fifo);
+  CHECK(result.lookups == 5);
+  CHECK(result.hits == 1);
+}
+
+TEST_CASE("Replay access trace")
+{
+  TestContext test_context;
+
+  AccessTrace trace("trace");
+  trace.write({event(1, AccessTrace::Kind::miss),
+               event(1, AccessTrace::Kind::store, 100),
+               event(1, AccessTrace::Kind::hit, 100)});
+  trace.write({event(2, AccessTrace::Kind::hit, 100)});
+  CHECK(trace.event_count() == 4);
+
+  const auto report = core::simulate_cache_sizes(trace, {50, 1000}, 0.8);
+  CHECK(report.events == 4);
+  CHECK(report.sampling_rate == 1.0);
+  CHECK(report.observed.lookups == 3);
+  CHECK(report.observed.hits == 2);
+
+  REQUIRE(report.rows.size() == 2 * CacheSimulator::k_policies.size());
+  const auto& too_small = report.rows.front();
+  CHECK(too_small.max_size == 50);
+  CHECK(too_small.result.hits == 0);
+  const auto& large = report.rows.back();
+  CHECK(large.max_size == 1000);
+  CHECK(large.result.lookups == 3);
+  CHECK(large.result.hits == 1);
+  CHECK(large.result.saved_cost == 10.0);
+}
+
+TEST_SUITE_END();
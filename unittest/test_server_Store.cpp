@@ -0,0 +1,207 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "TestUtil.hpp"
+
+#include <Util.hpp>
+#include <server/Server.hpp>
+#include <server/Store.hpp>
+#include <util/file.hpp>
+
+#include <third_party/doctest.h>
+
+#include <string>
+
+using server::Store;
+using TestUtil::TestContext;
+
+namespace {
+
+nonstd::span<const uint8_t>
+to_span(std::string_view value)
+{
+  return {reinterpret_cast<const uint8_t*>(value.data()), value.size()};
+}
+
+std::string
+get_value(Store& store, const std::string& key)
+{
+  const auto entry = store.get(key);
+  return entry ? std::string(entry->value.begin(), entry->value.end()) : "-";
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("server::Store");
+
+TEST_CASE("Store::is_valid_key")
+{
+  CHECK(Store::is_valid_key("abc123"));
+  CHECK(Store::is_valid_key("abc123.lease"));
+  CHECK(!Store::is_valid_key("ab"));
+  CHECK(!Store::is_valid_key("ab.lease"));
+  CHECK(!Store::is_valid_key("abc/123"));
+  CHECK(!Store::is_valid_key("abc.."));
+  CHECK(!Store::is_valid_key("ABC123"));
+}
+
+TEST_CASE("Put, get and remove")
+{
+  TestContext test_context;
+
+  Store store("dir", 0);
+  CHECK(!store.get("abcdef"));
+
+  const auto etag = store.put("abcdef", to_span("value"));
+  REQUIRE(etag);
+  CHECK(util::read_file<std::string>("dir/ab/cdef") == "value");
+  CHECK(get_value(store, "abcdef") == "value");
+  CHECK(store.head("abcdef") == etag);
+  CHECK(store.entry_count() == 1);
+  CHECK(store.size() == 5);
+
+  const auto unchanged = store.get("abcdef", *etag);
+  REQUIRE(unchanged);
+  CHECK(unchanged->unchanged);
+  CHECK(unchanged->value.empty());
+
+  CHECK(store.remove("abcdef") == Store::RemoveResult::removed);
+  CHECK(store.remove("abcdef") == Store::RemoveResult::missing);
+  CHECK(!store.get("abcdef"));
+  CHECK(store.entry_count() == 0);
+  CHECK(store.size() == 0);
+}
+
+TEST_CASE("Conditional put")
+{
+  TestContext test_context;
+
+  Store store("dir", 0);
+  CHECK(store.put("abcdef.lease", to_span("1"), true));
+  CHECK(!store.put("abcdef.lease", to_span("2"), true));
+  CHECK(get_value(store, "abcdef.lease") == "1");
+  CHECK(store.put("abcdef.lease", to_span("3")));
+  CHECK(get_value(store, "abcdef.lease") == "3");
+
+  SUBCASE("If-Match")
+  {
+    CHECK(!store.put("123456", to_span("1"), false, "\"1-1\""));
+    CHECK(!store.get("123456"));
+
+    const auto etag = store.put("123456", to_span("1"));
+    REQUIRE(etag);
+    const auto new_etag = store.put("123456", to_span("22"), false, *etag);
+    REQUIRE(new_etag);
+    CHECK(*new_etag != *etag);
+    CHECK(!store.put("123456", to_span("3"), false, *etag));
+    CHECK(get_value(store, "123456") == "22");
+    CHECK(store.put("123456", to_span("4"), false, "*"));
+    CHECK(get_value(store, "123456") == "4");
+  }
+
+  SUBCASE("Conditional remove")
+  {
+    const auto etag = store.put("123456", to_span("1"));
+    REQUIRE(etag);
+    CHECK(store.put("123456", to_span("2")));
+    CHECK(store.remove("123456", *etag) == Store::RemoveResult::changed);
+    CHECK(get_value(store, "123456") == "2");
+    CHECK(store.remove("123456", *store.head("123456"))
+          == Store::RemoveResult::removed);
+    CHECK(store.remove("123456", *etag) == Store::RemoveResult::missing);
+  }
+}
+
+TEST_CASE("ETags")
+{
+  TestContext test_context;
+
+  Store store("dir", 0);
+  const auto etag_1 = store.put("abcdef", to_span("1"));
+  // Same size and, on file systems with coarse timestamps, same mtime.
+  const auto etag_2 = store.put("abcdef", to_span("2"));
+  REQUIRE(etag_1);
+  REQUIRE(etag_2);
+  CHECK(*etag_1 != *etag_2);
+  CHECK(!store.put("abcdef", to_span("3"), false, *etag_1));
+
+  // ETags of another store instance, e.g. after a restart, differ.
+  Store other_store("dir", 0);
+  other_store.load();
+  CHECK(other_store.head("abcdef") != etag_2);
+}
+
+TEST_CASE("Least recently used entries are evicted")
+{
+  TestContext test_context;
+
+  Store store("dir", 10);
+  store.put("aaaaaa", to_span("1234"));
+  store.put("bbbbbb", to_span("1234"));
+  CHECK(get_value(store, "aaaaaa") == "1234");
+  store.put("cccccc", to_span("1234"));
+
+  CHECK(get_value(store, "aaaaaa") == "1234");
+  CHECK(get_value(store, "bbbbbb") == "-");
+  CHECK(get_value(store, "cccccc") == "1234");
+  CHECK(!util::read_file<std::string>("dir/bb/bbbb"));
+  CHECK(store.eviction_count() == 1);
+  CHECK(store.size() == 8);
+
+  // An entry larger than the maximum size is kept until the next put.
+  store.put("dddddd", to_span("12345678901"));
+  CHECK(store.entry_count() == 1);
+  CHECK(store.eviction_count() == 3);
+}
+
+TEST_CASE("Load existing entries")
+{
+  TestContext test_context;
+
+  {
+    Store store("dir", 0);
+    store.put("aaaaaa", to_span("1"));
+    store.put("bbbbbb", to_span("2"));
+  }
+  Util::ensure_dir_exists("dir/cc");
+  util::write_file("dir/cc/not-a-key", "");
+  util::write_file("dir/toplevel", "");
+  util::set_timestamps("dir/aa/aaaa", util::TimePoint(1000));
+  util::set_timestamps("dir/bb/bbbb", util::TimePoint(2000));
+
+  Store store("dir", 1);
+  store.load();
+  CHECK(store.entry_count() == 1);
+  CHECK(get_value(store, "aaaaaa") == "-");
+  CHECK(get_value(store, "bbbbbb") == "2");
+}
+
+TEST_CASE("Server::key_from_path")
+{
+  using server::Server;
+
+  CHECK(Server::key_from_path("/ab/cdef") == "abcdef");
+  CHECK(Server::key_from_path("/prefix//ab/cdef") == "abcdef");
+  CHECK(Server::key_from_path("/abcdef") == "abcdef");
+  CHECK(Server::key_from_path("/prefix/abcdef") == "abcdef");
+  CHECK(Server::key_from_path("/ab/cdef.lease") == "abcdef.lease");
+  CHECK(!Server::key_from_path("/ab/../cdef"));
+  CHECK(!Server::key_from_path("/"));
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,85 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "TestUtil.hpp"
+
+#include <Hash.hpp>
+#include <storage/local/Doorkeeper.hpp>
+#include <util/file.hpp>
+
+#include <third_party/doctest.h>
+
+#include <cstdio>
+
+using storage::local::Doorkeeper;
+using TestUtil::TestContext;
+
+TEST_SUITE_BEGIN("storage::local::Doorkeeper");
+
+#ifndef _WIN32
+
+TEST_CASE("Keys are admitted when seen the second time")
+{
+  TestContext test_context;
+
+  const auto key1 = Hash().hash("key1").digest();
+  const auto key2 = Hash().hash("key2").digest();
+
+  {
+    Doorkeeper doorkeeper("dir/doorkeeper");
+    CHECK(!doorkeeper.check_and_add(key1));
+    CHECK(doorkeeper.check_and_add(key1));
+  }
+
+  // The filter is shared via the file.
+  Doorkeeper doorkeeper("dir/doorkeeper");
+  CHECK(doorkeeper.check_and_add(key1));
+  CHECK(!doorkeeper.check_and_add(key2));
+  CHECK(doorkeeper.check_and_add(key2));
+}
+
+TEST_CASE("Filter with other version is reset")
+{
+  TestContext test_context;
+
+  const auto key = Hash().hash("key").digest();
+  CHECK(!Doorkeeper("doorkeeper").check_and_add(key));
+
+  // Overwrite the version field but keep the bits.
+  FILE* f = fopen("doorkeeper", "r+b");
+  REQUIRE(f);
+  const uint32_t version = Doorkeeper::k_version + 1;
+  CHECK(fwrite(&version, sizeof(version), 1, f) == 1);
+  fclose(f);
+
+  CHECK(!Doorkeeper("doorkeeper").check_and_add(key));
+  CHECK(Doorkeeper("doorkeeper").check_and_add(key));
+}
+
+#endif
+
+TEST_CASE("Everything is admitted on errors")
+{
+  TestContext test_context;
+
+  util::write_file("file", "");
+  Doorkeeper doorkeeper("file/doorkeeper");
+  CHECK(doorkeeper.check_and_add(Hash().hash("key").digest()));
+}
+
+TEST_SUITE_END();
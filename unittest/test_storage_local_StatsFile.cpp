@@ -22,6 +22,7 @@
 #include <core/Statistic.hpp>
 #include <fmtmacros.hpp>
 #include <storage/local/StatsFile.hpp>
+#include <util/LockFile.hpp>
 #include <util/file.hpp>
 
 #include <third_party/doctest.h>
@@ -104,4 +105,23 @@ TEST_CASE("Update")
   CHECK(counters->get(Statistic::cache_miss) == 33);
 }
 
+TEST_CASE("Non-blocking update of locked file")
+{
+  TestContext test_context;
+
+  util::ShortLivedLockFile lock_file("test");
+  REQUIRE(lock_file.acquire());
+
+  bool called = false;
+  CHECK(!StatsFile("test").update([&](auto& /*cs*/) { called = true; },
+                                  util::LockFileGuard::Mode::non_blocking));
+  CHECK(!called);
+
+  lock_file.release();
+  CHECK(StatsFile("test").update(
+    [](auto& cs) { cs.increment(Statistic::cache_miss, 1); },
+    util::LockFileGuard::Mode::non_blocking));
+  CHECK(StatsFile("test").read().get(Statistic::cache_miss) == 1);
+}
+
 TEST_SUITE_END();
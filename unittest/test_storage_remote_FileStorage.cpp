@@ -0,0 +1,128 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "TestUtil.hpp"
+
+#include <Digest.hpp>
+#include <Util.hpp>
+#include <fmtmacros.hpp>
+#include <storage/remote/FileStorage.hpp>
+#include <util/file.hpp>
+
+#include <third_party/doctest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using storage::remote::FileStorage;
+using storage::remote::RemoteStorage;
+using TestUtil::TestContext;
+
+namespace {
+
+std::unique_ptr<RemoteStorage::Backend>
+create_backend()
+{
+  RemoteStorage::Backend::Params params;
+  params.url = Url(FMT("file://{}/remote", Util::get_actual_cwd()));
+  params.attributes.push_back({"layout", "flat", "flat"});
+  return FileStorage().create_backend(params);
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("storage::remote::FileStorage");
+
+TEST_CASE("Leases are owned")
+{
+  TestContext test_context;
+
+  const Digest key{};
+  auto backend = create_backend();
+
+  CHECK(backend->acquire_lease(key, "a", 10s) == true);
+  CHECK(backend->has_lease(key) == true);
+  CHECK(backend->acquire_lease(key, "b", 10s) == false);
+
+  // Only the owner can renew or release the lease.
+  CHECK(backend->renew_lease(key, "b", 10s) == false);
+  CHECK(backend->release_lease(key, "b") == false);
+  CHECK(backend->has_lease(key) == true);
+  CHECK(backend->renew_lease(key, "a", 10s) == true);
+  CHECK(backend->release_lease(key, "a") == true);
+  CHECK(backend->has_lease(key) == false);
+  CHECK(backend->release_lease(key, "a") == false);
+}
+
+TEST_CASE("Expired leases are broken")
+{
+  TestContext test_context;
+
+  const Digest key{};
+  auto backend = create_backend();
+  const auto path = FMT("remote/{}.lease", key.to_string());
+
+  REQUIRE(backend->acquire_lease(key, "a", 10s) == true);
+  REQUIRE(util::write_file(path, "1 a"));
+  CHECK(backend->has_lease(key) == false);
+
+  // The expired owner can neither renew nor release the new owner's lease.
+  CHECK(backend->acquire_lease(key, "b", 10s) == true);
+  CHECK(backend->renew_lease(key, "a", 10s) == false);
+  CHECK(backend->release_lease(key, "a") == false);
+  CHECK(backend->has_lease(key) == true);
+}
+
+TEST_CASE("Only one of two clients breaking an expired lease wins")
+{
+  TestContext test_context;
+
+  const Digest key{};
+  const auto path = FMT("remote/{}.lease", key.to_string());
+  REQUIRE(Util::create_dir("remote"));
+
+  for (int i = 0; i < 50; ++i) {
+    REQUIRE(util::write_file(path, "1 expired"));
+
+    std::atomic<bool> start = false;
+    std::atomic<int> winners = 0;
+    std::vector<std::thread> clients;
+    for (int j = 0; j < 2; ++j) {
+      clients.emplace_back([&, j] {
+        auto backend = create_backend();
+        while (!start) {
+          std::this_thread::yield();
+        }
+        if (backend->acquire_lease(key, FMT("{}", j), 10s) == true) {
+          ++winners;
+        }
+      });
+    }
+    start = true;
+    for (auto& client : clients) {
+      client.join();
+    }
+
+    CHECK(winners == 1);
+    CHECK(create_backend()->has_lease(key) == true);
+  }
+}
+
+TEST_SUITE_END();
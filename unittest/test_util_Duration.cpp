@@ -0,0 +1,70 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <util/Duration.hpp>
+
+#include <third_party/doctest.h>
+
+TEST_SUITE_BEGIN("util::Duration");
+
+using util::Duration;
+
+TEST_CASE("Basics")
+{
+  Duration d0(4711, 2042);
+
+  CHECK(d0.sec() == 4711);
+  CHECK(d0.nsec() == 4711000002042);
+  CHECK(d0.nsec_decimal_part() == 2042);
+}
+
+TEST_CASE("Arithmetic operators")
+{
+  Duration d0(1, 2);
+  Duration d1(3, 4);
+
+  SUBCASE("operator+")
+  {
+    CHECK(d0 + d1 == Duration(4, 6));
+    CHECK((d0 + d1).sec() == 4);
+    CHECK((d0 + Duration(0, 999'999'999)).nsec_decimal_part() == 1);
+  }
+
+  SUBCASE("operator-")
+  {
+    CHECK(d1 - d0 == Duration(2, 2));
+    CHECK(d0 - d1 == Duration(-2, -2));
+    CHECK((d1 - d0).sec() == 2);
+  }
+
+  SUBCASE("operator*")
+  {
+    CHECK(d1 * 2 == Duration(6, 8));
+    CHECK(d1 * 0.5 == Duration(1, 500'000'002));
+    CHECK((d1 * 2).sec() == 6);
+  }
+
+  SUBCASE("operator/")
+  {
+    CHECK(d1 / 2 == Duration(1, 500'000'002));
+    CHECK(Duration(2) / 4 == Duration(0, 500'000'000));
+    CHECK((d1 / 2).sec() == 1);
+  }
+}
+
+TEST_SUITE_END();
@@ -90,6 +90,26 @@ TEST_CASE("Non-blocking short-lived lock")
   CHECK(!lock_file_2.acquired());
 }
 
+TEST_CASE("Short-lived lock with timeout")
+{
+  TestContext test_context;
+
+  util::ShortLivedLockFile lock_file_1("test");
+  util::ShortLivedLockFile lock_file_2("test");
+
+  CHECK(lock_file_1.try_acquire_for(util::Duration(1)));
+  CHECK(lock_file_1.acquired());
+
+  const auto start = util::TimePoint::now();
+  CHECK(!lock_file_2.try_acquire_for(util::Duration(0, 100'000'000)));
+  CHECK(!lock_file_2.acquired());
+  CHECK(util::TimePoint::now() - start >= util::Duration(0, 100'000'000));
+
+  lock_file_1.release();
+  CHECK(lock_file_2.try_acquire_for(util::Duration(0, 100'000'000)));
+  lock_file_2.release();
+}
+
 TEST_CASE("Acquire and release long-lived lock file")
 {
   TestContext test_context;
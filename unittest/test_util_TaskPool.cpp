@@ -0,0 +1,122 @@
+// Copyright (C) 2022 Joel Rosdahl and other contributors
+//
+// See doc/AUTHORS.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <util/TaskPool.hpp>
+
+#include "third_party/doctest.h"
+
+#include <atomic>
+#include <stdexcept>
+
+TEST_SUITE_BEGIN("util::TaskPool");
+
+TEST_CASE("TaskGroup::wait")
+{
+  util::TaskPool pool(4);
+  CHECK(pool.max_threads() == 4);
+
+  std::atomic<int> sum{0};
+  util::TaskGroup group(pool);
+  for (int i = 1; i <= 1000; ++i) {
+    group.run([&sum, i] { sum += i; });
+  }
+  group.wait();
+  CHECK(sum == 500500);
+
+  // The group can be reused after waiting.
+  group.run([&sum] { sum = 0; });
+  group.wait();
+  CHECK(sum == 0);
+}
+
+TEST_CASE("TaskGroup with limited number of unfinished tasks")
+{
+  util::TaskPool pool(4);
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  std::atomic<int> count{0};
+
+  {
+    util::TaskGroup group(pool, 2);
+    for (int i = 0; i < 100; ++i) {
+      group.run([&] {
+        const int now_running = ++running;
+        int max = max_running;
+        while (now_running > max
+               && !max_running.compare_exchange_weak(max, now_running)) {
+        }
+        ++count;
+        --running;
+      });
+    }
+  }
+
+  CHECK(count == 100);
+  CHECK(max_running <= 2);
+}
+
+TEST_CASE("TaskGroup with tasks submitting tasks")
+{
+  util::TaskPool pool(2);
+  std::atomic<int> count{0};
+
+  util::TaskGroup outer(pool);
+  for (int i = 0; i < 10; ++i) {
+    outer.run([&] {
+      util::TaskGroup inner(pool);
+      for (int j = 0; j < 10; ++j) {
+        inner.run([&] { ++count; });
+      }
+      inner.wait();
+    });
+  }
+  outer.wait();
+  CHECK(count == 100);
+}
+
+TEST_CASE("TaskGroup propagates exceptions")
+{
+  util::TaskPool pool(2);
+  std::atomic<int> count{0};
+
+  util::TaskGroup group(pool);
+  group.run([] { throw std::runtime_error("error"); });
+  for (int i = 0; i < 10; ++i) {
+    group.run([&count] { ++count; });
+  }
+  CHECK_THROWS_WITH(group.wait(), "error");
+  CHECK(count == 10);
+
+  // The exception is only rethrown once.
+  group.wait();
+}
+
+TEST_CASE("TaskPool destructor runs queued tasks")
+{
+  std::atomic<int> count{0};
+  {
+    util::TaskPool pool(1);
+    util::TaskGroup group(pool);
+    for (int i = 0; i < 10; ++i) {
+      group.run([&count] { ++count; });
+    }
+  }
+  CHECK(count == 10);
+}
+
+TEST_SUITE_END();
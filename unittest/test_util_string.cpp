@@ -49,6 +49,14 @@ TEST_CASE("util::ends_with")
   CHECK_FALSE(util::ends_with("x", "xy"));
 }
 
+TEST_CASE("util::escape_json")
+{
+  CHECK(util::escape_json("") == "");
+  CHECK(util::escape_json("foo") == "foo");
+  CHECK(util::escape_json("a\"b\\c") == "a\\\"b\\\\c");
+  CHECK(util::escape_json("a\nb\x01") == "a\\u000ab\\u0001");
+}
+
 TEST_CASE("util::join")
 {
   {